@@ -1,15 +1,12 @@
 #include "knetlib/EventLoop.h"
-#include "knetlib/TcpServer.h"
-#include "knetlib/TcpConnection.h"
+#include "knetlib/HttpServer.h"
 #include "knetlib/InetAddress.h"
-#include "knetlib/Buffer.h"
 #include "knetlib/Logger.h"
 #include <iostream>
 #include <signal.h>
 #include <csignal>
 #include <string>
-#include <sstream>
-#include <unordered_map>
+#include <string_view>
 
 // 全局变量用于优雅退出
 EventLoop* g_loop = nullptr;
@@ -21,64 +18,10 @@ void signalHandler(int sig) {
     }
 }
 
-// 简单的 HTTP 请求解析
-struct HttpRequest {
-    std::string method;
-    std::string path;
-    std::string version;
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
-    
-    bool parse(const std::string& raw) {
-        std::istringstream iss(raw);
-        std::string line;
-        
-        // 解析请求行
-        if (!std::getline(iss, line)) return false;
-        std::istringstream requestLine(line);
-        requestLine >> method >> path >> version;
-        
-        // 解析头部
-        while (std::getline(iss, line) && line != "\r" && !line.empty()) {
-            size_t pos = line.find(':');
-            if (pos != std::string::npos) {
-                std::string key = line.substr(0, pos);
-                std::string value = line.substr(pos + 1);
-                // 去除前后空格
-                key.erase(0, key.find_first_not_of(" \t\r\n"));
-                key.erase(key.find_last_not_of(" \t\r\n") + 1);
-                value.erase(0, value.find_first_not_of(" \t\r\n"));
-                value.erase(value.find_last_not_of(" \t\r\n") + 1);
-                headers[key] = value;
-            }
-        }
-        
-        return true;
-    }
-};
-
-// 生成 HTTP 响应
-std::string generateHttpResponse(const std::string& content, const std::string& contentType = "text/html") {
-    std::ostringstream oss;
-    oss << "HTTP/1.1 200 OK\r\n";
-    oss << "Content-Type: " << contentType << "\r\n";
-    oss << "Content-Length: " << content.length() << "\r\n";
-    oss << "Connection: keep-alive\r\n";
-    oss << "Server: KnetLib/1.0\r\n";
-    oss << "\r\n";
-    oss << content;
-    return oss.str();
-}
-
-// 生成简单的 HTML 响应
-std::string generateHtmlResponse(const std::string& title, const std::string& body) {
-    std::ostringstream oss;
-    oss << "<!DOCTYPE html>\n";
-    oss << "<html><head><title>" << title << "</title></head>\n";
-    oss << "<body><h1>" << title << "</h1>\n";
-    oss << "<p>" << body << "</p>\n";
-    oss << "</body></html>\n";
-    return oss.str();
+// 生成简单的 HTML 页面
+std::string generateHtml(const std::string& title, const std::string& body) {
+    return "<!DOCTYPE html>\n<html><head><title>" + title + "</title></head>\n<body><h1>" + title +
+           "</h1>\n<p>" + body + "</p>\n</body></html>\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -104,62 +47,37 @@ int main(int argc, char* argv[]) {
     signal(SIGTERM, signalHandler);
     
     InetAddress local(port);
-    TcpServer server(&loop, local);
-    
-    // 设置连接回调
-    server.setConnectionCallback([](const TcpConnectionPtr& conn) {
-        if (conn->connected()) {
-            // 连接建立，静默处理（减少日志输出）
-        } else {
-            // 连接关闭，静默处理
-        }
-    });
-    
-    // 设置消息回调 - HTTP 服务器
-    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf) {
-        std::string request = buf.retrieveAllAsString();
-        
-        HttpRequest httpReq;
-        if (httpReq.parse(request)) {
-            // 处理不同的路径
-            std::string response;
-            
-            if (httpReq.path == "/" || httpReq.path == "/index.html") {
-                std::string html = generateHtmlResponse("KnetLib Performance Test", 
-                    "Welcome to KnetLib HTTP Server Performance Test");
-                response = generateHttpResponse(html);
-            } else if (httpReq.path == "/hello") {
-                std::string html = generateHtmlResponse("Hello", "Hello from KnetLib!");
-                response = generateHttpResponse(html);
-            } else if (httpReq.path == "/plain") {
-                response = generateHttpResponse("OK", "text/plain");
-            } else if (httpReq.path == "/json") {
-                std::string json = "{\"status\":\"ok\",\"message\":\"KnetLib Performance Test\"}";
-                response = generateHttpResponse(json, "application/json");
-            } else {
-                // 404 Not Found
-                std::ostringstream oss;
-                oss << "HTTP/1.1 404 Not Found\r\n";
-                oss << "Content-Type: text/html\r\n";
-                oss << "Content-Length: 0\r\n";
-                oss << "Connection: keep-alive\r\n";
-                oss << "\r\n";
-                response = oss.str();
-            }
-            
-            conn->send(response);
+    HttpServer server(&loop, local);
+
+    // 应答内容在启动时生成一次，处理请求时只写入输出缓冲区
+    const std::string indexHtml = generateHtml("KnetLib Performance Test",
+        "Welcome to KnetLib HTTP Server Performance Test");
+    const std::string helloHtml = generateHtml("Hello", "Hello from KnetLib!");
+    const std::string json = "{\"status\":\"ok\",\"message\":\"KnetLib Performance Test\"}";
+
+    server.setHttpCallback([&](const HttpRequest& request, HttpResponse& response) {
+        std::string_view path = request.path();
+        if (path == "/" || path == "/index.html") {
+            response.setContentType("text/html");
+            response.setBody(indexHtml);
+        } else if (path == "/hello") {
+            response.setContentType("text/html");
+            response.setBody(helloHtml);
+        } else if (path == "/plain") {
+            response.setContentType("text/plain");
+            response.setBody("OK");
+        } else if (path == "/json") {
+            response.setContentType("application/json");
+            response.setBody(json);
         } else {
-            // 解析失败，返回 400 Bad Request
-            std::ostringstream oss;
-            oss << "HTTP/1.1 400 Bad Request\r\n";
-            oss << "Content-Type: text/html\r\n";
-            oss << "Content-Length: 0\r\n";
-            oss << "Connection: close\r\n";
-            oss << "\r\n";
-            conn->send(oss.str());
+            response.setStatus(HttpResponse::k404NotFound);
+            response.setContentType("text/html");
         }
     });
-    
+
+    // 请求一次读取就能收齐，读进 loop 共用的读缓冲区，连接不再各自持有输入缓冲区
+    server.tcpServer().setSharedReadBuffer(true);
+
     // 设置线程数（必须在 start() 之前，且必须在 EventLoop 线程中）
     if (numThreads > 1) {
         server.setNumThread(numThreads);
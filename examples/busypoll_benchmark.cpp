@@ -0,0 +1,119 @@
+/**
+ * 忙轮询模式的延迟测试
+ * 单个工作线程的回显服务器，客户端用阻塞 socket 逐条 ping-pong，统计往返延迟的分位数，
+ * 以及测试期间整个进程的 CPU 占用（CPU 时间 / 墙钟时间，包含客户端线程）。
+ * 依次测试三种模式：阻塞（默认）、混合（活动后忙轮询 50us 再阻塞）、持续忙轮询。
+ * 忙轮询需要独占一个核，机器只有一个核时结果没有参考意义。
+ * 用法: busypoll_benchmark [往返次数]
+ */
+#include "knetlib/EventLoop.h"
+#include "knetlib/InetAddress.h"
+#include "knetlib/Logger.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/TcpServer.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", port);
+    for (int i = 0; i < 100; ++i) {
+        if (::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0) {
+            int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            return fd;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(fd);
+    return -1;
+}
+
+void runMode(const char* name, Nanoseconds budget, uint16_t port, int rounds) {
+    // 主线程的 loop 不运行：SO_REUSEPORT 模式下工作线程自己 accept
+    EventLoop baseLoop;
+    TcpServer server(&baseLoop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setReusePort(true);
+    server.setBusyPoll(budget);
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buffer) {
+        conn->send(buffer.retrieveAllAsString());
+    });
+    server.start();
+
+    int fd = connectTo(port);
+    if (fd == -1) {
+        std::cerr << name << ": 连接失败" << std::endl;
+        return;
+    }
+
+    char message[64] = {0};
+    std::vector<double> latencies;
+    latencies.reserve(rounds);
+    // 预热
+    for (int i = 0; i < 1000; ++i) {
+        ::write(fd, message, sizeof(message));
+        ::read(fd, message, sizeof(message));
+    }
+
+    double cpuBegin = cpuSeconds();
+    auto begin = Clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        auto start = Clock::now();
+        ::write(fd, message, sizeof(message));
+        size_t got = 0;
+        while (got < sizeof(message)) {
+            ssize_t n = ::read(fd, message + got, sizeof(message) - got);
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - begin).count();
+    double cpu = cpuSeconds() - cpuBegin;
+    ::close(fd);
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    std::cout << name << ": " << rounds << " 次往返, p50 " << percentile(0.5) << " us, p99 "
+              << percentile(0.99) << " us, p99.9 " << percentile(0.999) << " us, 进程 CPU "
+              << cpu / wall * 100 << "%" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    setLogLevel(LOG_LEVEL::LOG_LEVEL_WARN);
+
+    int rounds = 100000;
+    if (argc > 1) {
+        rounds = std::stoi(argv[1]);
+    }
+
+    runMode("阻塞", Nanoseconds::zero(), 19601, rounds);
+    runMode("混合 (忙轮询 50us)", Microseconds(50), 19602, rounds);
+    runMode("忙轮询", Seconds(3600), 19603, rounds);
+    return 0;
+}
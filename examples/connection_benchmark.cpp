@@ -0,0 +1,107 @@
+/**
+ * 连接建立、关闭速率测试
+ * 单个工作线程的服务器在连接建立后立即关闭连接，客户端用阻塞 socket 逐个 connect，
+ * 读到服务器关闭后再 close，统计每秒完成的连接数和每个连接的平均耗时，
+ * 以及测试期间整个进程的 CPU 占用（包含客户端线程）。
+ * 连接对象从对象池中分配（见 TcpConnection::create），稳定后建立连接不再 malloc TcpConnection。
+ * 用法: connection_benchmark [连接数] [客户端线程数]
+ */
+#include "knetlib/EventLoop.h"
+#include "knetlib/InetAddress.h"
+#include "knetlib/Logger.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/TcpServer.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint16_t kPort = 19604;
+
+double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// 建立一个连接并等待服务器关闭，成功返回 true
+bool connectOnce(const InetAddress& addr) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return false;
+    bool ok = ::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0;
+    if (ok) {
+        char buf[16];
+        ok = ::read(fd, buf, sizeof(buf)) == 0;
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int clients = argc > 2 ? std::atoi(argv[2]) : 1;
+    if (total <= 0 || clients <= 0) {
+        std::cerr << "用法: " << argv[0] << " [连接数] [客户端线程数]" << std::endl;
+        return 1;
+    }
+    setLogLevel(LOG_LEVEL::LOG_LEVEL_WARN);
+
+    // 主线程的 loop 不运行：SO_REUSEPORT 模式下工作线程自己 accept
+    EventLoop baseLoop;
+    TcpServer server(&baseLoop, InetAddress(kPort, true));
+    server.setNumThread(1);
+    server.setReusePort(true);
+    std::atomic<int> accepted(0);
+    server.setConnectionCallback([&accepted](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            accepted++;
+            conn->forceClose();
+        }
+    });
+    server.start();
+
+    InetAddress addr("127.0.0.1", kPort);
+    // 预热：服务器开始监听，对象池中积累空闲的连接对象
+    for (int i = 0; i < 1000; ++i) {
+        if (!connectOnce(addr)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::atomic<int> failed(0);
+    double cpuBegin = cpuSeconds();
+    auto begin = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < clients; ++t) {
+        int count = total / clients + (t < total % clients ? 1 : 0);
+        threads.emplace_back([&addr, &failed, count]() {
+            for (int i = 0; i < count; ++i) {
+                if (!connectOnce(addr)) failed++;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    double cpu = cpuSeconds() - cpuBegin;
+
+    std::cout << "连接数: " << total << "，客户端线程: " << clients
+              << "，失败: " << failed.load() << std::endl;
+    std::cout << "耗时: " << seconds << " s，速率: " << static_cast<long>(total / seconds)
+              << " 连接/s，平均 " << seconds * 1e6 / total << " us/连接" << std::endl;
+    std::cout << "CPU 占用: " << cpu / seconds * 100 << "%" << std::endl;
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * 跨线程投递任务的吞吐量测试
+ * 对比 EventLoop::queueInLoop（无锁 MPSC 队列 + 合并唤醒）与原先的 mutex + vector 方案
+ * （每次投递都加锁并写一次 eventfd）。
+ * 用法: post_benchmark [生产者线程数] [每个线程投递的任务数]
+ */
+#include "knetlib/EventLoop.h"
+#include "knetlib/Logger.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 原先的实现：投递时加锁 push_back，并且每次都写 eventfd；
+ * 消费线程阻塞在 eventfd 上，被唤醒后 swap 出整个 vector 执行
+ */
+class MutexTaskQueue {
+public:
+    using Task = std::function<void()>;
+
+    MutexTaskQueue()
+            : wakeupfd_(eventfd(0, EFD_CLOEXEC)),
+              quit_(false)
+    {}
+
+    ~MutexTaskQueue() {
+        close(wakeupfd_);
+    }
+
+    void loop() {
+        std::vector<Task> tasks;
+        while (!quit_) {
+            uint64_t one;
+            if (read(wakeupfd_, &one, sizeof(one)) != sizeof(one)) break;
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                tasks.swap(pendingTasks_);
+            }
+            for (auto& task : tasks) {
+                task();
+            }
+            tasks.clear();
+        }
+    }
+
+    void quit() {
+        queueInLoop([this]() { quit_ = true; });
+    }
+
+    void queueInLoop(Task&& task) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            pendingTasks_.push_back(std::move(task));
+        }
+        uint64_t one = 1;
+        if (write(wakeupfd_, &one, sizeof(one)) != sizeof(one)) {
+            SYSERR("MutexTaskQueue::queueInLoop() write");
+        }
+    }
+
+private:
+    const int wakeupfd_;
+    bool quit_;
+    std::mutex mutex_;
+    std::vector<Task> pendingTasks_;
+};
+
+// 启动 producers 个线程各投递 perThread 个任务，返回全部任务执行完毕所用的时间
+template <typename Queue>
+double runProducers(Queue& queue, int producers, int perThread) {
+    const long total = static_cast<long>(producers) * perThread;
+    std::atomic<long> done(0);
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            while (!start.load(std::memory_order_acquire)) {}
+            for (int i = 0; i < perThread; ++i) {
+                queue.queueInLoop([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    auto begin = Clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    while (done.load(std::memory_order_acquire) < total) {
+        std::this_thread::yield();
+    }
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+void report(const char* name, double seconds, long total) {
+    std::cout << name << ": " << total << " 个任务, 用时 " << seconds * 1000 << " ms, "
+              << static_cast<long>(total / seconds) << " 任务/秒" << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    setLogLevel(LOG_LEVEL::LOG_LEVEL_WARN);
+
+    int producers = 4;
+    int perThread = 250000;
+    if (argc > 1) {
+        producers = std::stoi(argv[1]);
+    }
+    if (argc > 2) {
+        perThread = std::stoi(argv[2]);
+    }
+    const long total = static_cast<long>(producers) * perThread;
+    std::cout << "生产者线程: " << producers << ", 每个线程投递: " << perThread << std::endl;
+
+    {
+        MutexTaskQueue queue;
+        std::thread consumer([&queue]() { queue.loop(); });
+        double seconds = runProducers(queue, producers, perThread);
+        queue.quit();
+        consumer.join();
+        report("mutex + vector", seconds, total);
+    }
+
+    {
+        EventLoop* loop = nullptr;
+        std::atomic<bool> ready(false);
+        std::thread consumer([&]() {
+            EventLoop threadLoop;
+            loop = &threadLoop;
+            ready = true;
+            threadLoop.loop();
+        });
+        while (!ready.load()) {
+            std::this_thread::yield();
+        }
+        double seconds = runProducers(*loop, producers, perThread);
+        loop->quit();
+        consumer.join();
+        report("EventLoop (MPSC)", seconds, total);
+    }
+    return 0;
+}
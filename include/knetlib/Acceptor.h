@@ -1,31 +1,81 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Channel.h"
 #include "Callbacks.h"
 
 class EventLoop;
+class IoUringPoller;
+
+// 批量 accept 得到的一个连接
+struct AcceptedSocket {
+    int sockfd;
+    InetAddress peer;
+};
+// 一次可读事件中 accept 到的全部连接，回调可以取走其中的元素
+using NewConnectionBatchCallback = std::function<void(const InetAddress& local, std::vector<AcceptedSocket>& sockets)>;
 
 class Acceptor: noncopyable {
 
 public:
-    Acceptor(EventLoop* loop, const InetAddress& local);
+    // reusePort 为 true 时设置 SO_REUSEPORT，多个 Acceptor 可以监听同一个地址，由内核分发连接
+    Acceptor(EventLoop* loop, const InetAddress& local, bool reusePort = false);
     ~Acceptor();
 
     bool listening() const;
+    // 实际绑定的地址，端口为 0 时是系统分配的端口
+    const InetAddress& local() const;
 
+    // 为整个 SO_REUSEPORT 组挂载 cBPF 程序：连接交给组内第 (当前 CPU % groupSize) 个 socket，
+    // 即处理网卡中断的 CPU 所对应的那个。只需在组内任意一个 socket 上调用一次
+    bool attachReusePortCpuSteering(int groupSize);
+
+    // 开始监听。loop 支持基于完成事件的收发时（见 EventLoop::completionPoller），改用多次触发的 accept 请求：
+    // 内核每 accept 一个连接产生一个完成事件，不再有可读通知和 accept4 调用；批量回调每次只带一个连接，
+    // 不受 setMaxAcceptsPerRead 限制
     void listen();
 
     void setNewConnectionCallback(const NewConnectionCallback& callback);
+    // 设置后每次可读事件只回调一次，代替逐个调用 NewConnectionCallback
+    void setNewConnectionBatchCallback(const NewConnectionBatchCallback& callback);
+    // 每次可读事件最多 accept 的连接数，直到 EAGAIN 为止，默认 1
+    void setMaxAcceptsPerRead(int n);
+
+    // 暂停/恢复 accept，暂停期间新连接留在内核的监听队列中。只能在 loop 线程中调用
+    void pauseAccepting();
+    void resumeAccepting();
+    bool accepting() const;
+
+    // 文件描述符耗尽时被直接关闭的连接数，可以在任意线程读取
+    uint64_t rejectedAccepts() const;
 
 private:
     void handleRead();
+    // 提交多次触发的 accept 请求
+    void startAccept();
+    void handleAcceptComplete(int res, bool more);
+    // 把 accept 到的连接交给回调
+    void newConnection(int sockfd, const InetAddress& peer);
+    // 借用预留的 fd accept 一个连接并立即关闭，没有预留 fd 时返回 false
+    bool rejectOne();
     
     bool listening_;
     EventLoop* loop_; // 指向的是主Reactor的EventLoop对象
     const int acceptfd_;
+    int idleFd_; // 预留的空闲 fd，描述符耗尽时关闭它来 accept 并立即关闭一个连接
     Channel acceptChannel_;
+    IoUringPoller* ring_;  // 使用完成请求时不为 nullptr
+    uint64_t acceptId_;    // 进行中的多次触发 accept 请求，0 表示没有
     InetAddress local_;
+    int maxAcceptsPerRead_;
+    bool paused_;
+    std::atomic<uint64_t> rejectedAccepts_;
+    std::vector<AcceptedSocket> accepted_; // 批量模式下本次 accept 到的连接，复用内存
     NewConnectionCallback newConnectionCallback_;
+    NewConnectionBatchCallback newConnectionBatchCallback_;
 };
@@ -1,44 +1,103 @@
 // muduo::Buffer
 #pragma once
 
-#include <vector>
 #include <algorithm>
 #include <string>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <endian.h>
+#include "ByteSearch.h"
 #if __cplusplus >= 201703L
 #include <string_view>
 #endif
 
+/**
+ * Buffer 存储的线程本地池。存储按大小分级，每级是 kCheapPrepend 加上 2 的幂（136B ~ 64KB + 8），
+ * 每个线程（即每个 EventLoop）每级一个空闲链表。存储可以在另一个线程中释放，直接进入该线程的链表；
+ * 每级缓存的空闲字节有上限，超出的部分以及大于最大级别的存储直接交还系统
+ */
+class BufferPool
+{
+public:
+    // 分配至少 *capacity 字节的存储，*capacity 被改为实际大小
+    static char *allocate(size_t *capacity);
+    static void deallocate(char *data, size_t capacity);
+    // 当前线程空闲链表中缓存的字节数
+    static size_t cachedBytes();
+};
+
 class Buffer
 {
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
 
+    // initialSize 为 0 时不分配存储，第一次写入（或 readFd）时才从 BufferPool 取
     explicit Buffer(size_t initialSize = kInitialSize)
-            : buffer_(kCheapPrepend + initialSize),
+            : data_(emptyStorage()),
+              capacity_(kCheapPrepend),
               readerIndex_(kCheapPrepend),
-              writerIndex_(kCheapPrepend)
+              writerIndex_(kCheapPrepend),
+              scanIndex_(kCheapPrepend)
     {
+        if (initialSize > 0) {
+            allocate(kCheapPrepend + initialSize);
+        }
         assert(readableBytes() == 0);
-        assert(writableBytes() == initialSize);
+        assert(writableBytes() >= initialSize);
         assert(prependableBytes() == kCheapPrepend);
     }
 
+    Buffer(const Buffer &rhs)
+            : Buffer(0)
+    {
+        append(rhs.peek(), rhs.readableBytes());
+    }
+
+    Buffer(Buffer &&rhs) noexcept
+            : Buffer(0)
+    { swap(rhs); }
+
+    Buffer &operator=(Buffer rhs) noexcept
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    ~Buffer()
+    { releaseStorage(); }
+
     void swap(Buffer &rhs)
     {
-        buffer_.swap(rhs.buffer_);
+        std::swap(data_, rhs.data_);
+        std::swap(capacity_, rhs.capacity_);
         std::swap(readerIndex_, rhs.readerIndex_);
         std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(scanIndex_, rhs.scanIndex_);
+    }
+
+    // 持有的存储大小，未分配时为 0
+    size_t capacity() const
+    { return data_ == emptyStorage() ? 0 : capacity_; }
+
+    // 把存储缩小到刚好容纳可读数据和 reserve 字节，突发流量过后把大块存储还给 BufferPool。
+    // 没有可读数据且 reserve 为 0 时释放全部存储，回到未分配状态
+    void shrink(size_t reserve)
+    {
+        Buffer other(0);
+        if (readableBytes() + reserve > 0) {
+            other.allocate(kCheapPrepend + readableBytes() + reserve);
+            other.append(peek(), readableBytes());
+        }
+        swap(other);
     }
 
     size_t readableBytes() const
     { return writerIndex_ - readerIndex_; }
 
     size_t writableBytes() const
-    { return buffer_.size() - writerIndex_; }
+    { return capacity_ - writerIndex_; }
 
     size_t prependableBytes() const
     { return readerIndex_; }
@@ -47,33 +106,65 @@ public:
     { return begin() + readerIndex_; }
 
     const char *findCRLF() const
-    {
-        const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-        return crlf == beginWrite() ? nullptr : crlf;
-    }
+    { return simd::findCRLF(peek(), beginWrite()); }
 
     const char *findCRLF(const char *start) const
     {
         assert(peek() <= start);
         assert(start <= beginWrite());
-        const char *crlf = std::search(start, beginWrite(), kCRLF, kCRLF + 2);
-        return crlf == beginWrite() ? nullptr : crlf;
+        return simd::findCRLF(start, beginWrite());
     }
 
     const char *findEOL() const
+    { return simd::findByte(peek(), beginWrite(), '\n'); }
+
+    const char *findEOL(const char *start) const
     {
-        const void *eol = memchr(peek(), '\n', readableBytes());
-        return static_cast<const char *>(eol);
+        assert(peek() <= start);
+        assert(start <= beginWrite());
+        return simd::findByte(start, beginWrite(), '\n');
     }
 
-    const char *findEOL(const char *start) const
+    // 第一个属于 set 的字节，用于同时查找多种分隔符
+    const char *findFirstOf(const ByteSet &set) const
+    { return simd::findFirstOf(peek(), beginWrite(), set); }
+
+    const char *findFirstOf(const char *start, const ByteSet &set) const
     {
         assert(peek() <= start);
         assert(start <= beginWrite());
-        const void *eol = memchr(start, '\n', beginWrite() - start);
-        return static_cast<const char *>(eol);
+        return simd::findFirstOf(start, beginWrite(), set);
+    }
+
+    // 可恢复的查找：从上次没有找到时停下的位置继续，数据分多次到达时每个字节只扫描一次。
+    // 找到时游标停在分隔符上，retrieve 越过游标后游标随之前移。
+    // 游标只记录一种分隔符的查找进度，换用另一种分隔符前需要调用 resetScan()
+    const char *scanCRLF()
+    {
+        const char *crlf = simd::findCRLF(scanStart(), beginWrite());
+        // 最后一个字节可能是 '\r'，下次从它开始
+        scanIndex_ = crlf != nullptr ? static_cast<size_t>(crlf - begin())
+                                     : std::max(writerIndex_ - 1, readerIndex_);
+        return crlf;
+    }
+
+    const char *scanEOL()
+    {
+        const char *eol = simd::findByte(scanStart(), beginWrite(), '\n');
+        scanIndex_ = eol != nullptr ? static_cast<size_t>(eol - begin()) : writerIndex_;
+        return eol;
+    }
+
+    const char *scanFirstOf(const ByteSet &set)
+    {
+        const char *found = simd::findFirstOf(scanStart(), beginWrite(), set);
+        scanIndex_ = found != nullptr ? static_cast<size_t>(found - begin()) : writerIndex_;
+        return found;
     }
 
+    void resetScan()
+    { scanIndex_ = readerIndex_; }
+
     void retrieve(size_t len)
     {
         assert(len <= readableBytes());
@@ -106,6 +197,7 @@ public:
     {
         readerIndex_ = kCheapPrepend;
         writerIndex_ = kCheapPrepend;
+        scanIndex_ = kCheapPrepend;
     }
 
     std::string retrieveAllAsString()
@@ -265,12 +357,17 @@ public:
     void prepend(const void *data, size_t len)
     {
         assert(len <= prependableBytes());
+        if (data_ == emptyStorage()) {
+            allocate(kCheapPrepend + kInitialSize);
+        }
         readerIndex_ -= len;
+        scanIndex_ = readerIndex_; // 前面插入了新数据，从头扫描
         auto d = static_cast<const char *>(data);
         std::copy(d, d + len, begin() + readerIndex_);
     }
 
-    ssize_t readFd(int fd, int *savedErrno);
+    // 一次 readv 最多读 maxBytes 字节
+    ssize_t readFd(int fd, int *savedErrno, size_t maxBytes = SIZE_MAX);
 
     // 兼容旧 API（将在阶段二重构时移除）
     const char* c_str() const { return peek(); }  // 注意：返回的字符串不是 null 结尾的
@@ -278,22 +375,58 @@ public:
     void clear() { retrieveAll(); }
 
 private:
+    // 未分配存储时 data_ 指向的共享区域，只有 kCheapPrepend 字节且永远不会被写入
+    static char *emptyStorage()
+    {
+        static char storage[kCheapPrepend];
+        return storage;
+    }
+
+    // 换成至少 capacity 字节的新存储，可读数据移到 kCheapPrepend 处
+    void allocate(size_t capacity)
+    {
+        char *data = BufferPool::allocate(&capacity);
+        size_t readable = readableBytes();
+        std::copy(peek(), peek() + readable, data + kCheapPrepend);
+        scanIndex_ = std::max(scanIndex_, readerIndex_) - readerIndex_ + kCheapPrepend;
+        releaseStorage();
+        data_ = data;
+        capacity_ = capacity;
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = readerIndex_ + readable;
+    }
+
+    void releaseStorage()
+    {
+        if (data_ != emptyStorage()) {
+            BufferPool::deallocate(data_, capacity_);
+            data_ = emptyStorage();
+            capacity_ = kCheapPrepend;
+        }
+    }
+
     char *begin()
-    { return &*buffer_.begin(); }
+    { return data_; }
 
     const char *begin() const
-    { return &*buffer_.begin(); }
+    { return data_; }
+
+    const char *scanStart() const
+    { return begin() + std::max(scanIndex_, readerIndex_); }
 
     void makeSpace(size_t len)
     {
         if (writableBytes() + prependableBytes() < len + kCheapPrepend) {
-            buffer_.resize(writerIndex_ + len);
+            // 数据部分至少翻倍，连续追加时均摊 O(1)，且正好落在 BufferPool 的下一级
+            size_t doubled = capacity() == 0 ? 0 : kCheapPrepend + 2 * (capacity_ - kCheapPrepend);
+            allocate(std::max(doubled, kCheapPrepend + readableBytes() + len));
         } else {
             assert(kCheapPrepend < readerIndex_);
             size_t readable = readableBytes();
             std::copy(begin() + readerIndex_,
                       begin() + writerIndex_,
                       begin() + kCheapPrepend);
+            scanIndex_ = std::max(scanIndex_, readerIndex_) - readerIndex_ + kCheapPrepend;
             readerIndex_ = kCheapPrepend;
             writerIndex_ = readerIndex_ + readable;
             assert(readable == readableBytes());
@@ -301,9 +434,11 @@ private:
     }
 
 private:
-    std::vector<char> buffer_;
+    char *data_;
+    size_t capacity_;
     size_t readerIndex_;
     size_t writerIndex_;
+    size_t scanIndex_;   // 可恢复查找的游标，小于 readerIndex_ 时视为 readerIndex_
 
     static const char kCRLF[];
 };
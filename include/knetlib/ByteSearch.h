@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * 要查找的字节集合，构造一次后反复使用。
+ * 不超过 kMaxVectorBytes 个字节时用向量比较，更多时逐字节查表
+ */
+class ByteSet {
+public:
+    static constexpr size_t kMaxVectorBytes = 16;
+
+    explicit ByteSet(std::string_view bytes);
+
+    bool contains(char c) const
+    { return (bitmap_[static_cast<unsigned char>(c) >> 6] >> (static_cast<unsigned char>(c) & 63)) & 1; }
+    size_t size() const
+    { return size_; }
+    const char* bytes() const
+    { return bytes_; }
+
+private:
+    size_t size_;
+    char bytes_[kMaxVectorBytes];
+    uint64_t bitmap_[4];
+};
+
+/**
+ * Buffer 和协议解析使用的查找函数，找不到时返回 nullptr。
+ * x86-64 上首次调用时按 CPU 选择 AVX2 或 SSE2 实现，其他平台使用标量实现
+ */
+namespace simd {
+
+// 单个字节：glibc 的 memchr 已经是向量化的，直接使用
+const char* findByte(const char* begin, const char* end, char c);
+// 第一个 "\r\n"，返回 '\r' 的位置
+const char* findCRLF(const char* begin, const char* end);
+// 第一个属于 set 的字节
+const char* findFirstOf(const char* begin, const char* end, const ByteSet& set);
+
+} // namespace simd
@@ -3,6 +3,8 @@
 #include <memory>
 #include <functional>
 
+#include "InplaceTask.h"
+
 class Buffer;
 class TcpConnection;
 class InetAddress;
@@ -16,7 +18,17 @@ using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t
 using MessageCallback = std::function<void(const TcpConnectionPtr&, Buffer&)>;
 using ErrorCallback = std::function<void()>;
 using NewConnectionCallback = std::function<void(int sockfd, const InetAddress& local, const InetAddress& peer)>;
-using Task = std::function<void()>;
+// EventLoop 投递的任务和定时器回调，只能移动，常见闭包不分配堆内存
+using Task = InplaceTask<void()>;
 using ThreadInitCallback = std::function<void(size_t)>;
+// 可拷贝的定时器回调，传给 runAt/runAfter/runEvery 时会被转换为 Task
 using TimerCallback = std::function<void()>;
 
+// 连接的事件回调。同一个服务器的连接共用一份，建立连接时只增加引用计数，不再逐个拷贝 std::function
+struct TcpConnectionCallbacks {
+    MessageCallback message;
+    WriteCompleteCallback writeComplete;
+    CloseCallback close;
+};
+using TcpConnectionCallbacksPtr = std::shared_ptr<const TcpConnectionCallbacks>;
+
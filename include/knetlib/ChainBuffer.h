@@ -0,0 +1,82 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "noncopyable.h"
+
+/**
+ * 分段式缓冲区：由若干固定大小的块串成链表，块从线程本地的块池中获取。
+ * 与 Buffer 不同，扩容时只在尾部追加新块，已有数据永远不会被 memmove，
+ * 适合承载多 MB 级别的大消息；readFd 直接 readv 进块内，不经过栈上 extrabuf。
+ * 数据在块之间不连续，peek() 只返回第一个块中的连续部分，可用 readableIovec()
+ * 获取完整的 iovec 视图配合 writev 使用。
+ * TcpConnection 只用它做输出缓冲区，输入缓冲区仍是连续的 Buffer。
+ */
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kBlockSize = 16 * 1024;
+    // readFd 一次最多读入的字节数（按块数计算）
+    static const size_t kMaxReadBlocks = 4;
+
+    ChainBuffer();
+    ~ChainBuffer();
+
+    void swap(ChainBuffer& rhs);
+
+    size_t readableBytes() const
+    { return readable_; }
+
+    size_t numBlocks() const
+    { return blocks_.size(); }
+
+    // 持有的块占用的字节数，读空后为 0
+    size_t capacity() const
+    { return blocks_.size() * kBlockSize; }
+
+    // 第一个块中可读数据的起始地址和连续长度
+    const char* peek() const;
+    size_t contiguousBytes() const;
+
+    // 跨块拷贝前 len 字节到 dst，不移动读指针，返回实际拷贝的字节数
+    size_t copyOut(void* dst, size_t len) const;
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAsString(size_t len);
+    std::string retrieveAllAsString()
+    { return retrieveAsString(readableBytes()); }
+
+    void append(const char* data, size_t len);
+    void append(const void* data, size_t len)
+    { append(static_cast<const char*>(data), len); }
+    void append(std::string_view data)
+    { append(data.data(), data.size()); }
+
+    // 填充可读数据的 iovec 视图，返回填充的个数
+    int readableIovec(struct iovec* iov, int maxIov) const;
+
+    ssize_t readFd(int fd, int* savedErrno);
+    // 最多写出 maxBytes 字节
+    ssize_t writeFd(int fd, int* savedErrno, size_t maxBytes = SIZE_MAX);
+
+private:
+    struct Block {
+        char* data;
+        size_t readerIndex;
+        size_t writerIndex;
+    };
+
+    void appendBlock();
+    void releaseFront();
+    void trimBack();
+
+    std::deque<Block> blocks_;
+    size_t readable_;
+};
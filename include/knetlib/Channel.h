@@ -42,20 +42,30 @@ public:
     bool isReading() const;
     bool isWriting() const;
 
+    // 边缘触发模式：注册时带上 EPOLLET，并且 EPOLLOUT 一直保持注册，
+    // enableWrite/disableWrite 只切换本地的写标记，不再产生 epoll_ctl。
+    // 回调需要自行读写到 EAGAIN，否则不会再收到事件
+    void useET();
+    bool isEdgeTriggered() const;
+
     // 兼容旧 API（将在阶段二重构时移除）
-    void useET();  // 启用边缘触发模式
     void setUseThreadPool(bool use = true);  // 已废弃，保留以兼容旧代码
 
 public:
-    bool pooling;  // 是否在 epoll 中
+    // 以下状态由 EventLoop 和 Poller 维护
+    bool pooling;              // 是否在 epoll 中
+    unsigned registeredEvents; // 已经提交给内核的事件
+    bool updatePending;        // 在 EventLoop 的待更新列表中，修改尚未交给 Poller
 
 private:
     EventLoop* loop_;
     int fd_;
     std::weak_ptr<void> tie_;
     bool tied_;
-    unsigned events_;
+    unsigned events_;   // 注册到 epoll 的事件
     unsigned revents_;
+    bool edgeTriggered_;
+    bool writing_;      // 是否关注可写事件，边缘触发时 events_ 中的 EPOLLOUT 不代表这个状态
     bool handlingEvents_;
 
     ReadCallback readCallback_;
@@ -1,28 +1,35 @@
 #pragma once
 
-#include "noncopyable.h"
+#include "Poller.h"
 #include <sys/epoll.h>
 #include <vector>
 
 class Channel;
 class EventLoop;
 
-class Epoll: noncopyable {
+// epoll 后端。Channel 的 registeredEvents 记录已经提交给内核的事件，与之相同的修改不调用 epoll_ctl。
+// 事件数组在填满时加倍，连续多次只用到不足四分之一时减半，不小于初始大小
+class Epoll: public Poller {
 
 public:
-    using ChannelList = std::vector<Channel*>;
-
     explicit Epoll(EventLoop* loop);
-    ~Epoll();
+    ~Epoll() override;
+
+    void poll(ChannelList& activeChannels, int timeout = -1) override;
+    void updateChannel(Channel* channel) override;
+    void removeChannel(Channel* channel) override;
 
-    void poll(ChannelList& activeChannels, int timeout = -1);
-    void updateChannel(Channel* channel);
-    void removeChannel(Channel* channel);
+    // 当前事件数组的大小
+    size_t eventListSize() const { return events_.size(); }
 
 private:
     void updateChannel(int op, Channel* channel);
+    // 根据本次返回的事件数扩大或缩小事件数组，capacity 为本次传给 epoll_wait 的上限
+    void adjustEventList(size_t nEvents, size_t capacity);
+
     EventLoop* loop_;
     std::vector<epoll_event> events_;
     int epollfd_;
+    int idlePolls_;  // 连续使用不足四分之一的 poll 次数
 
 };
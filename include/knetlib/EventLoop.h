@@ -1,66 +1,122 @@
 #pragma once
 
 #include "noncopyable.h"
+#include "Buffer.h"
 #include "Callbacks.h"
-#include "Epoll.h"
+#include "Poller.h"
 #include "TimerQueue.h"
 #include "Timestamp.h"
+#include "MpscQueue.h"
 #include <atomic>
-#include <mutex>
 #include <vector>
 
 class Channel;
-class Timer;
+class IoUringPoller;
+struct TaskNode;
 
 class EventLoop: noncopyable {
 
 public:
-    EventLoop();
+    // 共用读缓冲区的大小，一次 read 最多读取的字节数
+    static constexpr size_t kReadBufferSize = 64 * 1024;
+
+    explicit EventLoop(PollerBackend backend = PollerBackend::kEpoll);
     ~EventLoop();
     
     // 开启循环
     void loop();
-    // 退出循环
+    // 退出循环。在 loop() 开始之前调用时，loop() 会立即返回
     void quit();
 
+    // 忙轮询：最近一次处理事件或任务之后的 budget 时间内，以 0 超时轮询 epoll 和任务队列，
+    // 不让线程睡眠；超过 budget 没有活动才阻塞在 epoll_wait。以 CPU 换取更低的唤醒延迟，
+    // 0 表示关闭（默认）。只能在 loop 线程中调用
+    void setBusyPoll(Nanoseconds budget);
+
+    // 每轮循环最多处理 maxEvents 个就绪事件、执行 maxTasks 个任务，0 表示不限制（默认）。
+    // 多出的事件留在内核中、任务留在队列中，下一轮不阻塞直接处理。过载时每轮的工作量有上限，
+    // 定时器和唤醒不会被一大批事件或任务拖住。只能在 loop 线程中调用
+    void setIterationBudget(size_t maxEvents, size_t maxTasks);
+
     // 在当前loop中执行
-    void runInLoop(const Task& task);
     void runInLoop(Task&& task);
-    // 把任务放入队列中，唤醒loop所在的线程执行task
-    void queueInLoop(const Task& task);
+    // 把任务放入队列中，唤醒loop所在的线程执行task。入队无锁，同一轮循环内多次投递只写一次 eventfd
     void queueInLoop(Task&& task);
 
     // 定时器功能
-    Timer* runAt(Timestamp when, TimerCallback callback);
-    Timer* runAfter(Nanoseconds interval, TimerCallback callback);
-    Timer* runEvery(Nanoseconds interval, TimerCallback callback);
-    void cancelTimer(Timer* timer);
+    TimerId runAt(Timestamp when, Task callback);
+    TimerId runAfter(Nanoseconds interval, Task callback);
+    TimerId runEvery(Nanoseconds interval, Task callback);
+    // 定时器已经触发或已经取消时什么也不做
+    void cancelTimer(TimerId timerId);
+
+    // 已投递但尚未开始执行的任务数，可以在任意线程读取，只是一个近似值
+    size_t pendingTaskCount() const
+    { return pendingTaskCount_.load(std::memory_order_relaxed); }
 
     // 通过wakeupfd_/wakeupChannel_唤醒loop所在的线程
     void wakeup();
 
+    // 新增和删除监听立即交给 Poller；修改推迟到本轮循环结束、下一次等待之前统一提交，
+    // 同一轮内的多次修改只生效最后一次，与内核中一致的修改不会产生 epoll_ctl
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
 
+    // Channel 请求更新监听的次数和实际提交给内核的次数，差值为跳过或合并掉的 epoll_ctl。
+    // 可以在任意线程读取，只是一个近似值
+    uint64_t channelUpdateRequests() const { return channelUpdateRequests_.load(std::memory_order_relaxed); }
+    uint64_t pollerKernelUpdates() const { return poller_->kernelUpdates(); }
+
+    // io_uring 后端且内核支持基于完成事件的收发时返回它的 Poller，否则返回 nullptr。
+    // Acceptor 和 TcpConnection 据此改用多次触发的 accept/recv 和 send 请求，可以在任意线程读取
+    IoUringPoller* completionPoller() const { return completionPoller_; }
+
+    // 本 loop 上所有连接的输入、输出缓冲区持有的存储字节数，可以在任意线程读取，只是一个近似值
+    size_t connectionBufferBytes() const
+    { return connectionBufferBytes_.load(std::memory_order_relaxed); }
+    // 连接的缓冲区容量从 oldBytes 变为 newBytes 时由 TcpConnection 调用，连接可能在其他线程中析构
+    void updateConnectionBufferBytes(size_t oldBytes, size_t newBytes)
+    {
+        if (newBytes > oldBytes) connectionBufferBytes_.fetch_add(newBytes - oldBytes, std::memory_order_relaxed);
+        else connectionBufferBytes_.fetch_sub(oldBytes - newBytes, std::memory_order_relaxed);
+    }
+
+    // 本 loop 上的连接共用的读缓冲区（见 TcpConnection::setSharedReadBuffer），第一次使用时才分配。
+    // 只能在 loop 线程中使用，交出去之前必须清空
+    Buffer& readBuffer();
+
     // 判断EventLoop对象是否在自己的线程里。可能在别的线程中被调用
     void assertInLoopThread();
     void assertNotInLoopThread();
     bool isInLoopThread();
 
 private:
-    // 执行上层添加的任务
-    void doPendingTasks();
+    // 执行上层添加的任务，返回执行的任务数
+    size_t doPendingTasks();
+    void enqueueTask(TaskNode* node);
     // 与wakeupfd_/wakeupChannel_绑定的回调，构造EventLoop时绑定
     void handleRead();
+    // 把本轮推迟的监听修改交给 Poller
+    void applyPendingUpdates();
+    void cancelPendingUpdate(Channel* channel);
     // EventLoop对象创建时所在的线程，用以判断当前EventLoop对象是否在自身所属的线程中
     const pid_t tid_;
     std::atomic_bool quit_;
     std::atomic_bool doingPendingTasks_;
-    Epoll poller_;
-    Epoll::ChannelList activeChannels_;
+    std::unique_ptr<Poller> poller_;
+    IoUringPoller* completionPoller_;
+    Poller::ChannelList activeChannels_;
+    std::vector<Channel*> pendingUpdates_;  // 本轮修改过监听、尚未交给 Poller 的 Channel
+    std::atomic<uint64_t> channelUpdateRequests_;
+    std::atomic<size_t> connectionBufferBytes_;
     const int wakeupfd_;
     Channel* wakeupChannel_;
-    std::mutex mutex_;
-    std::vector<Task> pendingTasks_;
+    MpscQueue<TaskNode> pendingTasks_;
+    std::atomic<size_t> pendingTaskCount_;
+    std::vector<TaskNode*> runningTasks_; // doPendingTasks 本轮取出的任务，复用容量
+    std::atomic_bool wakeupPending_;      // 已写过 eventfd 且 loop 尚未开始处理任务
     TimerQueue timerQueue_;
+    Buffer readBuffer_;
+    Nanoseconds busyPollBudget_;
+    size_t maxTasksPerIteration_;
 };
@@ -5,12 +5,29 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <string>
+#include <vector>
 
 class EventLoopThread : noncopyable {
 public:
     EventLoopThread();
     ~EventLoopThread();
 
+    // 以下设置必须在 startLoop() 之前调用，在新线程创建 EventLoop 之前生效
+    // 线程名，通过 pthread_setname_np 设置，超过 15 个字符的部分被截断
+    void setName(const std::string& name);
+    // 把线程绑定到这组 CPU 上，为空表示不绑定
+    void setCpuAffinity(const std::vector<int>& cpus);
+    // 绑核后把线程的内存分配策略设为优先使用所在 CPU 的 NUMA 节点。
+    // EventLoop、连接及其缓冲区都在该线程中创建，内存会落在服务它的核所在的节点上
+    void setNumaLocal(bool on);
+    // EventLoop 的忙轮询时间，见 EventLoop::setBusyPoll
+    void setBusyPoll(Nanoseconds budget);
+    // EventLoop 每轮处理的事件数和任务数上限，见 EventLoop::setIterationBudget
+    void setIterationBudget(size_t maxEvents, size_t maxTasks);
+    // EventLoop 使用的多路复用后端，见 PollerBackend
+    void setPollerBackend(PollerBackend backend);
+
     // 启动线程并返回 EventLoop 指针
     // 线程安全，可以在任何线程调用
     EventLoop* startLoop();
@@ -21,11 +38,20 @@ public:
 private:
     // 线程函数
     void threadFunc();
+    // 在新线程开始时应用线程名、CPU 亲和性和 NUMA 策略
+    void setupThread();
 
     EventLoop* loop_;
     std::thread thread_;
     std::mutex mutex_;
     std::condition_variable cond_;
     bool exiting_;
+    std::string name_;
+    std::vector<int> cpus_;
+    bool numaLocal_;
+    Nanoseconds busyPollBudget_;
+    size_t maxEventsPerIteration_;
+    size_t maxTasksPerIteration_;
+    PollerBackend backend_;
 };
 
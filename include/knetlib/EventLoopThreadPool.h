@@ -2,10 +2,23 @@
 
 #include "noncopyable.h"
 #include "EventLoopThread.h"
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <string>
+#include <utility>
 
 class EventLoop;
+class InetAddress;
+
+// 新连接分配到哪个工作线程
+enum class LoadBalance {
+    kRoundRobin,        // 轮询（默认）
+    kLeastConnections,  // 当前连接数最少的线程
+    kLeastPendingTasks, // 任务队列中待执行任务最少的线程
+    kConsistentHash,    // 按对端 IP 一致性哈希，同一个客户端总是分配到同一个线程
+};
 
 class EventLoopThreadPool : noncopyable {
 public:
@@ -15,13 +28,42 @@ public:
     // 设置线程数量（不包括 baseLoop）
     // 必须在 start() 之前调用
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+
+    // 以下设置必须在 start() 之前调用
+    // 工作线程名为 prefix + 下标（从 0 开始）
+    void setThreadName(const std::string& prefix) { namePrefix_ = prefix; }
+    // 第 i 个工作线程绑定到 cpus[i % cpus.size()] 这一个 CPU
+    void setCpuAffinity(const std::vector<int>& cpus);
+    // 第 i 个工作线程绑定到 cpuSets[i % cpuSets.size()] 这组 CPU
+    void setCpuAffinity(const std::vector<std::vector<int>>& cpuSets) { cpuSets_ = cpuSets; }
+    // 工作线程的内存优先从所在 CPU 的 NUMA 节点分配，需配合 setCpuAffinity 使用
+    void setNumaLocal(bool on) { numaLocal_ = on; }
+    // 工作线程 EventLoop 的忙轮询时间，见 EventLoop::setBusyPoll
+    void setBusyPoll(Nanoseconds budget) { busyPollBudget_ = budget; }
+    // 工作线程 EventLoop 每轮处理的事件数和任务数上限，见 EventLoop::setIterationBudget
+    void setIterationBudget(size_t maxEvents, size_t maxTasks)
+    { maxEventsPerIteration_ = maxEvents; maxTasksPerIteration_ = maxTasks; }
+    // 工作线程 EventLoop 的多路复用后端，见 PollerBackend
+    void setPollerBackend(PollerBackend backend) { backend_ = backend; }
     
     // 启动线程池
     void start();
 
-    // 获取下一个 EventLoop（用于连接分配）
-    // 使用轮询算法
+    // 分配策略，必须在 start() 之前调用
+    void setLoadBalance(LoadBalance strategy) { strategy_ = strategy; }
+    LoadBalance loadBalance() const { return strategy_; }
+
+    // 获取下一个 EventLoop（用于连接分配），按分配策略选择，
+    // 一致性哈希没有对端地址可用，退化为轮询
     EventLoop* getNextLoop();
+    // 为来自 peer 的新连接选择 EventLoop
+    EventLoop* getNextLoop(const InetAddress& peer);
+
+    // 连接建立/关闭时更新所属 loop 的连接数，供 kLeastConnections 使用。可以在任意线程调用
+    void connectionOpened(EventLoop* loop);
+    void connectionClosed(EventLoop* loop);
+    // loop 上当前的连接数
+    size_t numConnections(EventLoop* loop) const;
 
     // 获取所有 EventLoop（包括 baseLoop）
     std::vector<EventLoop*> getAllLoops();
@@ -30,11 +72,30 @@ public:
     bool started() const { return started_; }
 
 private:
+    // 返回 loop 在 getAllLoops() 中的下标
+    size_t indexOf(EventLoop* loop) const;
+    EventLoop* roundRobin();
+    // 从轮询位置开始找 load 最小的工作线程，负载相同时依次轮换
+    template<typename Load>
+    EventLoop* leastLoaded(Load&& load);
+
     EventLoop* baseLoop_;  // 主线程的 EventLoop
     int numThreads_;      // 线程数量
     int next_;            // 下一个要使用的线程索引（用于轮询）
     bool started_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;  // 所有 EventLoop 的指针
+    LoadBalance strategy_;
+    std::string namePrefix_;
+    std::vector<std::vector<int>> cpuSets_;
+    bool numaLocal_;
+    Nanoseconds busyPollBudget_;
+    size_t maxEventsPerIteration_;
+    size_t maxTasksPerIteration_;
+    PollerBackend backend_;
+    // 每个 loop 的连接数，下标与 getAllLoops() 一致
+    std::unique_ptr<std::atomic<size_t>[]> connections_;
+    // 一致性哈希环：(虚拟节点哈希值, 工作线程下标)，按哈希值排序
+    std::vector<std::pair<uint64_t, size_t>> hashRing_;
 };
 
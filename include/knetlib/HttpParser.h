@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "HttpRequest.h"
+
+class Buffer;
+
+/**
+ * 增量式 HTTP/1.x 请求解析器，每个连接一个，直接在连接的输入缓冲区上解析：
+ * - 记录已经扫描过的位置，请求分多次到达时只扫描新到的数据；
+ * - 一次只解析缓冲区开头的一个请求，处理完后调用 retrieveRequest 取走，即可继续解析流水线上的下一个；
+ * - 支持 Content-Length 和 chunked 请求体，chunked 数据块在缓冲区中就地拼接，请求体始终是连续的一段。
+ * 同时出现 Content-Length 和 Transfer-Encoding 的请求按错误处理，避免请求走私
+ */
+class HttpParser {
+public:
+    enum Result { kComplete, kIncomplete, kError };
+
+    static constexpr size_t kDefaultMaxHeaderSize = 16 * 1024;
+    static constexpr size_t kDefaultMaxBodySize = 1024 * 1024;
+
+    explicit HttpParser(size_t maxHeaderSize = kDefaultMaxHeaderSize,
+                        size_t maxBodySize = kDefaultMaxBodySize);
+
+    // 从 buffer.peek() 开始解析一个请求。kComplete 时 request() 中的视图指向 buffer，
+    // 在 retrieveRequest 之前有效；kError 时 errorStatus() 为应答的状态码，连接应当关闭
+    Result parse(Buffer& buffer);
+
+    const HttpRequest& request() const
+    { return request_; }
+    int errorStatus() const
+    { return errorStatus_; }
+    // 从 buffer 中取走已经处理完的请求，并准备解析下一个
+    void retrieveRequest(Buffer& buffer);
+    void reset();
+
+private:
+    enum State {
+        kHeaders,     // 等待头部结束的空行
+        kBody,        // 按 Content-Length 等待请求体
+        kChunkSize,   // 等待数据块大小行
+        kChunkData,   // 接收数据块
+        kChunkEnd,    // 数据块之后的 CRLF
+        kTrailers,    // 最后一个数据块之后的尾部字段
+        kDone,
+    };
+
+    // 解析请求行和头部，[begin, end) 以空行结束
+    bool parseHeaders(const char* begin, const char* end);
+    Result fail(int status);
+
+    const size_t maxHeaderSize_;
+    const size_t maxBodySize_;
+    State state_;
+    size_t scanned_;        // 相对 peek() 的偏移，之前的数据已经扫描过
+    size_t headerLength_;
+    uint64_t contentLength_;
+    uint64_t chunkRemain_;
+    size_t bodyEnd_;        // chunked 时已解码的请求体末尾（相对 peek() 的偏移）
+    bool reparse_;          // 头部解析后缓冲区可能搬移过，完成时需要重新生成视图
+    int errorStatus_;
+    HttpRequest request_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+/**
+ * 解析出的 HTTP 请求。所有字段都是指向连接输入缓冲区的 string_view，不拷贝、不分配内存，
+ * 只在 HttpServer 的回调返回前有效，需要保存时由调用方自行拷贝
+ */
+class HttpRequest {
+public:
+    static constexpr size_t kMaxHeaders = 64;
+
+    std::string_view method() const
+    { return method_; }
+    // 请求目标中 '?' 之前的部分
+    std::string_view path() const
+    { return path_; }
+    // '?' 之后的部分，不含 '?'
+    std::string_view query() const
+    { return query_; }
+    // HTTP/1.x 中的 x
+    int versionMinor() const
+    { return versionMinor_; }
+    // chunked 编码的请求体已经在缓冲区中就地解码为连续的一段
+    std::string_view body() const
+    { return body_; }
+    // 按照版本和 Connection 头判断是否保持连接
+    bool keepAlive() const
+    { return keepAlive_; }
+    bool isHead() const
+    { return method_ == "HEAD"; }
+
+    std::span<const HttpHeader> headers() const
+    { return std::span<const HttpHeader>(headers_.data(), numHeaders_); }
+    // 按名称查找头部（不区分大小写），不存在时返回空
+    std::string_view header(std::string_view name) const;
+
+private:
+    friend class HttpParser;
+
+    std::string_view method_;
+    std::string_view path_;
+    std::string_view query_;
+    std::string_view body_;
+    int versionMinor_ = 1;
+    bool keepAlive_ = true;
+    size_t numHeaders_ = 0;
+    std::array<HttpHeader, kMaxHeaders> headers_;
+};
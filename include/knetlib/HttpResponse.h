@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string_view>
+
+#include "noncopyable.h"
+
+class Buffer;
+class HttpRequest;
+
+/**
+ * HTTP 应答，直接按顺序写入连接的输出缓冲区，不拼接临时字符串：
+ * 第一次 addHeader 或 setBody 时写入预先格式化好的状态行、Date 和 Server 头
+ * （Date 每个线程每秒格式化一次），setBody 写入 Connection、Content-Length 和应答体。
+ * 因此 setStatus 必须在 addHeader/setBody 之前调用，setBody 之后不能再修改应答
+ */
+class HttpResponse : noncopyable {
+public:
+    enum StatusCode {
+        k200Ok = 200,
+        k201Created = 201,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k302Found = 302,
+        k304NotModified = 304,
+        k400BadRequest = 400,
+        k403Forbidden = 403,
+        k404NotFound = 404,
+        k405MethodNotAllowed = 405,
+        k413PayloadTooLarge = 413,
+        k431RequestHeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+        k503ServiceUnavailable = 503,
+        k505VersionNotSupported = 505,
+    };
+
+    // 对 request 的应答，连接是否保持、是否为 HEAD 请求由 request 决定
+    HttpResponse(Buffer* output, const HttpRequest& request);
+    // 请求无法解析时的错误应答，发送后关闭连接
+    HttpResponse(Buffer* output, StatusCode status);
+
+    void setStatus(StatusCode status);
+    StatusCode status() const
+    { return status_; }
+    void addHeader(std::string_view name, std::string_view value);
+    void setContentType(std::string_view type)
+    { addHeader("Content-Type", type); }
+    // 发送后关闭连接，必须在 setBody 之前调用
+    void setCloseConnection(bool on);
+    bool closeConnection() const
+    { return close_; }
+    // 写入应答体并结束应答，HEAD 请求只写 Content-Length
+    void setBody(std::string_view body);
+
+    // 回调没有调用 setBody 时以空的应答体结束应答
+    void finish();
+    bool finished() const
+    { return finished_; }
+
+private:
+    // 写入状态行和公共头部
+    void writeStatusLine();
+
+    Buffer* output_;
+    StatusCode status_;
+    bool close_;
+    bool http10_;       // HTTP/1.0 的长连接需要显式的 Connection: keep-alive
+    bool headRequest_;
+    bool started_;
+    bool finished_;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "TcpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+class Buffer;
+
+/**
+ * 基于 TcpServer 的 HTTP/1.1 服务器。每个连接有一个 HttpParser 和一个输出缓冲区，
+ * 稳定运行时解析和应答都不分配内存：
+ * - 请求直接在输入缓冲区上增量解析，头部、请求体都是 string_view；
+ * - 一次可读事件中流水线上的所有请求依次处理，应答写入同一个输出缓冲区，最后只 send 一次；
+ * - 支持长连接（HTTP/1.0 需要 Connection: keep-alive）和 chunked 请求体；
+ * - 无法解析的请求回复对应的错误码后关闭连接
+ */
+class HttpServer : noncopyable {
+public:
+    // 在连接所属的 IO 线程中调用，回调返回前 request 中的视图有效
+    using HttpCallback = std::function<void(const HttpRequest&, HttpResponse&)>;
+
+    HttpServer(EventLoop* loop, const InetAddress& local);
+
+    // 底层的 TcpServer，用来设置线程数、SO_REUSEPORT、边缘触发等选项
+    TcpServer& tcpServer()
+    { return server_; }
+    // 必须在 start() 之前调用
+    void setNumThread(size_t n)
+    { server_.setNumThread(n); }
+    void setHttpCallback(const HttpCallback& callback)
+    { httpCallback_ = callback; }
+    // 头部和请求体的大小上限，超过时回复 431/413 并关闭连接。必须在 start() 之前调用
+    void setMaxHeaderSize(size_t n)
+    { maxHeaderSize_ = n; }
+    void setMaxBodySize(size_t n)
+    { maxBodySize_ = n; }
+
+    void start();
+
+private:
+    void onConnection(const TcpConnectionPtr& conn);
+    void onMessage(const TcpConnectionPtr& conn, Buffer& buffer);
+
+    TcpServer server_;
+    size_t maxHeaderSize_;
+    size_t maxBodySize_;
+    HttpCallback httpCallback_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "TimerId.h"
+
+class EventLoop;
+class TcpConnection;
+
+/**
+ * 连接空闲超时的分桶时间轮，每个 EventLoop 一个，由该 loop 线程独占使用。
+ * 超时时间被均分为 kBuckets 个 tick，轮上共 kBuckets + 1 个桶，每个桶是连接的侵入式双向链表。
+ * 连接有读写时只需把自己移到当前桶（已经在当前桶里时什么也不做），O(1) 且不分配内存，
+ * 也不会重新设置 timerfd；整个轮只有一个每 tick 触发一次的重复定时器，
+ * 每次转到下一个桶时，桶里的连接已经空闲了至少 timeout，统一关闭。
+ * 连接实际被关闭的时刻在 timeout 到 timeout * (1 + 1/kBuckets) 之间
+ */
+class IdleTimeoutWheel : noncopyable {
+public:
+    static constexpr int kBuckets = 16;
+
+    // 嵌在 TcpConnection 中的链表节点
+    struct Entry {
+        Entry* prev = nullptr;
+        Entry* next = nullptr;
+        int bucket = -1; // -1 表示不在轮上
+        TcpConnection* conn = nullptr;
+    };
+
+    IdleTimeoutWheel(EventLoop* loop, Nanoseconds timeout);
+    ~IdleTimeoutWheel();
+
+    Nanoseconds timeout() const
+    { return timeout_; }
+    size_t size() const
+    { return size_; }
+
+    void add(Entry* entry);
+    // 连接有活动，移到当前桶
+    void touch(Entry* entry);
+    void remove(Entry* entry);
+
+private:
+    static constexpr int kNumSlots = kBuckets + 1;
+
+    void onTick();
+    void link(Entry* entry, int bucket);
+    void unlink(Entry* entry);
+
+    EventLoop* loop_;
+    const Nanoseconds timeout_;
+    TimerId timer_;
+    Entry* buckets_[kNumSlots];
+    int current_;
+    size_t size_;
+};
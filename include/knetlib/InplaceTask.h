@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "noncopyable.h"
+
+template <typename Signature, size_t Capacity = 64>
+class InplaceTask;
+
+/**
+ * 只能移动的可调用对象包装，作用与 std::function 类似。
+ * 不超过 Capacity 字节、且移动构造不抛异常的闭包直接存放在对象内部，构造和移动都不分配内存；
+ * 更大的闭包才退化为在堆上分配。典型的 [shared_ptr, string] 闭包约 48 字节，可以放进默认的 64 字节。
+ * 因为不要求可拷贝，可以捕获 unique_ptr 等只能移动的对象
+ */
+template <typename R, typename... Args, size_t Capacity>
+class InplaceTask<R(Args...), Capacity> : noncopyable {
+public:
+    InplaceTask() noexcept = default;
+    InplaceTask(std::nullptr_t) noexcept {}
+
+    template <typename F,
+              typename D = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same_v<D, InplaceTask> &&
+                                          std::is_invocable_r_v<R, D&, Args...>>>
+    InplaceTask(F&& f) {
+        // 空的函数指针或 std::function 视为空任务，与 std::function 的行为一致
+        if (isNull(f)) return;
+        if constexpr (kStoredInline<D>) {
+            ::new (static_cast<void*>(storage_)) D(std::forward<F>(f));
+            vtable_ = &kInlineVTable<D>;
+        }
+        else {
+            ::new (static_cast<void*>(storage_)) D*(new D(std::forward<F>(f)));
+            vtable_ = &kHeapVTable<D>;
+        }
+    }
+
+    InplaceTask(InplaceTask&& rhs) noexcept {
+        moveFrom(rhs);
+    }
+
+    InplaceTask& operator=(InplaceTask&& rhs) noexcept {
+        if (this != &rhs) {
+            reset();
+            moveFrom(rhs);
+        }
+        return *this;
+    }
+
+    InplaceTask& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    ~InplaceTask() {
+        reset();
+    }
+
+    explicit operator bool() const noexcept {
+        return vtable_ != nullptr;
+    }
+
+    R operator()(Args... args) {
+        assert(vtable_ != nullptr && "InplaceTask is empty");
+        return vtable_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+    // 闭包是否存放在对象内部，用于测试和调优 Capacity
+    bool storedInline() const noexcept {
+        return vtable_ != nullptr && vtable_->inlined;
+    }
+
+private:
+    struct VTable {
+        R (*invoke)(void* storage, Args&&... args);
+        // 把 src 中的闭包移动到 dst，并销毁 src 中的闭包
+        void (*relocate)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+        bool inlined;
+    };
+
+    template <typename D>
+    static constexpr bool kStoredInline =
+        sizeof(D) <= Capacity &&
+        alignof(D) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<D>;
+
+    template <typename D>
+    static constexpr VTable kInlineVTable = {
+        [](void* storage, Args&&... args) -> R {
+            return std::invoke(*static_cast<D*>(storage), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) noexcept {
+            D* from = static_cast<D*>(src);
+            ::new (dst) D(std::move(*from));
+            from->~D();
+        },
+        [](void* storage) noexcept {
+            static_cast<D*>(storage)->~D();
+        },
+        true
+    };
+
+    template <typename D>
+    static constexpr VTable kHeapVTable = {
+        [](void* storage, Args&&... args) -> R {
+            return std::invoke(**static_cast<D**>(storage), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) D*(*static_cast<D**>(src));
+        },
+        [](void* storage) noexcept {
+            delete *static_cast<D**>(storage);
+        },
+        false
+    };
+
+    template <typename F>
+    static bool isNull(const F& f) {
+        if constexpr (std::is_pointer_v<F> || std::is_member_pointer_v<F>) {
+            return f == nullptr;
+        }
+        else if constexpr (std::is_same_v<F, std::function<R(Args...)>>) {
+            return !f;
+        }
+        else return false;
+    }
+
+    void moveFrom(InplaceTask& rhs) noexcept {
+        if (rhs.vtable_ != nullptr) {
+            rhs.vtable_->relocate(storage_, rhs.storage_);
+            vtable_ = rhs.vtable_;
+            rhs.vtable_ = nullptr;
+        }
+    }
+
+    void reset() noexcept {
+        if (vtable_ != nullptr) {
+            vtable_->destroy(storage_);
+            vtable_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[Capacity];
+    const VTable* vtable_ = nullptr;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Poller.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct iovec;
+
+/**
+ * 基于 io_uring 的 Poller，不依赖 liburing，直接使用 io_uring_setup/io_uring_enter 系统调用。
+ * 每个 Channel 的监听是一个 IORING_OP_POLL_ADD 请求：
+ * - 水平触发的 Channel 使用单次 poll，事件处理完后在下一次 poll() 时重新提交，
+ *   重新提交时内核会检查当前状态，与 epoll 的水平触发语义一致；
+ * - 设置了 EPOLLET 的 Channel 使用多次触发的 poll（IORING_POLL_ADD_MULTI），只在状态变化时产生事件。
+ * 添加、修改、删除监听都只是往提交队列里写 SQE，和等待事件合并成一次 io_uring_enter，
+ * 不再有 epoll_ctl 系统调用。
+ *
+ * 内核支持时（6.0 以上）还提供基于完成事件的收发：多次触发的 accept 和 recv、sendmsg，
+ * recv 的数据由内核直接收进提供给 io_uring 的接收缓冲区组，不再是就绪通知之后再各自调用一次
+ * accept4/readv/writev。Acceptor 和 TcpConnection 在这样的 loop 上自动改用这些请求，
+ * Channel 和 TcpConnection 的回调约定不变
+ */
+class IoUringPoller : public Poller {
+public:
+    // 接收缓冲区组中每个缓冲区的大小和个数，本 loop 上所有多次触发的 recv 共用
+    static constexpr size_t kRecvBufferSize = 16 * 1024;
+    static constexpr unsigned kRecvBufferCount = 128;
+    // 一个 send 请求最多携带的 iovec 个数
+    static constexpr int kMaxSendIov = 64;
+
+    // 完成事件的回调。res 为 CQE 的结果，负数为 -errno；more 为 false 表示请求已经结束，之后不会再回调
+    using AcceptCallback = std::function<void(int res, bool more)>;
+    // data 指向接收缓冲区组中的缓冲区，只在回调期间有效，回调返回后缓冲区归还内核
+    using RecvCallback = std::function<void(const char* data, int res, bool more)>;
+    using SendCallback = std::function<void(int res)>;
+
+    // 内核不支持（< 5.13）或被禁用时返回 nullptr
+    static std::unique_ptr<IoUringPoller> create(EventLoop* loop);
+    ~IoUringPoller() override;
+
+    void poll(ChannelList& activeChannels, int timeout = -1) override;
+    void updateChannel(Channel* channel) override;
+    void removeChannel(Channel* channel) override;
+
+    // 内核支持多次触发的 accept/recv 时为 true，否则只能用 poll 请求等待就绪
+    bool completionIo() const { return completionIo_; }
+
+    // 以下请求都只是写入提交队列，和等待事件一起提交，返回请求 id。只能在 completionIo() 为 true 时使用，
+    // 回调在 poll() 中、本轮就绪的 Channel 处理之前执行
+
+    // 多次触发的 accept：每个新连接（已设置 SOCK_NONBLOCK | SOCK_CLOEXEC）回调一次，res 为连接的 fd
+    uint64_t acceptMultishot(int listenfd, AcceptCallback callback);
+    // 多次触发的 recv：res 为收到的字节数，0 表示对端关闭。接收缓冲区暂时用完时请求以 -ENOBUFS 结束
+    uint64_t recvMultishot(int fd, RecvCallback callback);
+    // sendmsg：iov 数组本身会被复制，它指向的数据在回调之前必须保持有效，res 为发出的字节数
+    uint64_t send(int fd, const struct iovec* iov, int iovcnt, SendCallback callback);
+    // 取消请求，请求结束时仍会回调一次（通常 res 为 -ECANCELED），回调之前请求引用的内存必须保持有效
+    void cancel(uint64_t id);
+    // 取消请求并丢弃回调，用于回调引用的对象马上要销毁的场合；之后 accept 到的连接直接关闭。
+    // send 请求引用调用方的内存，不能这样取消
+    void cancelAndForget(uint64_t id);
+
+    // 已提交的完成请求数和收到的完成事件数，只在 loop 线程中更新，可以在任意线程读取近似值
+    uint64_t completionRequests() const { return completionRequests_.load(std::memory_order_relaxed); }
+    uint64_t completionEvents() const { return completionEvents_.load(std::memory_order_relaxed); }
+
+private:
+    struct Operation;
+
+    // 一个 Channel 当前的 poll 请求，id 作为 user_data，Channel 修改监听时换新的 id，
+    // 旧请求的完成事件查不到 id 就被忽略，所以 Channel 删除后不会收到迟到的事件
+    struct Registration {
+        uint64_t id;
+        unsigned events;
+        bool armed;     // 请求在内核中尚未完成
+    };
+
+    IoUringPoller(EventLoop* loop, int ringfd);
+    bool setupRings(const void* params);
+    // 检查内核是否支持完成请求，支持时分配接收缓冲区并全部提供给内核
+    bool setupCompletionIo();
+    // 把 [bid, bid + count) 的接收缓冲区提供给内核
+    void provideRecvBuffers(unsigned bid, unsigned count);
+    // 本轮用完的接收缓冲区按连续的编号合并，每一段一个 SQE 归还内核
+    void returnRecvBuffers();
+    uint64_t submitOperation(Operation* op, io_uring_sqe* sqe);
+    // 处理一个完成请求的 CQE，请求结束时回收 Operation
+    void complete(uint64_t id, int res, unsigned flags);
+
+    // 为 channel 提交新的 poll 请求
+    void arm(Channel* channel, Registration& registration);
+    // 取消 channel 当前的 poll 请求并注销其 id
+    void disarm(Registration& registration);
+    io_uring_sqe* nextSqe();
+    // 提交已准备好的 SQE，minComplete > 0 时等待至少这么多个完成事件
+    void enter(unsigned minComplete, int timeout);
+
+    EventLoop* loop_;
+    int ringfd_;
+
+    // 映射的 SQ/CQ 环
+    void* sqRing_;
+    size_t sqRingSize_;
+    void* cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    unsigned sqLocalTail_;  // 已准备但尚未发布给内核的 SQE 的尾部
+    unsigned toSubmit_;     // 已准备、尚未提交的 SQE 个数
+    uint64_t nextId_;
+    std::unordered_map<Channel*, Registration> registrations_;
+    std::unordered_map<uint64_t, Channel*> channels_;  // 有效的请求 id -> Channel
+    std::vector<uint64_t> rearm_;                       // 上一轮触发的单次 poll 的 id，需要重新提交
+
+    // 本次 poll() 从 CQ 中取出的事件，CQ 头部推进之后再处理
+    struct Completion {
+        uint64_t id;
+        int res;
+        unsigned flags;
+    };
+    std::vector<Completion> completions_;
+    std::unordered_map<uint64_t, Operation*> operations_;  // 未结束的完成请求
+    bool completionIo_;
+    char* recvBuffers_;                      // kRecvBufferCount 个接收缓冲区
+    std::vector<uint16_t> returnedBuffers_;  // 本轮回调用完、等待归还内核的接收缓冲区
+    std::atomic<uint64_t> completionRequests_{0};
+    std::atomic<uint64_t> completionEvents_{0};
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Buffer.h"
+
+/**
+ * 长度字段分帧编解码器，帧格式为：
+ *   [lengthFieldOffset 字节的前缀][lengthFieldSize 字节的长度][负载]
+ * 长度字段是负载的字节数（不含帧头），支持 1/2/4/8 字节、大端或小端。
+ * 前缀由协议自行定义（例如魔数、消息类型），编解码器原样收发，不做解释。
+ *
+ * 解码：把 onMessage 设置为连接的 MessageCallback，每收齐一帧就以指向输入缓冲区的
+ * string_view 调用 FrameCallback，不拷贝负载；string_view 只在回调返回前有效。
+ * 编码：send(conn, Buffer&) 把帧头写进 Buffer 头部的 kCheapPrepend 预留空间，
+ * 负载不移动也不拷贝；send(conn, string_view) 用 writev 把帧头和负载一起发送
+ */
+class LengthFieldCodec : noncopyable {
+public:
+    enum ByteOrder { kBigEndian, kLittleEndian };
+
+    // 收到一帧完整的负载
+    using FrameCallback = std::function<void(const TcpConnectionPtr&, std::string_view)>;
+
+    static constexpr size_t kDefaultMaxFrameSize = 4 * 1024 * 1024;
+    // 半帧时最多按帧长预留这么多空间，帧头中的长度由对端决定，不能照单全收
+    static constexpr size_t kMaxReserveBytes = 64 * 1024;
+
+    // lengthFieldSize 只能是 1/2/4/8；负载超过 maxFrameSize 的帧视为协议错误
+    explicit LengthFieldCodec(const FrameCallback& callback,
+                              int lengthFieldSize = 4,
+                              ByteOrder byteOrder = kBigEndian,
+                              size_t maxFrameSize = kDefaultMaxFrameSize,
+                              size_t lengthFieldOffset = 0);
+
+    // 作为 MessageCallback 使用：
+    //   server.setMessageCallback(std::bind(&LengthFieldCodec::onMessage, &codec, _1, _2));
+    // 收到超过上限的帧时记录错误并关闭连接，缓冲区中剩余的数据被丢弃
+    void onMessage(const TcpConnectionPtr& conn, Buffer& buffer);
+
+    // 把 payload 中的全部可读数据作为一帧发送，发送后 payload 被清空。
+    // prefix 的长度必须等于 lengthFieldOffset；帧头放得进 payload 的预留空间时不产生额外拷贝
+    void send(const TcpConnectionPtr& conn, Buffer& payload, std::string_view prefix = {});
+    void send(const TcpConnectionPtr& conn, std::string_view payload, std::string_view prefix = {});
+
+    // 帧头（前缀 + 长度字段）的字节数
+    size_t headerLength() const
+    { return lengthFieldOffset_ + static_cast<size_t>(lengthFieldSize_); }
+    // FrameCallback 中取得该帧的前缀，负载前面就是帧头
+    std::string_view prefix(std::string_view payload) const
+    { return std::string_view(payload.data() - headerLength(), lengthFieldOffset_); }
+
+private:
+    // 负载长度能否用长度字段表示且不超过上限
+    bool checkLength(size_t length) const;
+    uint64_t decodeLength(const char* data) const;
+    void encodeLength(uint64_t length, char* data) const;
+    // 把帧头写入 header，返回帧头长度；长度不合法时返回 0
+    size_t encodeHeader(size_t length, std::string_view prefix, char* header) const;
+
+    FrameCallback frameCallback_;
+    const int lengthFieldSize_;
+    const ByteOrder byteOrder_;
+    const size_t maxFrameSize_;
+    const size_t lengthFieldOffset_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+
+#include "noncopyable.h"
+
+// 侵入式队列节点，需要入队的类型继承它即可，入队不需要额外分配内存
+struct MpscNode {
+    std::atomic<MpscNode*> mpscNext{nullptr};
+};
+
+/**
+ * 侵入式无锁多生产者单消费者队列（Dmitry Vyukov 算法）
+ * push 可以在任意线程调用，一次 exchange 加一次 store，不加锁；pop 只能由唯一的消费者线程调用。
+ * 生产者在 exchange 之后、链接 next 之前被打断时，pop 会暂时返回 nullptr，
+ * 调用方需要有其他机制（比如再投递一次消费任务）保证之后还会再来取。
+ * 节点从 push 到被 pop 出来之前必须保持有效，且不能重复入队。
+ */
+template <typename T>
+class MpscQueue : noncopyable {
+public:
+    MpscQueue()
+            : head_(&stub_),
+              tail_(&stub_)
+    {}
+
+    void push(T* node) {
+        pushNode(static_cast<MpscNode*>(node));
+    }
+
+    T* pop() {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->mpscNext.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (next == nullptr) return nullptr;
+            tail_ = next;
+            tail = next;
+            next = next->mpscNext.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        // tail 是最后一个节点，若 head 不等于 tail，说明有生产者正在入队
+        if (tail != head_.load(std::memory_order_acquire)) return nullptr;
+        // 把 stub 放回队尾，这样 tail 才能被取出
+        pushNode(&stub_);
+        next = tail->mpscNext.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<T*>(tail);
+        }
+        return nullptr;
+    }
+
+    // 只在消费者线程中调用才有意义，结果可能因并发 push 立即过期
+    bool empty() const {
+        return tail_ == &stub_ && stub_.mpscNext.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    void pushNode(MpscNode* node) {
+        node->mpscNext.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->mpscNext.store(node, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<MpscNode*> head_; // 生产者端，与消费者端分开缓存行，避免伪共享
+    alignas(64) MpscNode* tail_;              // 消费者端
+    MpscNode stub_;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * 跨线程复用的对象池。对象经常在一个线程取出、在另一个线程归还（比如生产者投递、loop 线程回收），
+ * 单纯的线程本地缓存无法回收。每个线程先用本地缓存，缓存空了或攒多了再与全局仓库整批交换，
+ * 锁的开销按批摊销到每个对象上。
+ * 归还的对象不会被析构，再次取出时保留上次的状态（比如 string 的容量），由调用方负责重置
+ */
+template <typename T>
+class ObjectPool {
+public:
+    static constexpr size_t kBatchSize = 32;
+    static constexpr size_t kMaxDepotObjects = 4096;
+
+    static T* acquire() {
+        return t_cache_.get();
+    }
+
+    static void release(T* obj) {
+        t_cache_.put(obj);
+    }
+
+private:
+    class Depot {
+    public:
+        ~Depot() {
+            for (T* obj : objects_) {
+                delete obj;
+            }
+        }
+
+        void fetch(std::vector<T*>& out) {
+            std::lock_guard<std::mutex> guard(mutex_);
+            size_t n = std::min(kBatchSize, objects_.size());
+            out.insert(out.end(), objects_.end() - n, objects_.end());
+            objects_.resize(objects_.size() - n);
+        }
+
+        // 把 in 尾部的 n 个对象交给仓库，仓库满了就直接释放
+        void put(std::vector<T*>& in, size_t n) {
+            std::lock_guard<std::mutex> guard(mutex_);
+            for (size_t i = 0; i < n; ++i) {
+                if (objects_.size() < kMaxDepotObjects) objects_.push_back(in.back());
+                else delete in.back();
+                in.pop_back();
+            }
+        }
+
+    private:
+        std::mutex mutex_;
+        std::vector<T*> objects_;
+    };
+
+    class Cache {
+    public:
+        ~Cache() {
+            depot_.put(objects_, objects_.size());
+        }
+
+        T* get() {
+            if (objects_.empty()) {
+                depot_.fetch(objects_);
+                if (objects_.empty()) return new T;
+            }
+            T* obj = objects_.back();
+            objects_.pop_back();
+            return obj;
+        }
+
+        void put(T* obj) {
+            objects_.push_back(obj);
+            if (objects_.size() >= 2 * kBatchSize) {
+                depot_.put(objects_, kBatchSize);
+            }
+        }
+
+    private:
+        std::vector<T*> objects_;
+    };
+
+    // 线程退出时本地缓存整体归还仓库；thread_local 先于静态对象析构，仓库此时仍然有效
+    static inline Depot depot_;
+    static inline thread_local Cache t_cache_;
+};
+
+/**
+ * 从 ObjectPool 取内存的分配器，用于 std::allocate_shared：控制块和对象在同一块内存里，
+ * 按 rebind 之后的类型大小分池。取出的是未初始化的内存块，构造和析构仍由 allocate_shared 负责。
+ * 无状态，所有实例相等，内存可以在任何线程中释放
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n != 1) return std::allocator<T>().allocate(n);
+        return reinterpret_cast<T*>(ObjectPool<Storage>::acquire());
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (n != 1) {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+        ObjectPool<Storage>::release(reinterpret_cast<Storage*>(p));
+    }
+
+private:
+    struct Storage {
+        alignas(T) unsigned char bytes[sizeof(T)];
+    };
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return true; }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return false; }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Channel;
+class EventLoop;
+
+// I/O 多路复用的后端，在构造 EventLoop 时选择
+enum class PollerBackend {
+    kEpoll,   // epoll（默认）
+    kIoUring, // io_uring：POLL_ADD 等待就绪，内核支持时收发也改用完成请求；内核不支持时退回 epoll
+};
+
+/**
+ * 多路复用器的接口，EventLoop 通过它等待 Channel 上的事件。
+ * 所有方法只能在所属 EventLoop 的线程中调用
+ */
+class Poller : noncopyable {
+public:
+    using ChannelList = std::vector<Channel*>;
+
+    virtual ~Poller() = default;
+
+    // 等待事件，把就绪的 Channel（已设置 revents）追加到 activeChannels。timeout 单位为毫秒，-1 表示一直等待
+    virtual void poll(ChannelList& activeChannels, int timeout = -1) = 0;
+    // 按 channel->events() 添加、修改或删除监听
+    virtual void updateChannel(Channel* channel) = 0;
+    virtual void removeChannel(Channel* channel) = 0;
+
+    // 创建指定后端的 Poller，后端不可用时退回 epoll
+    static std::unique_ptr<Poller> create(PollerBackend backend, EventLoop* loop);
+
+    // 每次 poll() 最多返回的事件数，0 表示不限制（默认）。多出的就绪事件留在内核中，下一次 poll() 立即返回
+    void setMaxEvents(size_t n) { maxEvents_ = n; }
+
+    // 实际提交给内核的监听变更次数（epoll_ctl 调用或 io_uring 的 SQE）。
+    // 只在 loop 线程中更新，可以在任意线程读取近似值
+    uint64_t kernelUpdates() const { return kernelUpdates_.load(std::memory_order_relaxed); }
+
+protected:
+    size_t maxEvents_ = 0;
+
+    // 只有 loop 线程写，不需要原子的读-改-写
+    void countKernelUpdate()
+    { kernelUpdates_.store(kernelUpdates_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> kernelUpdates_{0};
+};
@@ -2,13 +2,12 @@
 
 #include "Callbacks.h"
 #include "Connector.h"
-#include "Timer.h"
+#include "TimerId.h"
 #include "noncopyable.h"
 #include <memory>
 
 class EventLoop;
 class TcpConnection;
-class Timer;
 
 class TcpClient : noncopyable {
 
@@ -34,7 +33,7 @@ private:
     EventLoop* loop_;
     bool connected_;
     const InetAddress peer_;
-    Timer* retryTimer_;
+    TimerId retryTimer_;
     ConnectorPtr connector_;
     TcpConnectionPtr connection_;
     ConnectionCallback connectionCallback_;
@@ -2,27 +2,59 @@
 
 #include <any>
 #include <atomic>
+#include <deque>
+#include <span>
+#include <sys/uio.h>
 
 #include "noncopyable.h"
 #include "Callbacks.h"
 #include "Channel.h"
 #include "InetAddress.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
+#include "MpscQueue.h"
+#include "IdleTimeoutWheel.h"
 
 class EventLoop;
+class IoUringPoller;
+struct SendChunk;
 
 class TcpConnection: noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    // 边缘触发模式下每次可读事件默认最多读取的字节数
+    static constexpr size_t kDefaultReadBudget = 256 * 1024;
+    // 连续这么多次读事件都用不到输入缓冲区存储的四分之一时，把存储还给 BufferPool
+    static constexpr int kShrinkAfterSparseReads = 64;
+
     TcpConnection(EventLoop* loop, int sockfd, const InetAddress& local, const InetAddress& peer);
     ~TcpConnection();
 
+    // 连接对象和 shared_ptr 控制块从当前线程的对象池中分配（见 PoolAllocator），
+    // 频繁建立、关闭连接时不再每次 malloc/free
+    static TcpConnectionPtr create(EventLoop* loop, int sockfd, const InetAddress& local, const InetAddress& peer);
+
+    // 一次设置消息、写完成和关闭回调，与其他连接共用同一份
+    void setCallbacks(TcpConnectionCallbacksPtr callbacks);
+    // 单独修改某个回调时先复制一份，不影响共用同一份回调的其他连接
     void setMessageCallback(const MessageCallback& callback);
     void setWriteCompleteCallback(const WriteCompleteCallback& callback);
     void setHighWaterMarkCallback(const HighWaterMarkCallback& callback, size_t mark);
     void setCloseCallback(const CloseCallback& callback);
 
+    // 边缘触发模式：每次可读事件循环读到 EAGAIN，一次最多读 readBudget 字节，超过后把剩余数据
+    // 留到下一轮，不让一个连接占住整个 loop；可写事件常驻注册，开关写不再调用 epoll_ctl。
+    // 必须在 connectEstablished() 之前、在 loop 线程中调用
+    void setEdgeTriggered(size_t readBudget = kDefaultReadBudget);
+    // 共用读缓冲区模式：inputBuffer_ 为空时先读进所属 loop 的 readBuffer()，MessageCallback 拿到的是它，
+    // 回调返回后剩下的不完整消息才拷贝进 inputBuffer_。一次读取就是完整请求的收发模式下，
+    // 连接自己不再持有读缓冲区。回调中不能保留指向 Buffer 的指针或引用，也不能期望 inputBuffer() 里有数据。
+    // 必须在 connectEstablished() 之前、在 loop 线程中调用
+    void setSharedReadBuffer(bool on);
     void connectEstablished();
+    // 加入所属 loop 的空闲超时时间轮，之后每次读到数据或写出数据都会刷新空闲时间。
+    // 必须在 connectEstablished() 之后、在 loop 线程中调用
+    void setIdleTimeoutWheel(IdleTimeoutWheel* wheel);
     bool connected() const;
     bool disconnected() const;
 
@@ -35,45 +67,110 @@ public:
     std::any& getContext();
 
     void send(const std::string& data);
+    // 跨线程时直接接管 data 的内存，不再拷贝
+    void send(std::string&& data);
     void send(const char* data, size_t len);
     void send(Buffer& buffer);
+    // 多段发送：头部和负载等多个片段通过一次 writev 发出，无需先拼接
+    void send(std::span<const struct iovec> parts);
+    // 发送文件区间 [offset, offset + len)，与其他 send 的数据按调用顺序排队，通过 sendfile(2) 发送。
+    // 内部会 dup 一份 fd，调用返回后调用方即可关闭自己的 fd
+    void sendFile(int fd, off_t offset, size_t len);
 
     void shutdown(); // 半关闭，关闭服务端写，保留读
     void forceClose();
 
+    // 所属 loop 支持基于完成事件的收发时（见 EventLoop::completionPoller），读由多次触发的 recv 完成，
+    // 缓冲区中的数据由 send 请求发出，文件区间仍然等可写事件后用 sendfile 发送。
+    // stopRead 之前已经完成的 recv 的数据先留在 inputBuffer_ 中，startRead 时再交给上层
     void stopRead();
     void startRead();
     bool isReading();
 
     const Buffer& inputBuffer() const;
-    const Buffer& outputBuffer() const;
+    const ChainBuffer& outputBuffer() const;
 
 private:
     void handleRead();
+    void handleReadEdgeTriggered();
+    // 本次读取使用的缓冲区：共用读缓冲区模式下 inputBuffer_ 为空时是 loop 的 readBuffer()
+    Buffer& readTarget();
+    // 调用 MessageCallback，回调期间 inMessageCallback_ 为 true
+    void dispatchMessage(Buffer& buffer);
+    // 消息回调之后把共用读缓冲区中剩下的数据移入 inputBuffer_，再清空共用读缓冲区
+    void stashReadBuffer(Buffer& buffer);
     void handleWrite();
     void handleClose();
     void handleError();
+    // 完成模式下的读写
+    void startRecv();
+    void handleRecvComplete(const char* data, int res, bool more);
+    void submitSend();
+    void handleSendComplete(int res);
+    void stopReadInLoop();
+    void startReadInLoop();
 
     void sendInLoop(const char* data, size_t len);
     void sendInLoop(const std::string& message);
+    void sendInLoop(const struct iovec* iov, int iovcnt);
+    void sendFileInLoop(int fd, off_t offset, size_t len);
+    // 跨线程 send、sendFile、shutdown 放入 sendQueue_，每一批只投递一次 drainSendQueue 任务，按入队顺序处理
+    void queueSendChunk(SendChunk* chunk);
+    void drainSendQueue();
+    // 按排队顺序把 outputBuffer_ 和文件区间写入 socket，出错时返回 false 并设置 savedErrno。
+    // 边缘触发时一直写到写完或 EAGAIN
+    bool drainOutput(int* savedErrno);
+    bool drainOutputOnce(int* savedErrno);
+    // 尚未发出的字节数，包括 outputBuffer_ 和所有文件区间
+    size_t pendingBytes() const;
+    void clearFileRegions();
+    // 一次读事件处理完之后调用，readBytes 为交给上层时缓冲区中的字节数。连续 kShrinkAfterSparseReads 次
+    // 都用不到输入缓冲区存储的四分之一时，突发流量已经过去，把存储还给 BufferPool
+    void shrinkInputIfSparse(size_t readBytes);
+    // 把两个缓冲区容量的变化计入所属 loop 的统计，连接关闭后释放两个缓冲区
+    void updateBufferBytes();
     void shutdownInLoop();
     void forceCloseInLoop();
 
     int stateAtomicGetAndSet(int newState);
 
     EventLoop* loop_;
+    IoUringPoller* ring_;      // 使用完成请求收发时不为 nullptr
     const int sockfd_;
     Channel channel_;
     std::atomic<int> state_;
     InetAddress local_;
     InetAddress peer_;
-    Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    Buffer inputBuffer_;       // 第一次读取时才分配存储，之后保留，长时间用不到大块存储时才归还
+    ChainBuffer outputBuffer_; // 分段存储，扩容不搬移数据，通过 writev 发送
+    size_t bufferBytes_;       // 已计入 loop 统计的缓冲区字节数
+    int sparseReads_;          // 连续用不到输入缓冲区存储四分之一的读事件数
+    bool inMessageCallback_;   // 正在执行 MessageCallback，上层持有输入缓冲区的引用
+
+    // 排队中的文件区间，bytesBefore 为发送该区间前需要先发出的 outputBuffer_ 字节数（相对于前一个区间）
+    struct FileRegion {
+        int fd;
+        off_t offset;
+        size_t remain;
+        size_t bytesBefore;
+    };
+    std::deque<FileRegion> fileRegions_;
+    size_t fileBytes_;        // 所有文件区间剩余的字节数
+    size_t regionedBytes_;    // outputBuffer_ 中排在最后一个文件区间之前的字节数
+
+    // 其他线程 send 的数据块，无锁入队，由 loop 线程一次性取出发送
+    MpscQueue<SendChunk> sendQueue_;
+    std::atomic_bool sendScheduled_; // 是否已经投递了 drainSendQueue 任务且尚未开始执行
     size_t highWaterMark_;
+    size_t readBudget_;       // 边缘触发模式下每次可读事件最多读取的字节数
+    bool sharedReadBuffer_;
+    uint64_t recvId_;         // 进行中的多次触发 recv 请求，0 表示没有
+    uint64_t sendId_;         // 进行中的 send 请求，0 表示没有；请求完成前 outputBuffer_ 的数据不能释放
+    bool recvWanted_;         // 完成模式下上层是否需要读（stopRead/startRead）
     std::any context_;
-    MessageCallback messageCallback_;
-    WriteCompleteCallback writeCompleteCallback_;
+    IdleTimeoutWheel* idleWheel_;           // 未设置空闲超时时为 nullptr
+    IdleTimeoutWheel::Entry idleEntry_;
+    TcpConnectionCallbacksPtr callbacks_;   // 通常与同一服务器的其他连接共用
     HighWaterMarkCallback highWaterMarkCallback_;
-    CloseCallback closeCallback_;
 };
 
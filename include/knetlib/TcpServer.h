@@ -2,27 +2,92 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "TcpServerSingle.h"
 #include "EventLoopThreadPool.h"
 #include "noncopyable.h"
 #include "Callbacks.h"
 #include "InetAddress.h"
+#include "Timestamp.h"
 
 class EventLoop;
+class IdleTimeoutWheel;
 
 class TcpServer : noncopyable {
 
 public:
     TcpServer(EventLoop* loop, const InetAddress& local);
+    // 必须在 loop 所在的线程中析构（其他线程析构时 loop 可能没有在运行，等待会永远阻塞）。
+    // 析构时在每个 loop 上关闭剩余的连接并等待完成：loop 上的直接执行，工作线程的 loop 由线程池保证仍在运行
     ~TcpServer();
 
     // 设置工作线程数量（不包括主线程）
     // 必须在 start() 之前调用
     void setNumThread(size_t n);
 
+    // 工作线程名前缀、绑核和 NUMA 本地内存，见 EventLoopThreadPool。必须在 start() 之前调用
+    void setThreadName(const std::string& prefix);
+    void setCpuAffinity(const std::vector<int>& cpus);
+    void setNumaLocal(bool on);
+
+    // 低延迟模式：工作线程的 EventLoop 忙轮询 budget 时间后才阻塞（见 EventLoop::setBusyPoll）。
+    // socketBusyPollUs 大于 0 时为每个连接设置 SO_BUSY_POLL，让内核在读 socket 时直接轮询网卡队列
+    // （超过 net.core.busy_read 需要 CAP_NET_ADMIN）。必须在 start() 之前调用
+    void setBusyPoll(Nanoseconds budget, int socketBusyPollUs = 0);
+
+    // 工作线程的 EventLoop 每轮最多处理 maxEvents 个事件、执行 maxTasks 个任务，0 表示不限制
+    // （见 EventLoop::setIterationBudget）。必须在 start() 之前调用
+    void setIterationBudget(size_t maxEvents, size_t maxTasks);
+
+    // 工作线程 EventLoop 的多路复用后端，内核不支持 io_uring 时退回 epoll。
+    // baseLoop 由调用者创建，需要时自行用 EventLoop(PollerBackend::kIoUring) 构造。必须在 start() 之前调用
+    void setPollerBackend(PollerBackend backend);
+
+    // 连接使用边缘触发模式（见 TcpConnection::setEdgeTriggered）：每次可读事件读到 EAGAIN，
+    // 最多读 readBudget 字节后让出，0 表示使用 TcpConnection::kDefaultReadBudget。必须在 start() 之前调用
+    void setEdgeTriggered(bool on, size_t readBudget = 0);
+
+    // 连接使用共用读缓冲区（见 TcpConnection::setSharedReadBuffer）：数据先读进 loop 的读缓冲区，
+    // 只有不完整的消息才拷贝进连接自己的输入缓冲区。必须在 start() 之前调用
+    void setSharedReadBuffer(bool on);
+
+    // 连接超过 timeout 没有收发数据就关闭，每个 EventLoop 用一个分桶时间轮管理，
+    // 不会为每个连接创建定时器。必须在 start() 之前调用，默认不限制
+    void setIdleTimeout(Nanoseconds timeout);
+
+    // SO_REUSEPORT 模式：每个 IO loop 各自监听同一端口，连接由内核分发，在同一个线程中
+    // accept 和处理，不再经过主线程转交。cpuAffinity 为 true 时挂载 cBPF 程序，
+    // 把连接交给与处理网卡中断的 CPU 对应的 loop（第 i 个 IO loop 对应 CPU i，需配合线程绑核）。
+    // 必须在 start() 之前调用
+    void setReusePort(bool on, bool cpuAffinity = false);
+
+    // 批量 accept：每次可读事件最多 accept n 个连接（直到 EAGAIN），并按目标 loop 分组，
+    // 每个 loop 只投递一个任务。默认 n = 1，即每次可读事件 accept 一个连接。
+    // 必须在 start() 之前调用
+    void setAcceptBatch(int n);
+
+    // 新连接分配到工作线程的策略，默认轮询。SO_REUSEPORT 模式下由内核分配，不使用该策略。
+    // 必须在 start() 之前调用
+    void setLoadBalance(LoadBalance strategy);
+
+    // 连接数上限，达到上限时暂停 accept，新连接留在内核的监听队列中，有连接关闭后恢复。
+    // 0 表示不限制（默认）。必须在 start() 之前调用
+    void setMaxConnections(size_t n);
+
     void start();
 
+    // 当前连接数
+    size_t numConnections() const;
+    // 被拒绝的连接数：超过连接数上限，或文件描述符耗尽时被直接关闭的连接
+    uint64_t rejectedConnections() const;
+    // 各个 IO loop 上连接缓冲区持有的字节数之和（见 EventLoop::connectionBufferBytes），
+    // 包括与本服务器共用 loop 的其他连接。start() 之后才有意义
+    size_t connectionBufferBytes() const;
+
+    // 回调在 start() 时打包，之后建立的连接共用同一份，必须在 start() 之前调用
     void setThreadInitCallback(const ThreadInitCallback&);
     void setConnectionCallback(const ConnectionCallback&);
     void setMessageCallback(const MessageCallback&);
@@ -32,20 +97,53 @@ private:
     void startInLoop();
     // 新连接回调（在主线程中调用）
     void newConnection(int sockfd, const InetAddress& local, const InetAddress& peer);
+    // 批量新连接回调（在主线程中调用）
+    void newConnectionBatch(const InetAddress& local, std::vector<AcceptedSocket>& sockets);
+    // 在 accept 所在线程中计入连接数，超过上限时关闭 sockfd 并返回 false
+    bool admitConnection(int sockfd);
+    // 按当前连接数在各个 acceptor 的线程中暂停或恢复 accept
+    void updateAccepting();
+    // 每个 EventLoop 的连接和空闲时间轮，只在该 loop 线程中访问
+    struct LoopContext {
+        EventLoop* loop;
+        size_t index;                                // 在 contexts_ 中的下标
+        std::unique_ptr<Acceptor> acceptor;          // 只在 SO_REUSEPORT 模式下存在
+        std::unique_ptr<IdleTimeoutWheel> idleWheel; // 先于 connections 声明，后析构
+        std::unordered_set<TcpConnectionPtr> connections;
+        TcpConnectionCallbacksPtr callbacks;         // 本 loop 上的连接共用，start() 时创建
+    };
+    void startReusePortAcceptors();
+    LoopContext* contextOf(EventLoop* loop);
+    // 按分配策略为新连接选择 loop 并计入该 loop 的连接数（在主线程中调用）
+    LoopContext* selectContext(const InetAddress& peer);
+    // 在 context 所属的 loop 线程中创建连接并加入 context
+    void establishConnection(LoopContext* context, int sockfd,
+                             const InetAddress& local, const InetAddress& peer);
+    // 在 context 所属的 loop 线程中关闭其全部连接并销毁时间轮
+    static void teardownContext(LoopContext* context);
     // 关闭连接回调（在连接所属的线程中调用）
-    void closeConnection(const TcpConnectionPtr& conn);
+    void closeConnection(LoopContext* context, const TcpConnectionPtr& conn);
 
     EventLoop* baseLoop_;
-    std::unique_ptr<TcpServerSingle> acceptor_;  // 只在主线程中，负责 accept
+    std::unique_ptr<TcpServerSingle> acceptor_;  // 只在主线程中，负责 accept（非 SO_REUSEPORT 模式）
     std::unique_ptr<EventLoopThreadPool> threadPool_;
     std::atomic_bool started_;
     InetAddress local_;
+    Nanoseconds idleTimeout_;
+    bool reusePort_;
+    bool reusePortCpuAffinity_;
+    int acceptBatch_;
+    int socketBusyPollUs_;
+    size_t readBudget_;    // 大于 0 时连接使用边缘触发模式
+    bool sharedReadBuffer_;
+    size_t maxConnections_;
+    std::atomic<size_t> numConnections_;
+    std::atomic<uint64_t> rejectedConnections_; // 超过连接数上限被拒绝的连接
+    std::atomic_bool stopping_;                 // 析构中，关闭连接不再恢复 accept
+    std::vector<std::unique_ptr<LoopContext>> contexts_; // 与 getAllLoops() 一一对应
     ThreadInitCallback threadInitCallback_;
     ConnectionCallback connectionCallback_;
     MessageCallback messageCallback_;
     WriteCompleteCallback writeCompleteCallback_;
-    
-    // 连接管理（每个连接属于一个 EventLoop）
-    // 注意：连接的实际管理在各自的 EventLoop 线程中
 };
 
@@ -19,6 +19,11 @@ public:
     void setWriteCompleteCallback(const WriteCompleteCallback &callback);
     // 设置新连接回调（用于主从 Reactor 模式）
     void setNewConnectionCallback(const NewConnectionCallback& callback);
+    void setNewConnectionBatchCallback(const NewConnectionBatchCallback& callback);
+    void setMaxAcceptsPerRead(int n);
+    void pauseAccepting();
+    void resumeAccepting();
+    uint64_t rejectedAccepts() const;
     
     void start();
     void stop(); // 停止服务器，关闭所有连接
@@ -36,5 +41,6 @@ private:
     ConnectionCallback connectionCallback_;
     MessageCallback messageCallback_;
     WriteCompleteCallback writeCompleteCallback_;
+    TcpConnectionCallbacksPtr callbacks_;   // 所有连接共用，回调修改后的第一个新连接重新打包
 };
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <utility>
 
 #include "noncopyable.h"
 #include "Callbacks.h"
@@ -9,14 +10,31 @@
 class Timer: noncopyable {
 
 public:
-    Timer(TimerCallback callback, Timestamp when, Nanoseconds interval)
-            : callback_(callback),
+    Timer()
+            : Timer(nullptr, Timestamp(), Nanoseconds::zero())
+    {}
+
+    Timer(Task callback, Timestamp when, Nanoseconds interval)
+            : callback_(std::move(callback)),
               when_(when),
               interval_(interval),
               repeat_(interval_ > Nanoseconds::zero()),
-              canceled_(false)
+              canceled_(false),
+              prev_(nullptr),
+              next_(nullptr),
+              slot_(kDetached)
     {}
 
+    // 复用定时器对象：重新设置回调和时间，清除取消标记
+    void reset(Task callback, Timestamp when, Nanoseconds interval) {
+        assert(slot_ == kDetached);
+        callback_ = std::move(callback);
+        when_ = when;
+        interval_ = interval;
+        repeat_ = interval_ > Nanoseconds::zero();
+        canceled_ = false;
+    }
+
     void run() {
         if (callback_) callback_();
     }
@@ -49,10 +67,21 @@ public:
 
 
 private:
-    TimerCallback callback_;
+    friend class TimingWheel;
+
+    // slot_ 的特殊取值：不在时间轮中 / 在时间轮的有序集合中
+    static constexpr int kDetached = -1;
+    static constexpr int kOrdered = -2;
+
+    Task callback_;
     Timestamp when_;
-    const Nanoseconds interval_;
+    Nanoseconds interval_;
     bool repeat_;
     bool canceled_;
+
+    // 由 TimingWheel 维护：所在槽位的侵入式双向链表，以及槽位编号
+    Timer* prev_;
+    Timer* next_;
+    int slot_;
 };
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * 定时器句柄，由 EventLoop::runAt/runAfter/runEvery 返回，用于 cancelTimer。
+ * 句柄只是定时器槽位的下标加代数，槽位每次回收代数加一，
+ * 所以定时器触发后或已取消后再用旧句柄 cancel 是安全的空操作，不会误伤复用该槽位的新定时器
+ */
+class TimerId {
+public:
+    TimerId()
+            : index_(kInvalidIndex),
+              generation_(0)
+    {}
+
+    bool valid() const
+    { return index_ != kInvalidIndex; }
+
+    bool operator==(const TimerId& rhs) const = default;
+
+private:
+    friend class TimerQueue;
+
+    static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+    TimerId(uint32_t index, uint32_t generation)
+            : index_(index),
+              generation_(generation)
+    {}
+
+    uint32_t index_;
+    uint32_t generation_;
+};
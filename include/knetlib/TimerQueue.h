@@ -1,10 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <set>
+#include <mutex>
 #include <vector>
 
 #include "Timer.h"
+#include "TimerId.h"
+#include "TimingWheel.h"
 #include "Channel.h"
 #include "Timestamp.h"
 #include "noncopyable.h"
@@ -17,20 +21,46 @@ public:
     explicit TimerQueue(EventLoop* loop);
     ~TimerQueue();
 
-    Timer* addTimer(TimerCallback callback, Timestamp when, Nanoseconds interval);
-    void cancelTimer(Timer* timer);
+    // 可以在任意线程调用
+    TimerId addTimer(Task callback, Timestamp when, Nanoseconds interval);
+    // 句柄对应的定时器已经触发或取消时什么也不做
+    void cancelTimer(TimerId timerId);
 
 private:
-    using Entry = std::pair<Timestamp, Timer*>;
-    using TimerList = std::set<Entry>;
+    // 定时器槽位：Timer 对象连同代数一起从槽位表中复用，不再逐个 new/delete
+    struct Slot : Timer {
+        uint32_t index = 0;
+        uint32_t generation = 0;
+        uint32_t nextFree = 0;
+    };
+
+    static constexpr uint32_t kChunkSize = 1024;  // 每块槽位个数
+    static constexpr uint32_t kMaxChunks = 4096;  // 最多约 400 万个同时存在的定时器
+    static constexpr uint32_t kNoFreeSlot = UINT32_MAX;
+
+    // 从空闲链表取出一个槽位，没有空闲槽位时分配新的一块，返回时持有的代数即句柄的代数
+    Slot* allocSlot(uint32_t* generation);
+    // 归还槽位并递增代数，使旧句柄失效。只在 loop 线程中调用
+    void freeSlot(Slot* slot);
+    // 句柄对应的槽位，句柄无效或已过期时返回 nullptr。只在 loop 线程中调用
+    Slot* findSlot(TimerId timerId) const;
 
     void handleRead();
-    std::vector<Entry> getExpired(Timestamp now);
+    // 按时间轮的下一个截止时间设置 timerfd，只在截止时间提前时才重新设置
+    void resetTimerfd();
 
 private:
     EventLoop* loop_;
     const int timerfd_;
     Channel timerChannel_;
-    TimerList timers_;
+    TimingWheel wheel_;
+    Timestamp armedDeadline_;     // timerfd 当前设置的触发时间，未设置时为 Timestamp::max()
+    std::vector<Timer*> expired_; // handleRead 中本轮到期的定时器，复用容量
+
+    // 槽位按块分配，块一旦分配就不再移动，loop 线程可以不加锁地按下标访问
+    std::atomic<Slot*> chunks_[kMaxChunks];
+    std::mutex slotMutex_;   // 保护空闲链表和块的分配，addTimer 可能在其他线程调用
+    uint32_t numChunks_;
+    uint32_t freeHead_;      // 空闲链表头，kNoFreeSlot 表示没有空闲槽位
 };
 
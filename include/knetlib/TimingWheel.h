@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "Timer.h"
+#include "Timestamp.h"
+#include "noncopyable.h"
+
+/**
+ * 分层时间轮，TimerQueue 的定时器存储结构。
+ * 第 0 层 256 个槽，每槽 1 个 tick（1ms）；第 1~3 层各 64 个槽，每层的槽宽是下一层整圈的长度，
+ * 共覆盖 2^26 个 tick（约 18.6 小时），更远的定时器先放在最高层的最后一个槽，转到时再重新放置。
+ * 槽内是 Timer 的侵入式双向链表，添加和取消都是 O(1)，不需要额外分配内存；
+ * 高层的槽转到时整体下放（cascade）到低层，每个定时器最多被搬动 3 次。
+ * 时间轮只精确到 tick，已经转过的 tick 内的定时器放在一个按时间排序的小集合里，保留 tick 以下的精度。
+ * 只能在所属 loop 线程中使用
+ */
+class TimingWheel : noncopyable {
+public:
+    static constexpr Nanoseconds kTick = Milliseconds(1);
+
+    explicit TimingWheel(Timestamp now);
+
+    // 按 timer->when() 放入时间轮
+    void add(Timer* timer);
+    // 从时间轮中摘除，不释放 timer
+    void remove(Timer* timer);
+    bool contains(const Timer* timer) const
+    { return timer->slot_ != Timer::kDetached; }
+
+    // 推进到 now，把到期的定时器按到期时间顺序追加到 expired 并从时间轮中摘除
+    void advance(Timestamp now, std::vector<Timer*>& expired);
+    // 下一次需要调用 advance 的时间点，时间轮为空时返回 false
+    bool nextDeadline(Timestamp* deadline) const;
+    // 摘除所有定时器，追加到 timers 中
+    void removeAll(std::vector<Timer*>& timers);
+
+    size_t size() const
+    { return size_; }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kLevel0Bits = 8;
+    static constexpr int kLevelBits = 6;
+    static constexpr int kLevel0Slots = 1 << kLevel0Bits;
+    static constexpr int kLevelSlots = 1 << kLevelBits;
+    static constexpr int kNumSlots = kLevel0Slots + (kLevels - 1) * kLevelSlots;
+    // 时间轮能直接表示的最大 tick 距离
+    static constexpr uint64_t kMaxDelta = uint64_t(1) << (kLevel0Bits + (kLevels - 1) * kLevelBits);
+
+    static uint64_t tickOf(Timestamp when);
+    static Timestamp timeOfTick(uint64_t tick);
+    // 第 level 层的 tick 位移，以及该层第一个槽在 slots_ 中的下标
+    static int shiftOf(int level)
+    { return level == 0 ? 0 : kLevel0Bits + (level - 1) * kLevelBits; }
+    static int baseOf(int level)
+    { return level == 0 ? 0 : kLevel0Slots + (level - 1) * kLevelSlots; }
+    static int slotsOf(int level)
+    { return level == 0 ? kLevel0Slots : kLevelSlots; }
+
+    void place(Timer* timer);
+    void linkSlot(Timer* timer, int slot);
+    void unlinkSlot(Timer* timer);
+    // 把第 level 层当前下标的槽整体重新放置，返回该下标
+    int cascade(int level);
+    // 在第 level 层中，从 from 开始（含）循环查找第一个非空槽，找不到返回 -1
+    int findOccupied(int level, int from) const;
+
+    Timer* slots_[kNumSlots];
+    uint64_t occupied_[(kNumSlots + 63) / 64]; // 非空槽位图，用于快速查找下一个到期的槽
+    // 已经转过的 tick 内到期的定时器，按时间排序
+    std::set<std::pair<Timestamp, Timer*>> ordered_;
+    uint64_t currentTick_; // 下一个待处理的 tick
+    size_t size_;
+};
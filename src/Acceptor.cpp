@@ -1,8 +1,10 @@
 #include "knetlib/Acceptor.h"
 #include "knetlib/EventLoop.h"
+#include "knetlib/IoUringPoller.h"
 #include "knetlib/Logger.h"
 #include "knetlib/utils.h"
 #include <sys/socket.h>
+#include <linux/filter.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cerrno>
@@ -18,38 +20,94 @@ int createSocket() {
     return ret;
 }
 
+int openIdleFd() {
+    int ret = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (ret == -1) {
+        SYSERR("Acceptor open /dev/null");
+    }
+    return ret;
+}
+
 } // anonymous namespace
 
-Acceptor::Acceptor(EventLoop* loop, const InetAddress& local)
+Acceptor::Acceptor(EventLoop* loop, const InetAddress& local, bool reusePort)
         : listening_(false),
           loop_(loop),
           acceptfd_(createSocket()),
+          idleFd_(openIdleFd()),
           acceptChannel_(loop, acceptfd_),
-          local_(local)
+          ring_(loop->completionPoller()),
+          acceptId_(0),
+          local_(local),
+          maxAcceptsPerRead_(1),
+          paused_(false),
+          rejectedAccepts_(0)
 {
     int on = 1;
     int ret = setsockopt(acceptfd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
     if (ret == -1) {
         SYSFATAL("Acceptor setsockopt SO_REUSEADDR");
     }
-    // 移除 SO_REUSEPORT，因为现在使用标准的主从 Reactor 模式
-    // 只有主线程监听端口，不需要 SO_REUSEPORT
+    // 默认只有主线程监听端口；TcpServer 的 SO_REUSEPORT 模式下每个 IO 线程各有一个监听 socket
+    if (reusePort) {
+        ret = setsockopt(acceptfd_, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        if (ret == -1) {
+            SYSFATAL("Acceptor setsockopt SO_REUSEPORT");
+        }
+    }
     ret = bind(acceptfd_, local.getSockaddr(), local.getSocklen());
     if (ret == -1) {
         SYSFATAL("Acceptor bind");
     }
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (::getsockname(acceptfd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        local_.setAddress(addr);
+    }
 }
 
 Acceptor::~Acceptor() {
+    // io_uring 的 poll 请求持有文件引用，只 close 不会取消监听，在 loop 线程中先注销
+    if (acceptChannel_.pooling && loop_->isInLoopThread()) {
+        acceptChannel_.disableAll();
+    }
+    // accept 请求的回调引用了 this，丢弃回调，之后 accept 到的连接由 Poller 关闭
+    if (acceptId_ != 0 && loop_->isInLoopThread()) {
+        ring_->cancelAndForget(acceptId_);
+    }
     if (acceptfd_ != -1) {
         close(acceptfd_);
     }
+    if (idleFd_ != -1) {
+        close(idleFd_);
+    }
 }
 
 bool Acceptor::listening() const {
     return listening_;
 }
 
+const InetAddress& Acceptor::local() const {
+    return local_;
+}
+
+bool Acceptor::attachReusePortCpuSteering(int groupSize) {
+    // A = 当前 CPU 编号; A %= groupSize; return A
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(groupSize) },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (setsockopt(acceptfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == -1) {
+        SYSERR("Acceptor setsockopt SO_ATTACH_REUSEPORT_CBPF");
+        return false;
+    }
+    return true;
+}
+
 void Acceptor::listen() {
     loop_->assertInLoopThread();
     int ret = ::listen(acceptfd_, SOMAXCONN);
@@ -57,41 +115,177 @@ void Acceptor::listen() {
         SYSFATAL("Acceptor listen fatal");
     }
     listening_ = true;
+    if (ring_ != nullptr) {
+        if (!paused_) {
+            startAccept();
+        }
+        return;
+    }
     acceptChannel_.setReadCallback([this](){handleRead();}); // 当有连接请求到来时，交由handleRead处理
+    if (!paused_) {
+        acceptChannel_.enableRead();
+    }
+}
+
+void Acceptor::pauseAccepting() {
+    loop_->assertInLoopThread();
+    if (paused_) return;
+    paused_ = true;
+    if (!listening_) return;
+    if (ring_ != nullptr) {
+        // 取消之前已经 accept 的连接仍会交给回调
+        if (acceptId_ != 0) {
+            ring_->cancel(acceptId_);
+        }
+        return;
+    }
+    acceptChannel_.disableRead();
+}
+
+void Acceptor::resumeAccepting() {
+    loop_->assertInLoopThread();
+    if (!paused_) return;
+    paused_ = false;
+    if (!listening_) return;
+    if (ring_ != nullptr) {
+        // 被取消的请求还没有结束时，由它结束的完成事件重新提交
+        if (acceptId_ == 0) {
+            startAccept();
+        }
+        return;
+    }
     acceptChannel_.enableRead();
 }
 
+bool Acceptor::accepting() const {
+    return listening_ && !paused_;
+}
+
+uint64_t Acceptor::rejectedAccepts() const {
+    return rejectedAccepts_.load(std::memory_order_relaxed);
+}
+
 void Acceptor::setNewConnectionCallback(const NewConnectionCallback& callback) {
     newConnectionCallback_ = callback;
 }
 
+void Acceptor::setNewConnectionBatchCallback(const NewConnectionBatchCallback& callback) {
+    newConnectionBatchCallback_ = callback;
+}
+
+void Acceptor::setMaxAcceptsPerRead(int n) {
+    if (n > 0) {
+        maxAcceptsPerRead_ = n;
+    } else {
+        ERROR("Acceptor::setMaxAcceptsPerRead n <= 0");
+    }
+}
+
 void Acceptor::handleRead() {
     loop_->assertInLoopThread();
 
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
+    // 突发的大量连接在一次 epoll_wait 返回后尽量取完，而不是每个连接一次系统调用往返
+    for (int i = 0; i < maxAcceptsPerRead_ && !paused_; ++i) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
 
-    int sockfd = ::accept4(acceptfd_, reinterpret_cast<sockaddr*>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
-    if (sockfd == -1) {
-        int savedErrno = errno;
-        SYSERR("Acceptor accept4()");
-        switch (savedErrno) {
-            case ECONNABORTED: // connection aborted
-            case EMFILE: // 文件描述符用完了
-                ERROR("%s", strerror(savedErrno));
-                break;
-            default:
-                FATAL("unexpected accept4() error");
+        int sockfd = ::accept4(acceptfd_, reinterpret_cast<sockaddr*>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (sockfd == -1) {
+            int savedErrno = errno;
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                break; // 已经取完
+            }
+            SYSERR("Acceptor accept4()");
+            switch (savedErrno) {
+                case ECONNABORTED: // connection aborted
+                    continue;
+                case EMFILE: // 文件描述符用完了
+                case ENFILE:
+                    // 连接留在监听队列里会让水平触发的 epoll 一直可读、loop 空转，
+                    // 用预留的 fd 腾出位置把它 accept 下来立即关闭，对端能尽快收到 FIN
+                    if (rejectOne()) continue;
+                    ERROR("%s", strerror(savedErrno));
+                    break;
+                default:
+                    FATAL("unexpected accept4() error");
+            }
+            break;
         }
-        return;
-    }
 
-    if (newConnectionCallback_) {
         InetAddress peer;
         peer.setAddress(addr);
+        newConnection(sockfd, peer);
+    }
+
+    // 回调中可能暂停了 accept（例如连接数达到上限），批量模式下剩余的连接仍然交给回调
+    if (!accepted_.empty()) {
+        newConnectionBatchCallback_(local_, accepted_);
+        accepted_.clear();
+    }
+}
+
+void Acceptor::startAccept() {
+    acceptId_ = ring_->acceptMultishot(acceptfd_, [this](int res, bool more) {
+        handleAcceptComplete(res, more);
+    });
+}
+
+void Acceptor::handleAcceptComplete(int res, bool more) {
+    loop_->assertInLoopThread();
+    if (!more) {
+        acceptId_ = 0;
+    }
+    if (res >= 0) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        InetAddress peer;
+        if (::getpeername(res, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+            peer.setAddress(addr);
+        }
+        newConnection(res, peer);
+        if (!accepted_.empty()) {
+            newConnectionBatchCallback_(local_, accepted_);
+            accepted_.clear();
+        }
+    }
+    else if (res == -EMFILE || res == -ENFILE) {
+        errno = -res;
+        SYSERR("Acceptor accept");
+        rejectOne();
+    }
+    else if (res != -ECANCELED) {
+        errno = -res;
+        SYSERR("Acceptor accept");
+    }
+    // 请求因为出错或者被取消而结束，还需要 accept 就重新提交
+    if (acceptId_ == 0 && listening_ && !paused_) {
+        startAccept();
+    }
+}
+
+void Acceptor::newConnection(int sockfd, const InetAddress& peer) {
+    if (newConnectionBatchCallback_) {
+        accepted_.push_back({sockfd, peer});
+    }
+    else if (newConnectionCallback_) {
         newConnectionCallback_(sockfd, local_, peer);
     }
     else {
         ::close(sockfd);
     }
 }
+
+bool Acceptor::rejectOne() {
+    if (idleFd_ == -1) {
+        idleFd_ = openIdleFd();
+        return false;
+    }
+    ::close(idleFd_);
+    idleFd_ = ::accept(acceptfd_, nullptr, nullptr);
+    if (idleFd_ != -1) {
+        ::close(idleFd_);
+        rejectedAccepts_.fetch_add(1, std::memory_order_relaxed);
+    }
+    idleFd_ = openIdleFd();
+    return true;
+}
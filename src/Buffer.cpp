@@ -1,6 +1,7 @@
 // from muduo::Buffer
 
 #include <cerrno>
+#include <vector>
 #include <sys/uio.h>
 #include "knetlib/Buffer.h"
 
@@ -9,18 +10,126 @@ const char Buffer::kCRLF[] = "\r\n";
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
-ssize_t Buffer::readFd(int fd, int* savedErrno)
+namespace {
+
+// 大小级别 i 的存储为 kCheapPrepend + 2^(kMinShift + i) 字节
+const int kMinShift = 7;
+const int kMaxShift = 16;
+const int kNumClasses = kMaxShift - kMinShift + 1;
+// 每级空闲链表最多缓存的字节数
+const size_t kMaxCachedBytesPerClass = 256 * 1024;
+
+size_t classSize(int sizeClass)
+{ return Buffer::kCheapPrepend + (size_t(1) << (kMinShift + sizeClass)); }
+
+// 能容纳 capacity 字节的最小级别，超过最大级别时返回 -1
+int sizeClassOf(size_t capacity)
+{
+    for (int i = 0; i < kNumClasses; ++i) {
+        if (capacity <= classSize(i)) return i;
+    }
+    return -1;
+}
+
+class StoragePool
+{
+public:
+    StoragePool()
+            : cachedBytes_(0)
+    {}
+
+    ~StoragePool()
+    {
+        for (auto &list : freeLists_) {
+            for (char *data : list) {
+                delete[] data;
+            }
+        }
+        destroyed_ = true;
+    }
+
+    char *get(int sizeClass)
+    {
+        std::vector<char *> &list = freeLists_[sizeClass];
+        if (list.empty()) {
+            return new char[classSize(sizeClass)];
+        }
+        char *data = list.back();
+        list.pop_back();
+        cachedBytes_ -= classSize(sizeClass);
+        return data;
+    }
+
+    void put(int sizeClass, char *data)
+    {
+        std::vector<char *> &list = freeLists_[sizeClass];
+        if ((list.size() + 1) * classSize(sizeClass) <= kMaxCachedBytesPerClass) {
+            list.push_back(data);
+            cachedBytes_ += classSize(sizeClass);
+        }
+        else delete[] data;
+    }
+
+    size_t cachedBytes() const
+    { return cachedBytes_; }
+
+    // 线程退出时池先于其他静态对象析构，之后释放的存储直接交还系统
+    static bool destroyed()
+    { return destroyed_; }
+
+private:
+    std::vector<char *> freeLists_[kNumClasses];
+    size_t cachedBytes_;
+    static thread_local bool destroyed_;
+};
+
+thread_local bool StoragePool::destroyed_ = false;
+thread_local StoragePool t_storagePool;
+
+} // anonymous namespace
+
+char *BufferPool::allocate(size_t *capacity)
+{
+    int sizeClass = sizeClassOf(*capacity);
+    if (sizeClass < 0 || StoragePool::destroyed()) {
+        return new char[*capacity];
+    }
+    *capacity = classSize(sizeClass);
+    return t_storagePool.get(sizeClass);
+}
+
+void BufferPool::deallocate(char *data, size_t capacity)
 {
+    int sizeClass = sizeClassOf(capacity);
+    // 只有恰好等于某一级大小的存储来自池
+    if (sizeClass < 0 || classSize(sizeClass) != capacity || StoragePool::destroyed()) {
+        delete[] data;
+        return;
+    }
+    t_storagePool.put(sizeClass, data);
+}
+
+size_t BufferPool::cachedBytes()
+{
+    return StoragePool::destroyed() ? 0 : t_storagePool.cachedBytes();
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, size_t maxBytes)
+{
+    // 第一次读取时才分配存储，小消息直接读进来，不经过 extrabuf
+    if (data_ == emptyStorage()) {
+        allocate(kCheapPrepend + kInitialSize);
+    }
     char extrabuf[65536];
     struct iovec vec[2];
-    const size_t writable = writableBytes();
+    const size_t writable = std::min(writableBytes(), maxBytes);
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = std::min(sizeof extrabuf, maxBytes - writable);
     // when there is enough space in this buffer, don't read into extrabuf.
     // when extrabuf is used, we read 128k-1 bytes at most.
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    const int iovcnt = (writable < sizeof extrabuf && vec[1].iov_len > 0) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
 
     if (n < 0)
@@ -28,7 +137,7 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
     else if (static_cast<size_t>(n) <= writable)
         writerIndex_ += n;
     else {
-        writerIndex_ = buffer_.size();
+        writerIndex_ += writable;
         append(extrabuf, n - writable);
     }
     return n;
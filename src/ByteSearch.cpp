@@ -0,0 +1,167 @@
+#include "knetlib/ByteSearch.h"
+#include <cassert>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+ByteSet::ByteSet(std::string_view bytes)
+        : size_(0),
+          bytes_{},
+          bitmap_{}
+{
+    for (char c : bytes) {
+        if (contains(c)) continue;
+        auto u = static_cast<unsigned char>(c);
+        bitmap_[u >> 6] |= uint64_t(1) << (u & 63);
+        if (size_ < kMaxVectorBytes) {
+            bytes_[size_] = c;
+        }
+        ++size_;
+    }
+}
+
+namespace {
+
+const char* findCRLFScalar(const char* p, const char* end) {
+    while (p < end) {
+        auto cr = static_cast<const char*>(std::memchr(p, '\r', static_cast<size_t>(end - p)));
+        if (cr == nullptr || cr + 1 >= end) return nullptr;
+        if (cr[1] == '\n') return cr;
+        p = cr + 1;
+    }
+    return nullptr;
+}
+
+const char* findFirstOfScalar(const char* p, const char* end, const ByteSet& set) {
+    for (; p < end; ++p) {
+        if (set.contains(*p)) return p;
+    }
+    return nullptr;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 是 x86-64 的基本指令集，不需要检测
+// 一次比较 16 个字节：p 处是 '\r' 且 p + 1 处是 '\n' 的位置
+const char* findCRLFSse2(const char* p, const char* end) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    while (end - p > 16) {
+        __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(cur, cr), _mm_cmpeq_epi8(next, lf)));
+        if (mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        p += 16;
+    }
+    return findCRLFScalar(p, end);
+}
+
+const char* findFirstOfSse2(const char* p, const char* end, const ByteSet& set) {
+    __m128i needles[ByteSet::kMaxVectorBytes];
+    const size_t n = set.size();
+    for (size_t i = 0; i < n; ++i) {
+        needles[i] = _mm_set1_epi8(set.bytes()[i]);
+    }
+    while (end - p >= 16) {
+        __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_setzero_si128();
+        for (size_t i = 0; i < n; ++i) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(cur, needles[i]));
+        }
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        p += 16;
+    }
+    return findFirstOfScalar(p, end, set);
+}
+
+__attribute__((target("avx2")))
+const char* findCRLFAvx2(const char* p, const char* end) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    while (end - p > 32) {
+        __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(cur, cr), _mm256_cmpeq_epi8(next, lf))));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return findCRLFSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findFirstOfAvx2(const char* p, const char* end, const ByteSet& set) {
+    __m256i needles[ByteSet::kMaxVectorBytes];
+    const size_t n = set.size();
+    for (size_t i = 0; i < n; ++i) {
+        needles[i] = _mm256_set1_epi8(set.bytes()[i]);
+    }
+    while (end - p >= 32) {
+        __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_setzero_si256();
+        for (size_t i = 0; i < n; ++i) {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(cur, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    return findFirstOfSse2(p, end, set);
+}
+
+#endif
+
+struct Kernels {
+    const char* (*findCRLF)(const char*, const char*);
+    const char* (*findFirstOf)(const char*, const char*, const ByteSet&);
+};
+
+Kernels selectKernels() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernels{findCRLFAvx2, findFirstOfAvx2};
+    }
+    return Kernels{findCRLFSse2, findFirstOfSse2};
+#else
+    return Kernels{findCRLFScalar, findFirstOfScalar};
+#endif
+}
+
+const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+} // anonymous namespace
+
+namespace simd {
+
+const char* findByte(const char* begin, const char* end, char c) {
+    assert(begin <= end);
+    return static_cast<const char*>(std::memchr(begin, c, static_cast<size_t>(end - begin)));
+}
+
+const char* findCRLF(const char* begin, const char* end) {
+    assert(begin <= end);
+    return kernels().findCRLF(begin, end);
+}
+
+const char* findFirstOf(const char* begin, const char* end, const ByteSet& set) {
+    assert(begin <= end);
+    if (set.size() > ByteSet::kMaxVectorBytes) {
+        return findFirstOfScalar(begin, end, set);
+    }
+    return kernels().findFirstOf(begin, end, set);
+}
+
+} // namespace simd
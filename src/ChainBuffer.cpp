@@ -0,0 +1,240 @@
+#include "knetlib/ChainBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+const size_t ChainBuffer::kBlockSize;
+const size_t ChainBuffer::kMaxReadBlocks;
+
+namespace {
+
+/**
+ * 线程本地的块池，缓存固定大小的空闲块，避免频繁 malloc/free。
+ * 块可能在另一个线程中被释放，此时直接归还到该线程的池中即可，块本身只是一段内存
+ */
+class BlockPool {
+public:
+    static const size_t kMaxFreeBlocks = 256;
+
+    ~BlockPool() {
+        for (char* block : freeBlocks_) {
+            delete[] block;
+        }
+        destroyed_ = true;
+    }
+
+    char* get() {
+        if (freeBlocks_.empty()) {
+            return new char[ChainBuffer::kBlockSize];
+        }
+        char* block = freeBlocks_.back();
+        freeBlocks_.pop_back();
+        return block;
+    }
+
+    void put(char* block) {
+        if (freeBlocks_.size() < kMaxFreeBlocks) {
+            freeBlocks_.push_back(block);
+        }
+        else delete[] block;
+    }
+
+    // 线程退出时池可能先于仍持有块的 ChainBuffer 析构，之后的块直接向系统申请和归还
+    static bool destroyed() {
+        return destroyed_;
+    }
+
+private:
+    std::vector<char*> freeBlocks_;
+    static thread_local bool destroyed_;
+};
+
+thread_local bool BlockPool::destroyed_ = false;
+thread_local BlockPool t_blockPool;
+
+char* getBlock() {
+    return BlockPool::destroyed() ? new char[ChainBuffer::kBlockSize] : t_blockPool.get();
+}
+
+void putBlock(char* block) {
+    if (BlockPool::destroyed()) {
+        delete[] block;
+        return;
+    }
+    t_blockPool.put(block);
+}
+
+} // anonymous namespace
+
+ChainBuffer::ChainBuffer()
+        : readable_(0)
+{}
+
+ChainBuffer::~ChainBuffer() {
+    for (auto& block : blocks_) {
+        putBlock(block.data);
+    }
+}
+
+void ChainBuffer::swap(ChainBuffer& rhs) {
+    blocks_.swap(rhs.blocks_);
+    std::swap(readable_, rhs.readable_);
+}
+
+const char* ChainBuffer::peek() const {
+    if (blocks_.empty()) return nullptr;
+    const Block& front = blocks_.front();
+    return front.data + front.readerIndex;
+}
+
+size_t ChainBuffer::contiguousBytes() const {
+    if (blocks_.empty()) return 0;
+    const Block& front = blocks_.front();
+    return front.writerIndex - front.readerIndex;
+}
+
+size_t ChainBuffer::copyOut(void* dst, size_t len) const {
+    char* out = static_cast<char*>(dst);
+    size_t copied = 0;
+    for (auto it = blocks_.begin(); it != blocks_.end() && copied < len; ++it) {
+        size_t n = std::min(len - copied, it->writerIndex - it->readerIndex);
+        ::memcpy(out + copied, it->data + it->readerIndex, n);
+        copied += n;
+    }
+    return copied;
+}
+
+void ChainBuffer::retrieve(size_t len) {
+    assert(len <= readable_);
+    readable_ -= len;
+    while (len > 0) {
+        Block& front = blocks_.front();
+        size_t n = std::min(len, front.writerIndex - front.readerIndex);
+        front.readerIndex += n;
+        len -= n;
+        // 读空的块直接归还块池，全部读空后不再持有任何块，空闲连接不占用输出缓冲区
+        if (front.readerIndex == front.writerIndex) {
+            releaseFront();
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll() {
+    while (!blocks_.empty()) {
+        releaseFront();
+    }
+    readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len) {
+    assert(len <= readable_);
+    std::string result(len, '\0');
+    copyOut(result.data(), len);
+    retrieve(len);
+    return result;
+}
+
+void ChainBuffer::append(const char* data, size_t len) {
+    while (len > 0) {
+        if (blocks_.empty() || blocks_.back().writerIndex == kBlockSize) {
+            appendBlock();
+        }
+        Block& back = blocks_.back();
+        size_t n = std::min(len, kBlockSize - back.writerIndex);
+        ::memcpy(back.data + back.writerIndex, data, n);
+        back.writerIndex += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+int ChainBuffer::readableIovec(struct iovec* iov, int maxIov) const {
+    int count = 0;
+    for (auto it = blocks_.begin(); it != blocks_.end() && count < maxIov; ++it) {
+        if (it->writerIndex == it->readerIndex) continue;
+        iov[count].iov_base = it->data + it->readerIndex;
+        iov[count].iov_len = it->writerIndex - it->readerIndex;
+        ++count;
+    }
+    return count;
+}
+
+ssize_t ChainBuffer::readFd(int fd, int* savedErrno) {
+    // 先把尾块剩余空间和新块都准备好，readv 直接读进块内，不需要额外的拷贝
+    if (blocks_.empty() || blocks_.back().writerIndex == kBlockSize) {
+        appendBlock();
+    }
+    size_t first = blocks_.size() - 1;
+    while (blocks_.size() - first < kMaxReadBlocks) {
+        appendBlock();
+    }
+
+    struct iovec vec[kMaxReadBlocks];
+    int iovcnt = 0;
+    for (size_t i = first; i < blocks_.size(); ++i) {
+        vec[iovcnt].iov_base = blocks_[i].data + blocks_[i].writerIndex;
+        vec[iovcnt].iov_len = kBlockSize - blocks_[i].writerIndex;
+        ++iovcnt;
+    }
+    const ssize_t n = ::readv(fd, vec, iovcnt);
+
+    if (n < 0) {
+        *savedErrno = errno;
+    }
+    else {
+        size_t remain = static_cast<size_t>(n);
+        for (size_t i = first; i < blocks_.size() && remain > 0; ++i) {
+            size_t filled = std::min(remain, kBlockSize - blocks_[i].writerIndex);
+            blocks_[i].writerIndex += filled;
+            remain -= filled;
+        }
+        readable_ += static_cast<size_t>(n);
+    }
+    trimBack();
+    return n;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* savedErrno, size_t maxBytes) {
+    // 一次 writev 最多 64 个块（1MB），剩余部分等下一次可写事件
+    struct iovec vec[64];
+    int iovcnt = readableIovec(vec, 64);
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (total + vec[i].iov_len >= maxBytes) {
+            vec[i].iov_len = maxBytes - total;
+            iovcnt = i + 1;
+            break;
+        }
+        total += vec[i].iov_len;
+    }
+    if (iovcnt == 0 || maxBytes == 0) return 0;
+    const ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0) {
+        *savedErrno = errno;
+    }
+    else {
+        retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+void ChainBuffer::appendBlock() {
+    blocks_.push_back(Block{getBlock(), 0, 0});
+}
+
+void ChainBuffer::releaseFront() {
+    putBlock(blocks_.front().data);
+    blocks_.pop_front();
+}
+
+void ChainBuffer::trimBack() {
+    // readFd 多准备的空块归还块池
+    while (!blocks_.empty() && blocks_.back().writerIndex == 0) {
+        putBlock(blocks_.back().data);
+        blocks_.pop_back();
+    }
+}
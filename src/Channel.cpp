@@ -5,16 +5,24 @@
 
 Channel::Channel(EventLoop* loop, int fd) :
             pooling(false),
+            registeredEvents(0),
+            updatePending(false),
             loop_(loop),
             fd_(fd),
             tied_(false),
             events_(0),
             revents_(0),
+            edgeTriggered_(false),
+            writing_(false),
             handlingEvents_(false)
 {}
 
 Channel::~Channel() {
     assert(!handlingEvents_ && "handling Events while Channel destructing");
+    // 修改还没有提交就被销毁，从 EventLoop 的待更新列表中删除，避免留下悬空指针
+    if (updatePending) {
+        loop_->removeChannel(this);
+    }
 }
 
 void Channel::setReadCallback(const ReadCallback& callback) {
@@ -68,10 +76,19 @@ void Channel::tie(const std::shared_ptr<void>& rhs) {
 
 void Channel::enableRead() {
     events_ |= (EPOLLIN | EPOLLPRI);
+    if (edgeTriggered_) {
+        events_ |= (EPOLLET | EPOLLOUT);
+    }
     update();
 }
 void Channel::enableWrite() {
+    writing_ = true;
+    // 边缘触发时 EPOLLOUT 已经注册，内核缓冲区由满变为可写时一定会通知
+    if (edgeTriggered_ && (events_ & EPOLLOUT)) return;
     events_ |= EPOLLOUT;
+    if (edgeTriggered_) {
+        events_ |= EPOLLET;
+    }
     update();
 }
 void Channel::disableRead() {
@@ -79,11 +96,14 @@ void Channel::disableRead() {
     update();
 }
 void Channel::disableWrite() {
+    writing_ = false;
+    if (edgeTriggered_) return;
     events_ &= ~EPOLLOUT;
     update();
 }
 void Channel::disableAll() {
     events_ = 0;
+    writing_ = false;
     update();
 }
 
@@ -91,14 +111,18 @@ bool Channel::isReading() const {
     return events_ & EPOLLIN;
 }
 bool Channel::isWriting() const {
-    return events_ & EPOLLOUT;
+    return writing_;
 }
 
-// 兼容旧 API
 void Channel::useET() {
-    // 边缘触发模式在 Epoll 中通过 EPOLLET 标志设置
-    // 这里暂时不实现，因为需要在 Epoll::updateChannel 中处理
-    // 为了兼容性，先保留空实现
+    edgeTriggered_ = true;
+    if (events_ != 0) {
+        events_ |= (EPOLLET | EPOLLOUT);
+        update();
+    }
+}
+bool Channel::isEdgeTriggered() const {
+    return edgeTriggered_;
 }
 
 void Channel::setUseThreadPool(bool use) {
@@ -127,7 +151,9 @@ void Channel::handleEventWithGuard() {
     if (revents_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) {
         if (readCallback_) readCallback_();
     }
-    if (revents_ & EPOLLOUT) {
+    // 边缘触发时 EPOLLOUT 一直注册，没有待写数据时忽略；
+    // 同一轮中读回调关闭了写事件时也不再调用
+    if ((revents_ & EPOLLOUT) && writing_) {
         if (writeCallback_) writeCallback_();
     }
     handlingEvents_ = false;
@@ -4,12 +4,22 @@
 #include "knetlib/utils.h"
 #include <cassert>
 #include <unistd.h>
+#include <algorithm>
 #include <cerrno>
 
+namespace {
+
+const size_t kInitEventListSize = 128;
+// 连续这么多次 poll 只用到不足四分之一时缩小事件数组
+const int kShrinkAfterPolls = 64;
+
+} // anonymous namespace
+
 Epoll::Epoll(EventLoop* loop)
         : loop_(loop),
-          events_(128),
-          epollfd_(epoll_create1(EPOLL_CLOEXEC))
+          events_(kInitEventListSize),
+          epollfd_(epoll_create1(EPOLL_CLOEXEC)),
+          idlePolls_(0)
 {
     if (epollfd_ == -1) {
         errif(true, "Epoll::epoll_create1");
@@ -24,8 +34,12 @@ Epoll::~Epoll() {
 
 void Epoll::poll(ChannelList& activeChannels, int timeout) {
     loop_->assertInLoopThread();
-    int maxEvents = static_cast<int>(events_.size());
-    // 得到触发的event个数，并将epoll_event写入events_缓冲区，最多一次获取128个(初始参数，可调)
+    size_t capacity = events_.size();
+    if (maxEvents_ > 0) {
+        capacity = std::min(capacity, maxEvents_);
+    }
+    int maxEvents = static_cast<int>(capacity);
+    // 得到触发的event个数，并将epoll_event写入events_缓冲区，一次最多获取 maxEvents 个
     int nEvents = epoll_wait(epollfd_, events_.data(), maxEvents, timeout);
     if (nEvents == -1) {
         if (errno != EINTR) { // signal: interrupted sys call
@@ -40,29 +54,48 @@ void Epoll::poll(ChannelList& activeChannels, int timeout) {
             channelPtr->setRevents(events_[i].events); // 事件类型
             activeChannels.push_back(channelPtr); //把该Channel放入活跃队列中
         }
-        if (nEvents == maxEvents) {
+    }
+    adjustEventList(nEvents < 0 ? 0 : static_cast<size_t>(nEvents), capacity);
+}
+
+void Epoll::adjustEventList(size_t nEvents, size_t capacity) {
+    if (nEvents == capacity) {
+        idlePolls_ = 0;
+        // 设置了上限时，数组超过上限也用不到
+        if (maxEvents_ == 0 || events_.size() < maxEvents_) {
             events_.resize(2 * events_.size()); // 扩容
         }
     }
+    else if (nEvents < events_.size() / 4 && events_.size() > kInitEventListSize) {
+        // 突发过后长时间用不到的空间归还给系统
+        if (++idlePolls_ >= kShrinkAfterPolls) {
+            idlePolls_ = 0;
+            std::vector<epoll_event>(events_.size() / 2).swap(events_);
+        }
+    }
+    else {
+        idlePolls_ = 0;
+    }
 }
 
 void Epoll::updateChannel(Channel* channel) {
     loop_->assertInLoopThread();
-    int op = 0;
     // 更新Channel的几种情况
     if (!channel->pooling) { // 如果当前Channel没有被管理，那么这里的更新操作一定是要添加到epoll管理
         assert(!channel->isNoneEvents()); // 既然是新的待添加管理的对象，那么一定是event，设置过想要监听的操作类型
-        op = EPOLL_CTL_ADD;
         channel->pooling = true;
+        updateChannel(EPOLL_CTL_ADD, channel);
     }
     else if (!channel->isNoneEvents()) { // 如果已经被管理了，并且传入的仍然是event，说明是想修改已注册的epfd上的操作或属性
-        op = EPOLL_CTL_MOD;
+        // 与内核中的一致（例如同一轮内打开又关闭了写事件），不需要调用
+        if (channel->events() != channel->registeredEvents) {
+            updateChannel(EPOLL_CTL_MOD, channel);
+        }
     }
     else { // 如果已经被管理，并且传入的不是一个event，表示想要将该注册过的Channel给删除
-        op = EPOLL_CTL_DEL;
         channel->pooling = false;
+        updateChannel(EPOLL_CTL_DEL, channel);
     }
-    updateChannel(op, channel);
 }
 
 void Epoll::removeChannel(Channel* channel) {
@@ -74,8 +107,10 @@ void Epoll::removeChannel(Channel* channel) {
 }
 
 void Epoll::updateChannel(int op, Channel* channel) {
+    countKernelUpdate();
+    channel->registeredEvents = op == EPOLL_CTL_DEL ? 0 : channel->events();
     epoll_event epEv;
-    epEv.events = channel->events();
+    epEv.events = channel->events(); // 边缘触发的 Channel 带有 EPOLLET
     // 在注册事件的时候，附带上了Channel指针，因此epoll_wait得到的event中包含了
     // 事件和对应的Channel指针，因此，不需要单独存储fd->Channel*的映射
     epEv.data.ptr = channel;
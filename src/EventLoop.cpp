@@ -2,12 +2,17 @@
 #include <signal.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 
 #include "knetlib/EventLoop.h"
 #include "knetlib/Channel.h"
+#include "knetlib/IoUringPoller.h"
 #include "knetlib/utils.h"
 #include "knetlib/Logger.h"
+#include "knetlib/ObjectPool.h"
 
 namespace {
 
@@ -33,20 +38,38 @@ IgnoreSigPipe ignore;
 
 } // anonymous namespace
 
-EventLoop::EventLoop()
+// 任务队列的节点，由投递任务的线程从对象池取出，loop 线程执行完后归还
+struct TaskNode : MpscNode {
+    Task task;
+};
+
+EventLoop::EventLoop(PollerBackend backend)
         : tid_(internalGettid()),
           quit_(false),
           doingPendingTasks_(false),
-          poller_(this),
+          poller_(Poller::create(backend, this)),
+          completionPoller_(nullptr),
+          channelUpdateRequests_(0),
+          connectionBufferBytes_(0),
           wakeupfd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
           wakeupChannel_(nullptr),
-          timerQueue_(this)
+          pendingTaskCount_(0),
+          wakeupPending_(false),
+          timerQueue_(this),
+          readBuffer_(0),
+          busyPollBudget_(Nanoseconds::zero()),
+          maxTasksPerIteration_(0)
 {
     // 检查用于事件通知的文件描述符是否被正确创建
     if (wakeupfd_ == -1) {
         errif(true, "EventLoop::eventfd");
     }
 
+    IoUringPoller* ring = dynamic_cast<IoUringPoller*>(poller_.get());
+    if (ring != nullptr && ring->completionIo()) {
+        completionPoller_ = ring;
+    }
+
     wakeupChannel_ = new Channel(this, wakeupfd_);
     wakeupChannel_->setReadCallback([this](){handleRead();});
     wakeupChannel_->enableRead();
@@ -56,6 +79,11 @@ EventLoop::EventLoop()
 }
 
 EventLoop::~EventLoop() {
+    // 仍在列表中的 Channel 都还活着（销毁时会把自己移出列表），清除标记后它们析构时不再访问 EventLoop
+    for (Channel* channel : pendingUpdates_) {
+        channel->updatePending = false;
+    }
+    pendingUpdates_.clear();
     // 注意：析构函数可能在 EventLoop 线程中调用（正常情况），
     // 也可能在其他线程中调用（比如测试场景）
     // 如果不在 EventLoop 线程中，我们不能调用 disableAll()，因为它会调用 updateChannel()
@@ -66,16 +94,20 @@ EventLoop::~EventLoop() {
         if (isInLoopThread()) {
             wakeupChannel_->disableAll(); // 移除对wakeupChannel_的监听
         } else {
-            // 不在 EventLoop 线程中，直接移除 channel（如果已经在 epoll 中）
-            if (wakeupChannel_->pooling) {
-                poller_.removeChannel(wakeupChannel_);
-            }
+            // 不在 EventLoop 线程中，Poller::removeChannel 会断言失败；
+            // 多路复用器随 poller_ 一起关闭，注册关系自然失效，这里只需重置标记
+            wakeupChannel_->pooling = false;
         }
         delete wakeupChannel_;
     }
     if (wakeupfd_ != -1) {
         close(wakeupfd_); // 释放资源
     }
+    // 没来得及执行的任务直接丢弃
+    while (TaskNode* node = pendingTasks_.pop()) {
+        node->task = nullptr;
+        ObjectPool<TaskNode>::release(node);
+    }
     // 只有在 EventLoop 线程中才检查 t_Eventloop
     if (isInLoopThread()) {
         assert(t_Eventloop == this);
@@ -85,16 +117,44 @@ EventLoop::~EventLoop() {
 
 void EventLoop::loop() {
     assertInLoopThread();
-    quit_ = false;
+    // 不在这里清除 quit_：其他线程可能在 loop() 开始之前就调用了 quit()（比如刚启动的
+    // EventLoopThread 马上被 stop），清除会把这次 quit 丢掉，loop 永远不会退出
+    auto lastActive = std::chrono::steady_clock::now();
     while (!quit_) {
         activeChannels_.clear();
-        poller_.poll(activeChannels_); // 得到触发的event，装载入activeChannels_中
+        int timeout = -1;
+        if (busyPollBudget_ > Nanoseconds::zero() &&
+            std::chrono::steady_clock::now() - lastActive < busyPollBudget_) {
+            timeout = 0;
+        }
+        // 上一轮因为任务上限留下了任务，不能阻塞
+        if (maxTasksPerIteration_ > 0 && pendingTaskCount() > 0) {
+            timeout = 0;
+        }
+        applyPendingUpdates();
+        poller_->poll(activeChannels_, timeout); // 得到触发的event，装载入activeChannels_中
         for (auto channelPtr : activeChannels_) {
             channelPtr->handleEvents();
         }
         // 这里的关键是如何使得线程不会被阻塞在epoll_wait，而能顺利执行后续任务，wakeup()
-        doPendingTasks();
+        size_t tasks = doPendingTasks();
+        if (busyPollBudget_ > Nanoseconds::zero() && (!activeChannels_.empty() || tasks > 0)) {
+            lastActive = std::chrono::steady_clock::now();
+        }
     }
+    // 本次 quit 已经生效，之后可以再次调用 loop()
+    quit_ = false;
+}
+
+void EventLoop::setBusyPoll(Nanoseconds budget) {
+    assertInLoopThread();
+    busyPollBudget_ = std::max(budget, Nanoseconds::zero());
+}
+
+void EventLoop::setIterationBudget(size_t maxEvents, size_t maxTasks) {
+    assertInLoopThread();
+    poller_->setMaxEvents(maxEvents);
+    maxTasksPerIteration_ = maxTasks;
 }
 
 void EventLoop::quit() {
@@ -104,13 +164,6 @@ void EventLoop::quit() {
     }
 }
 
-void EventLoop::runInLoop(const Task& task) {
-    if (isInLoopThread()) {
-        task();
-    }
-    else queueInLoop(task);
-}
-
 void EventLoop::runInLoop(Task&& task) {
     if (isInLoopThread()) {
         task();
@@ -118,24 +171,22 @@ void EventLoop::runInLoop(Task&& task) {
     else queueInLoop(std::move(task));
 }
 
-void EventLoop::queueInLoop(const Task& task) {
-    {
-        std::lock_guard<std::mutex> guard(mutex_);
-        pendingTasks_.push_back(task);
-    }
-    // 如果不在循环线程，就唤醒循环线程去处理任务；如果在循环线程，并且正在处理任务，那么同样唤醒
-    if (!isInLoopThread() || doingPendingTasks_) {
-        wakeup();
-    }
+void EventLoop::queueInLoop(Task&& task) {
+    TaskNode* node = ObjectPool<TaskNode>::acquire();
+    node->task = std::move(task);
+    enqueueTask(node);
 }
 
-void EventLoop::queueInLoop(Task&& task) {
-    {
-        std::lock_guard<std::mutex> guard(mutex_);
-        pendingTasks_.push_back(std::move(task));
-    }
+void EventLoop::enqueueTask(TaskNode* node) {
+    // 先计数再入队，消费者取出时计数一定已经加上，不会减成负数
+    pendingTaskCount_.fetch_add(1, std::memory_order_relaxed);
+    pendingTasks_.push(node);
+    // 如果不在循环线程，就唤醒循环线程去处理任务；如果在循环线程，并且正在处理任务，那么同样唤醒。
+    // 已经有人唤醒过且 loop 还没开始处理时，任务一定会在这一轮被取走，不必重复写 eventfd
     if (!isInLoopThread() || doingPendingTasks_) {
-        wakeup();
+        if (!wakeupPending_.exchange(true, std::memory_order_acq_rel)) {
+            wakeup();
+        }
     }
 }
 
@@ -154,12 +205,51 @@ void EventLoop::wakeup() {
 
 void EventLoop::updateChannel(Channel* channel) {
     assertInLoopThread();
-    poller_.updateChannel(channel);
+    channelUpdateRequests_.store(channelUpdateRequests_.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+    if (channel->pooling && !channel->isNoneEvents()) {
+        if (!channel->updatePending) {
+            channel->updatePending = true;
+            pendingUpdates_.push_back(channel);
+        }
+        return;
+    }
+    // 新增必须马上生效；删除之后 Channel 可能马上被销毁，也立即提交
+    cancelPendingUpdate(channel);
+    poller_->updateChannel(channel);
 }
 
 void EventLoop::removeChannel(Channel* channel) {
     assertInLoopThread();
-    poller_.removeChannel(channel);
+    cancelPendingUpdate(channel);
+    poller_->removeChannel(channel);
+}
+
+void EventLoop::applyPendingUpdates() {
+    for (Channel* channel : pendingUpdates_) {
+        channel->updatePending = false;
+        poller_->updateChannel(channel);
+    }
+    pendingUpdates_.clear();
+}
+
+void EventLoop::cancelPendingUpdate(Channel* channel) {
+    if (!channel->updatePending) return;
+    channel->updatePending = false;
+    auto it = std::find(pendingUpdates_.begin(), pendingUpdates_.end(), channel);
+    assert(it != pendingUpdates_.end());
+    *it = pendingUpdates_.back();
+    pendingUpdates_.pop_back();
+}
+
+Buffer& EventLoop::readBuffer() {
+    assertInLoopThread();
+    assert(readBuffer_.readableBytes() == 0);
+    // 突发的大消息可能让上一个连接把它撑大，超出的部分还给 BufferPool
+    if (readBuffer_.capacity() != Buffer::kCheapPrepend + kReadBufferSize) {
+        readBuffer_.shrink(kReadBufferSize);
+    }
+    return readBuffer_;
 }
 
 void EventLoop::assertInLoopThread() {
@@ -179,37 +269,48 @@ bool EventLoop::isInLoopThread() {
     return tid_ == internalGettid();
 }
 
-void EventLoop::doPendingTasks() {
+size_t EventLoop::doPendingTasks() {
     assertInLoopThread();
-    std::vector<Task> tasks;
-    {
-        std::lock_guard<std::mutex> guard(mutex_);
-        tasks.swap(pendingTasks_); // 将原队列对象置换出来，减少临界区范围
+    // 先清除标记再取任务：清除之后入队的生产者会重新唤醒，任务不会被遗漏
+    wakeupPending_.exchange(false, std::memory_order_acq_rel);
+    // 先把当前的任务全部取出再执行，执行过程中新投递的任务留到下一轮，与原先 swap 的语义一致。
+    // 设置了上限时最多取出 maxTasksPerIteration_ 个，其余留在队列中
+    const size_t limit = maxTasksPerIteration_ > 0 ? maxTasksPerIteration_ : SIZE_MAX;
+    while (runningTasks_.size() < limit) {
+        TaskNode* node = pendingTasks_.pop();
+        if (node == nullptr) break;
+        runningTasks_.push_back(node);
     }
+    pendingTaskCount_.fetch_sub(runningTasks_.size(), std::memory_order_relaxed);
     doingPendingTasks_ = true;
-    for (auto& task : tasks) {
-        task();
+    for (TaskNode* node : runningTasks_) {
+        node->task();
+        node->task = nullptr; // 闭包捕获的对象（比如 TcpConnectionPtr）在这里释放，不随节点留在池中
+        ObjectPool<TaskNode>::release(node);
     }
+    const size_t count = runningTasks_.size();
+    runningTasks_.clear();
     doingPendingTasks_ = false;
+    return count;
 }
 
 // 将唤醒用的写入uint64_t给消耗掉
-Timer* EventLoop::runAt(Timestamp when, TimerCallback callback) {
+TimerId EventLoop::runAt(Timestamp when, Task callback) {
     // 添加一个定时器
     return timerQueue_.addTimer(std::move(callback), when, Milliseconds::zero());
 }
 
-Timer* EventLoop::runAfter(Nanoseconds interval, TimerCallback callback) {
+TimerId EventLoop::runAfter(Nanoseconds interval, Task callback) {
     return runAt(time_utils::now() + interval, std::move(callback));
 }
 
 //每隔interval长度的时间触发一次
-Timer* EventLoop::runEvery(Nanoseconds interval, TimerCallback callback) {
+TimerId EventLoop::runEvery(Nanoseconds interval, Task callback) {
     return timerQueue_.addTimer(std::move(callback), time_utils::now() + interval, interval);
 }
 
-void EventLoop::cancelTimer(Timer* timer) {
-    timerQueue_.cancelTimer(timer);
+void EventLoop::cancelTimer(TimerId timerId) {
+    timerQueue_.cancelTimer(timerId);
 }
 
 void EventLoop::handleRead() {
@@ -1,10 +1,20 @@
 #include "knetlib/EventLoopThread.h"
 #include "knetlib/Logger.h"
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <cassert>
 
 EventLoopThread::EventLoopThread()
         : loop_(nullptr),
-          exiting_(false)
+          exiting_(false),
+          numaLocal_(false),
+          busyPollBudget_(Nanoseconds::zero()),
+          maxEventsPerIteration_(0),
+          maxTasksPerIteration_(0),
+          backend_(PollerBackend::kEpoll)
 {
 }
 
@@ -12,6 +22,37 @@ EventLoopThread::~EventLoopThread() {
     stop();
 }
 
+void EventLoopThread::setName(const std::string& name) {
+    assert(loop_ == nullptr);
+    name_ = name;
+}
+
+void EventLoopThread::setCpuAffinity(const std::vector<int>& cpus) {
+    assert(loop_ == nullptr);
+    cpus_ = cpus;
+}
+
+void EventLoopThread::setNumaLocal(bool on) {
+    assert(loop_ == nullptr);
+    numaLocal_ = on;
+}
+
+void EventLoopThread::setBusyPoll(Nanoseconds budget) {
+    assert(loop_ == nullptr);
+    busyPollBudget_ = budget;
+}
+
+void EventLoopThread::setIterationBudget(size_t maxEvents, size_t maxTasks) {
+    assert(loop_ == nullptr);
+    maxEventsPerIteration_ = maxEvents;
+    maxTasksPerIteration_ = maxTasks;
+}
+
+void EventLoopThread::setPollerBackend(PollerBackend backend) {
+    assert(loop_ == nullptr);
+    backend_ = backend;
+}
+
 EventLoop* EventLoopThread::startLoop() {
     assert(loop_ == nullptr);
     
@@ -49,8 +90,60 @@ void EventLoopThread::stop() {
     }
 }
 
+void EventLoopThread::setupThread() {
+    if (!name_.empty()) {
+        // 线程名最长 16 字节（含结尾的 '\0'）
+        std::string name = name_.substr(0, 15);
+        int err = pthread_setname_np(pthread_self(), name.c_str());
+        if (err != 0) {
+            errno = err;
+            SYSERR("EventLoopThread pthread_setname_np");
+        }
+    }
+
+    if (!cpus_.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus_) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            errno = err;
+            SYSERR("EventLoopThread pthread_setaffinity_np");
+        }
+    }
+
+    if (numaLocal_) {
+        // 此时线程已经运行在绑定的 CPU 上，查出该 CPU 所在的节点
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == -1) {
+            SYSERR("EventLoopThread getcpu");
+            return;
+        }
+        unsigned long nodemask = 0;
+        if (node >= sizeof(nodemask) * 8) {
+            ERROR("EventLoopThread numa node %u out of range", node);
+            return;
+        }
+        // MPOL_PREFERRED：优先在本节点分配，本节点内存不足时仍可以使用其他节点
+        nodemask = 1UL << node;
+        if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8) == -1) {
+            SYSERR("EventLoopThread set_mempolicy");
+            return;
+        }
+        INFO("EventLoopThread %s runs on cpu %u, prefer numa node %u", name_.c_str(), cpu, node);
+    }
+}
+
 void EventLoopThread::threadFunc() {
-    EventLoop loop;
+    setupThread();
+    EventLoop loop(backend_);
+    loop.setBusyPoll(busyPollBudget_);
+    loop.setIterationBudget(maxEventsPerIteration_, maxTasksPerIteration_);
     
     {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -1,13 +1,38 @@
 #include "knetlib/EventLoopThreadPool.h"
 #include "knetlib/EventLoop.h"
+#include "knetlib/InetAddress.h"
 #include "knetlib/Logger.h"
+#include <algorithm>
 #include <cassert>
 
+namespace {
+
+// 每个工作线程在哈希环上的虚拟节点数，节点越多分布越均匀
+const int kVirtualNodes = 160;
+
+uint64_t mix64(uint64_t x) {
+    // splitmix64 的终结函数
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+} // anonymous namespace
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop)
         : baseLoop_(baseLoop),
           numThreads_(0),
           next_(0),
-          started_(false)
+          started_(false),
+          strategy_(LoadBalance::kRoundRobin),
+          numaLocal_(false),
+          busyPollBudget_(Nanoseconds::zero()),
+          maxEventsPerIteration_(0),
+          maxTasksPerIteration_(0),
+          backend_(PollerBackend::kEpoll)
 {
     assert(baseLoop_ != nullptr);
 }
@@ -17,6 +42,13 @@ EventLoopThreadPool::~EventLoopThreadPool() {
     // 让 EventLoopThread 的析构函数自动处理
 }
 
+void EventLoopThreadPool::setCpuAffinity(const std::vector<int>& cpus) {
+    cpuSets_.clear();
+    for (int cpu : cpus) {
+        cpuSets_.push_back({cpu});
+    }
+}
+
 void EventLoopThreadPool::start() {
     assert(!started_);
     assert(baseLoop_->isInLoopThread());
@@ -26,10 +58,33 @@ void EventLoopThreadPool::start() {
     // 创建并启动工作线程
     for (int i = 0; i < numThreads_; ++i) {
         auto thread = std::make_unique<EventLoopThread>();
+        if (!namePrefix_.empty()) {
+            thread->setName(namePrefix_ + std::to_string(i));
+        }
+        if (!cpuSets_.empty()) {
+            thread->setCpuAffinity(cpuSets_[i % cpuSets_.size()]);
+        }
+        thread->setNumaLocal(numaLocal_);
+        thread->setBusyPoll(busyPollBudget_);
+        thread->setIterationBudget(maxEventsPerIteration_, maxTasksPerIteration_);
+        thread->setPollerBackend(backend_);
         EventLoop* loop = thread->startLoop();
         threads_.push_back(std::move(thread));
         loops_.push_back(loop);
     }
+
+    connections_ = std::make_unique<std::atomic<size_t>[]>(loops_.size() + 1);
+    for (size_t i = 0; i <= loops_.size(); ++i) {
+        connections_[i].store(0, std::memory_order_relaxed);
+    }
+    if (strategy_ == LoadBalance::kConsistentHash) {
+        for (size_t i = 0; i < loops_.size(); ++i) {
+            for (int v = 0; v < kVirtualNodes; ++v) {
+                hashRing_.emplace_back(mix64((uint64_t(i) << 32) | uint64_t(v)), i);
+            }
+        }
+        std::sort(hashRing_.begin(), hashRing_.end());
+    }
     
     INFO("EventLoopThreadPool::start() with %d threads", numThreads_);
 }
@@ -38,20 +93,84 @@ EventLoop* EventLoopThreadPool::getNextLoop() {
     assert(started_);
     assert(baseLoop_->isInLoopThread());
     
-    EventLoop* loop = baseLoop_;
-    
-    // 如果有工作线程，使用轮询算法分配
-    if (!loops_.empty()) {
-        loop = loops_[next_];
-        ++next_;
-        if (static_cast<size_t>(next_) >= loops_.size()) {
-            next_ = 0;
-        }
+    // 没有工作线程时所有连接都在主线程
+    if (loops_.empty()) return baseLoop_;
+
+    switch (strategy_) {
+        case LoadBalance::kLeastConnections:
+            return leastLoaded([this](size_t i) {
+                return connections_[i + 1].load(std::memory_order_relaxed);
+            });
+        case LoadBalance::kLeastPendingTasks:
+            return leastLoaded([this](size_t i) { return loops_[i]->pendingTaskCount(); });
+        case LoadBalance::kRoundRobin:
+        case LoadBalance::kConsistentHash:
+            break;
+    }
+    return roundRobin();
+}
+
+EventLoop* EventLoopThreadPool::getNextLoop(const InetAddress& peer) {
+    if (strategy_ != LoadBalance::kConsistentHash || loops_.empty()) {
+        return getNextLoop();
+    }
+    assert(started_);
+    // 只按 IP 哈希，同一客户端的多个连接（端口不同）落在同一个线程
+    uint64_t hash = mix64(peer.getAddr().sin_addr.s_addr);
+    auto it = std::lower_bound(hashRing_.begin(), hashRing_.end(), std::make_pair(hash, size_t(0)));
+    if (it == hashRing_.end()) {
+        it = hashRing_.begin();
+    }
+    return loops_[it->second];
+}
+
+void EventLoopThreadPool::connectionOpened(EventLoop* loop) {
+    connections_[indexOf(loop)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventLoopThreadPool::connectionClosed(EventLoop* loop) {
+    connections_[indexOf(loop)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t EventLoopThreadPool::numConnections(EventLoop* loop) const {
+    return connections_[indexOf(loop)].load(std::memory_order_relaxed);
+}
+
+size_t EventLoopThreadPool::indexOf(EventLoop* loop) const {
+    assert(started_);
+    if (loop == baseLoop_) return 0;
+    auto it = std::find(loops_.begin(), loops_.end(), loop);
+    assert(it != loops_.end());
+    return static_cast<size_t>(it - loops_.begin()) + 1;
+}
+
+EventLoop* EventLoopThreadPool::roundRobin() {
+    EventLoop* loop = loops_[next_];
+    ++next_;
+    if (static_cast<size_t>(next_) >= loops_.size()) {
+        next_ = 0;
     }
-    
     return loop;
 }
 
+template<typename Load>
+EventLoop* EventLoopThreadPool::leastLoaded(Load&& load) {
+    const size_t n = loops_.size();
+    const size_t start = static_cast<size_t>(next_);
+    size_t best = start;
+    size_t bestLoad = load(start);
+    for (size_t k = 1; k < n && bestLoad > 0; ++k) {
+        size_t i = (start + k) % n;
+        size_t current = load(i);
+        if (current < bestLoad) {
+            best = i;
+            bestLoad = current;
+        }
+    }
+    next_ = static_cast<int>((best + 1) % n);
+    return loops_[best];
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() {
     assert(started_);
     std::vector<EventLoop*> allLoops;
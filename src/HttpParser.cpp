@@ -0,0 +1,335 @@
+#include "knetlib/HttpParser.h"
+#include "knetlib/Buffer.h"
+#include "knetlib/ByteSearch.h"
+#include <strings.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 数据块大小行（含扩展）的长度上限
+const size_t kMaxChunkLine = 1024;
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && ::strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+// 找 [p, end) 中第一个 '\n'，找不到时返回 end
+const char* findNewline(const char* p, const char* end) {
+    const char* found = simd::findByte(p, end, '\n');
+    return found != nullptr ? found : end;
+}
+
+// 找头部结束的空行（"\r\n\r\n" 或 "\n\n"），返回空行之后的位置，找不到时返回 nullptr
+const char* findHeaderEnd(const char* p, const char* end) {
+    while ((p = findNewline(p, end)) != end) {
+        if (p + 1 < end && p[1] == '\n') return p + 2;
+        if (p + 2 < end && p[1] == '\r' && p[2] == '\n') return p + 3;
+        ++p;
+    }
+    return nullptr;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+// Connection 头是逗号分隔的选项列表
+bool hasToken(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        if (equalsIgnoreCase(trim(list.substr(0, comma)), token)) return true;
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+bool parseDecimal(std::string_view s, uint64_t* value) {
+    if (s.empty() || s.size() > 19) return false;
+    uint64_t result = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') return false;
+        result = result * 10 + static_cast<uint64_t>(c - '0');
+    }
+    *value = result;
+    return true;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // anonymous namespace
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (size_t i = 0; i < numHeaders_; ++i) {
+        if (equalsIgnoreCase(headers_[i].name, name)) {
+            return headers_[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+HttpParser::HttpParser(size_t maxHeaderSize, size_t maxBodySize)
+        : maxHeaderSize_(maxHeaderSize),
+          maxBodySize_(maxBodySize)
+{
+    reset();
+}
+
+void HttpParser::reset() {
+    state_ = kHeaders;
+    scanned_ = 0;
+    headerLength_ = 0;
+    contentLength_ = 0;
+    chunkRemain_ = 0;
+    bodyEnd_ = 0;
+    reparse_ = false;
+    errorStatus_ = 0;
+}
+
+void HttpParser::retrieveRequest(Buffer& buffer) {
+    buffer.retrieve(scanned_);
+    reset();
+}
+
+HttpParser::Result HttpParser::fail(int status) {
+    errorStatus_ = status;
+    return kError;
+}
+
+HttpParser::Result HttpParser::parse(Buffer& buffer) {
+    if (state_ == kHeaders) {
+        // 请求之间多余的空行（例如上一个请求体后面跟着的 CRLF）直接丢弃
+        while (buffer.readableBytes() > 0 && (*buffer.peek() == '\r' || *buffer.peek() == '\n')) {
+            buffer.retrieve(1);
+            scanned_ = 0;
+        }
+        const char* begin = buffer.peek();
+        const char* end = begin + buffer.readableBytes();
+        // 上次扫描末尾可能停在 "\r\n\r" 的中间，退回两个字节
+        const char* headerEnd = findHeaderEnd(begin + (scanned_ > 2 ? scanned_ - 2 : 0), end);
+        if (headerEnd == nullptr) {
+            scanned_ = buffer.readableBytes();
+            return scanned_ > maxHeaderSize_ ? fail(431) : kIncomplete;
+        }
+        headerLength_ = static_cast<size_t>(headerEnd - begin);
+        if (headerLength_ > maxHeaderSize_) return fail(431);
+        if (!parseHeaders(begin, headerEnd)) return kError;
+        scanned_ = headerLength_;
+        bodyEnd_ = headerLength_;
+        if (state_ == kHeaders) {
+            state_ = kBody;
+        }
+    }
+
+    // 请求体可能在可写视图上就地解码，buffer 的数据区是非 const 的
+    char* base = buffer.beginWrite() - buffer.readableBytes();
+    const size_t readable = buffer.readableBytes();
+
+    if (state_ == kBody) {
+        if (readable - headerLength_ < contentLength_) {
+            // 请求体的大小已知，一次扩容到位
+            buffer.ensureWritableBytes(static_cast<size_t>(contentLength_) - (readable - headerLength_));
+            reparse_ = true;
+            return kIncomplete;
+        }
+        scanned_ = headerLength_ + static_cast<size_t>(contentLength_);
+        bodyEnd_ = scanned_;
+        state_ = kDone;
+    }
+
+    while (state_ != kDone) {
+        if (state_ == kChunkData) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(chunkRemain_, readable - scanned_));
+            // 解码位置永远不超过扫描位置，前移到已解码的数据之后
+            if (bodyEnd_ != scanned_) {
+                std::memmove(base + bodyEnd_, base + scanned_, n);
+            }
+            bodyEnd_ += n;
+            scanned_ += n;
+            chunkRemain_ -= n;
+            if (chunkRemain_ > 0) break;
+            state_ = kChunkEnd;
+            continue;
+        }
+        if (state_ == kChunkEnd) {
+            if (readable - scanned_ < 1) break;
+            if (base[scanned_] == '\n') {
+                scanned_ += 1;
+            }
+            else {
+                if (readable - scanned_ < 2) break;
+                if (base[scanned_] != '\r' || base[scanned_ + 1] != '\n') return fail(400);
+                scanned_ += 2;
+            }
+            state_ = kChunkSize;
+            continue;
+        }
+
+        // kChunkSize 和 kTrailers 都以行为单位
+        const char* line = base + scanned_;
+        const char* newline = findNewline(line, base + readable);
+        if (newline == base + readable) {
+            if (readable - scanned_ > kMaxChunkLine) return fail(400);
+            break;
+        }
+        std::string_view text(line, static_cast<size_t>(newline - line));
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+        scanned_ = static_cast<size_t>(newline + 1 - base);
+
+        if (state_ == kTrailers) {
+            // 尾部字段不关心，直到空行为止
+            if (text.empty()) state_ = kDone;
+            continue;
+        }
+        uint64_t size = 0;
+        size_t digits = 0;
+        for (; digits < text.size(); ++digits) {
+            int v = hexValue(text[digits]);
+            if (v < 0) break;
+            // 超过 16 位十六进制数会在移位时溢出
+            if (digits == 16) return fail(413);
+            size = (size << 4) | static_cast<uint64_t>(v);
+        }
+        // 大小之后只能是扩展（';'）或空白
+        if (digits == 0 || (digits < text.size() && text[digits] != ';' &&
+                            text[digits] != ' ' && text[digits] != '\t')) {
+            return fail(400);
+        }
+        if (size == 0) {
+            state_ = kTrailers;
+        }
+        else {
+            // 已解码的长度不超过 maxBodySize_，减法不会回绕；加法在 size 很大时会
+            if (size > maxBodySize_ - (bodyEnd_ - headerLength_)) return fail(413);
+            chunkRemain_ = size;
+            state_ = kChunkData;
+        }
+    }
+
+    if (state_ != kDone) {
+        reparse_ = true;
+        return kIncomplete;
+    }
+    // 跨多次读取完成的请求，缓冲区可能已经搬移，从头部重新生成视图
+    if (reparse_) {
+        parseHeaders(base, base + headerLength_);
+        state_ = kDone;
+    }
+    request_.body_ = std::string_view(base + headerLength_, bodyEnd_ - headerLength_);
+    return kComplete;
+}
+
+bool HttpParser::parseHeaders(const char* begin, const char* end) {
+    HttpRequest& req = request_;
+    req.numHeaders_ = 0;
+    req.body_ = std::string_view();
+
+    // 请求行：METHOD SP target SP HTTP/1.x
+    const char* newline = findNewline(begin, end);
+    std::string_view line(begin, static_cast<size_t>(newline - begin));
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+    if (sp1 == 0 || sp2 == std::string_view::npos || sp2 == sp1 + 1) {
+        fail(400);
+        return false;
+    }
+    req.method_ = line.substr(0, sp1);
+    std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view version = line.substr(sp2 + 1);
+    if (version.size() != 8 || version.substr(0, 5) != "HTTP/") {
+        fail(400);
+        return false;
+    }
+    if (version.substr(5) == "1.1") {
+        req.versionMinor_ = 1;
+    }
+    else if (version.substr(5) == "1.0") {
+        req.versionMinor_ = 0;
+    }
+    else {
+        fail(505);
+        return false;
+    }
+    size_t question = target.find('?');
+    req.path_ = target.substr(0, question);
+    req.query_ = question == std::string_view::npos ? std::string_view() : target.substr(question + 1);
+
+    // 头部字段，直到空行
+    bool hasContentLength = false;
+    bool chunked = false;
+    bool transferEncoding = false;
+    bool close = false;
+    bool keepAlive = false;
+    contentLength_ = 0;
+    for (const char* p = newline + 1; p < end; p = newline + 1) {
+        newline = findNewline(p, end);
+        line = std::string_view(p, static_cast<size_t>(newline - p));
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) break;
+        // 不支持已废弃的折行
+        if (line.front() == ' ' || line.front() == '\t') {
+            fail(400);
+            return false;
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon == 0 ||
+            line[colon - 1] == ' ' || line[colon - 1] == '\t') {
+            fail(400);
+            return false;
+        }
+        if (req.numHeaders_ == HttpRequest::kMaxHeaders) {
+            fail(431);
+            return false;
+        }
+        HttpHeader& header = req.headers_[req.numHeaders_++];
+        header.name = line.substr(0, colon);
+        header.value = trim(line.substr(colon + 1));
+
+        if (equalsIgnoreCase(header.name, "Content-Length")) {
+            uint64_t length = 0;
+            if (!parseDecimal(header.value, &length) || (hasContentLength && length != contentLength_)) {
+                fail(400);
+                return false;
+            }
+            hasContentLength = true;
+            contentLength_ = length;
+        }
+        else if (equalsIgnoreCase(header.name, "Transfer-Encoding")) {
+            transferEncoding = true;
+            chunked = equalsIgnoreCase(header.value, "chunked");
+        }
+        else if (equalsIgnoreCase(header.name, "Connection")) {
+            close = close || hasToken(header.value, "close");
+            keepAlive = keepAlive || hasToken(header.value, "keep-alive");
+        }
+    }
+    req.keepAlive_ = !close && (req.versionMinor_ == 1 || keepAlive);
+
+    if (transferEncoding) {
+        if (hasContentLength) {
+            fail(400);
+            return false;
+        }
+        if (!chunked) {
+            fail(501);
+            return false;
+        }
+        if (state_ == kHeaders) {
+            state_ = kChunkSize;
+        }
+    }
+    else if (contentLength_ > maxBodySize_) {
+        fail(413);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,127 @@
+#include "knetlib/HttpResponse.h"
+#include "knetlib/HttpRequest.h"
+#include "knetlib/Buffer.h"
+#include <cassert>
+#include <charconv>
+#include <ctime>
+
+namespace {
+
+std::string_view statusLine(HttpResponse::StatusCode status) {
+    switch (status) {
+    case HttpResponse::k200Ok: return "HTTP/1.1 200 OK\r\n";
+    case HttpResponse::k201Created: return "HTTP/1.1 201 Created\r\n";
+    case HttpResponse::k204NoContent: return "HTTP/1.1 204 No Content\r\n";
+    case HttpResponse::k301MovedPermanently: return "HTTP/1.1 301 Moved Permanently\r\n";
+    case HttpResponse::k302Found: return "HTTP/1.1 302 Found\r\n";
+    case HttpResponse::k304NotModified: return "HTTP/1.1 304 Not Modified\r\n";
+    case HttpResponse::k400BadRequest: return "HTTP/1.1 400 Bad Request\r\n";
+    case HttpResponse::k403Forbidden: return "HTTP/1.1 403 Forbidden\r\n";
+    case HttpResponse::k404NotFound: return "HTTP/1.1 404 Not Found\r\n";
+    case HttpResponse::k405MethodNotAllowed: return "HTTP/1.1 405 Method Not Allowed\r\n";
+    case HttpResponse::k413PayloadTooLarge: return "HTTP/1.1 413 Payload Too Large\r\n";
+    case HttpResponse::k431RequestHeaderFieldsTooLarge: return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+    case HttpResponse::k500InternalServerError: return "HTTP/1.1 500 Internal Server Error\r\n";
+    case HttpResponse::k501NotImplemented: return "HTTP/1.1 501 Not Implemented\r\n";
+    case HttpResponse::k503ServiceUnavailable: return "HTTP/1.1 503 Service Unavailable\r\n";
+    case HttpResponse::k505VersionNotSupported: return "HTTP/1.1 505 HTTP Version Not Supported\r\n";
+    }
+    return "HTTP/1.1 500 Internal Server Error\r\n";
+}
+
+// "Date: ...\r\nServer: KnetLib\r\n"，每个线程每秒最多格式化一次
+std::string_view commonHeaders() {
+    thread_local time_t cachedSecond = 0;
+    thread_local char cached[80];
+    thread_local size_t cachedLength = 0;
+    time_t now = ::time(nullptr);
+    if (now != cachedSecond) {
+        struct tm tm;
+        ::gmtime_r(&now, &tm);
+        cachedLength = ::strftime(cached, sizeof(cached),
+                                  "Date: %a, %d %b %Y %H:%M:%S GMT\r\nServer: KnetLib\r\n", &tm);
+        cachedSecond = now;
+    }
+    return std::string_view(cached, cachedLength);
+}
+
+} // anonymous namespace
+
+HttpResponse::HttpResponse(Buffer* output, const HttpRequest& request)
+        : output_(output),
+          status_(k200Ok),
+          close_(!request.keepAlive()),
+          http10_(request.versionMinor() == 0),
+          headRequest_(request.isHead()),
+          started_(false),
+          finished_(false)
+{
+}
+
+HttpResponse::HttpResponse(Buffer* output, StatusCode status)
+        : output_(output),
+          status_(status),
+          close_(true),
+          http10_(false),
+          headRequest_(false),
+          started_(false),
+          finished_(false)
+{
+}
+
+void HttpResponse::setStatus(StatusCode status) {
+    assert(!started_ && "setStatus() after addHeader()/setBody()");
+    status_ = status;
+}
+
+void HttpResponse::setCloseConnection(bool on) {
+    assert(!finished_);
+    close_ = on;
+}
+
+void HttpResponse::writeStatusLine() {
+    started_ = true;
+    std::string_view line = statusLine(status_);
+    std::string_view common = commonHeaders();
+    output_->append(line.data(), line.size());
+    output_->append(common.data(), common.size());
+}
+
+void HttpResponse::addHeader(std::string_view name, std::string_view value) {
+    assert(!finished_);
+    if (!started_) writeStatusLine();
+    output_->ensureWritableBytes(name.size() + value.size() + 4);
+    output_->append(name.data(), name.size());
+    output_->append(": ", 2);
+    output_->append(value.data(), value.size());
+    output_->append("\r\n", 2);
+}
+
+void HttpResponse::setBody(std::string_view body) {
+    assert(!finished_);
+    if (!started_) writeStatusLine();
+    finished_ = true;
+    if (close_) {
+        output_->append("Connection: close\r\n", 19);
+    }
+    else if (http10_) {
+        output_->append("Connection: keep-alive\r\n", 24);
+    }
+    // 204 不能带 Content-Length
+    if (status_ != k204NoContent) {
+        char length[40] = "Content-Length: ";
+        auto result = std::to_chars(length + 16, length + sizeof(length), body.size());
+        output_->append(length, static_cast<size_t>(result.ptr - length));
+        output_->append("\r\n", 2);
+    }
+    output_->append("\r\n", 2);
+    if (!headRequest_ && status_ != k204NoContent && status_ != k304NotModified) {
+        output_->append(body.data(), body.size());
+    }
+}
+
+void HttpResponse::finish() {
+    if (!finished_) {
+        setBody(std::string_view());
+    }
+}
@@ -0,0 +1,83 @@
+#include "knetlib/HttpServer.h"
+#include "knetlib/HttpParser.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/Buffer.h"
+#include <any>
+#include <cassert>
+
+namespace {
+
+// 保存在 TcpConnection 的 context 中，连接建立时创建一次，之后反复使用
+struct HttpContext {
+    HttpContext(size_t maxHeaderSize, size_t maxBodySize)
+            : parser(maxHeaderSize, maxBodySize),
+              closing(false)
+    {}
+
+    HttpParser parser;
+    Buffer output;  // 同一批流水线请求的应答
+    bool closing;   // 已经回复了要求关闭的应答，之后收到的数据直接丢弃
+};
+
+void defaultHttpCallback(const HttpRequest&, HttpResponse& response) {
+    response.setStatus(HttpResponse::k404NotFound);
+}
+
+} // anonymous namespace
+
+HttpServer::HttpServer(EventLoop* loop, const InetAddress& local)
+        : server_(loop, local),
+          maxHeaderSize_(HttpParser::kDefaultMaxHeaderSize),
+          maxBodySize_(HttpParser::kDefaultMaxBodySize),
+          httpCallback_(defaultHttpCallback)
+{
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) { onConnection(conn); });
+    server_.setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buffer) {
+        onMessage(conn, buffer);
+    });
+}
+
+void HttpServer::start() {
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr& conn) {
+    if (conn->connected()) {
+        conn->getContext().emplace<HttpContext>(maxHeaderSize_, maxBodySize_);
+    }
+}
+
+void HttpServer::onMessage(const TcpConnectionPtr& conn, Buffer& buffer) {
+    auto context = std::any_cast<HttpContext>(&conn->getContext());
+    assert(context != nullptr);
+    if (context->closing) {
+        buffer.retrieveAll();
+        return;
+    }
+    HttpParser& parser = context->parser;
+    Buffer& output = context->output;
+    while (!context->closing) {
+        HttpParser::Result result = parser.parse(buffer);
+        if (result == HttpParser::kIncomplete) {
+            break;
+        }
+        if (result == HttpParser::kError) {
+            HttpResponse response(&output, static_cast<HttpResponse::StatusCode>(parser.errorStatus()));
+            response.finish();
+            buffer.retrieveAll();
+            context->closing = true;
+            break;
+        }
+        HttpResponse response(&output, parser.request());
+        httpCallback_(parser.request(), response);
+        response.finish();
+        context->closing = response.closeConnection();
+        parser.retrieveRequest(buffer);
+    }
+    if (output.readableBytes() > 0) {
+        conn->send(output);
+    }
+    if (context->closing) {
+        conn->shutdown();
+    }
+}
@@ -0,0 +1,88 @@
+#include "knetlib/IdleTimeoutWheel.h"
+#include "knetlib/EventLoop.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/Logger.h"
+#include <algorithm>
+#include <cassert>
+
+IdleTimeoutWheel::IdleTimeoutWheel(EventLoop* loop, Nanoseconds timeout)
+        : loop_(loop),
+          timeout_(timeout),
+          current_(0),
+          size_(0)
+{
+    assert(timeout_ > Nanoseconds::zero());
+    std::fill(std::begin(buckets_), std::end(buckets_), nullptr);
+    // tick 不小于 1ms，太短的超时时间没有意义
+    Nanoseconds tick = std::max<Nanoseconds>(timeout_ / kBuckets, Milliseconds(1));
+    timer_ = loop_->runEvery(tick, [this]() { onTick(); });
+}
+
+IdleTimeoutWheel::~IdleTimeoutWheel() {
+    loop_->assertInLoopThread();
+    loop_->cancelTimer(timer_);
+    // 轮上剩下的连接只摘掉节点，不关闭
+    for (Entry*& head : buckets_) {
+        while (head != nullptr) {
+            unlink(head);
+        }
+    }
+}
+
+void IdleTimeoutWheel::add(Entry* entry) {
+    loop_->assertInLoopThread();
+    assert(entry->bucket == -1 && entry->conn != nullptr);
+    link(entry, current_);
+    ++size_;
+}
+
+void IdleTimeoutWheel::touch(Entry* entry) {
+    // 同一个 tick 内的多次读写只有第一次需要移动
+    if (entry->bucket == current_ || entry->bucket == -1) return;
+    unlink(entry);
+    link(entry, current_);
+}
+
+void IdleTimeoutWheel::remove(Entry* entry) {
+    if (entry->bucket == -1) return;
+    unlink(entry);
+    --size_;
+}
+
+void IdleTimeoutWheel::onTick() {
+    loop_->assertInLoopThread();
+    // 下一个桶里是 kBuckets 个 tick 之前最后一次活动的连接，每次从桶头摘下一个再关闭。
+    // 关闭一个连接的回调里可能关闭或者读写同一个桶里的其他连接，它们的 remove/touch 看到的始终是完整的链表；
+    // 关闭期间有活动的连接移到仍为当前桶的 current_，不会在这一轮被关闭
+    const int expired = (current_ + 1) % kNumSlots;
+    while (Entry* entry = buckets_[expired]) {
+        unlink(entry);
+        --size_;
+
+        TcpConnectionPtr conn = entry->conn->shared_from_this();
+        INFO("TcpConnection %s idle for %lld ms, close it",
+             conn->name().c_str(),
+             static_cast<long long>(std::chrono::duration_cast<Milliseconds>(timeout_).count()));
+        conn->forceClose();
+    }
+    current_ = expired;
+}
+
+void IdleTimeoutWheel::link(Entry* entry, int bucket) {
+    entry->prev = nullptr;
+    entry->next = buckets_[bucket];
+    if (entry->next != nullptr) {
+        entry->next->prev = entry;
+    }
+    buckets_[bucket] = entry;
+    entry->bucket = bucket;
+}
+
+void IdleTimeoutWheel::unlink(Entry* entry) {
+    if (entry->prev != nullptr) entry->prev->next = entry->next;
+    else buckets_[entry->bucket] = entry->next;
+    if (entry->next != nullptr) entry->next->prev = entry->prev;
+    entry->prev = nullptr;
+    entry->next = nullptr;
+    entry->bucket = -1;
+}
@@ -0,0 +1,551 @@
+#include "knetlib/IoUringPoller.h"
+#include "knetlib/Channel.h"
+#include "knetlib/EventLoop.h"
+#include "knetlib/Logger.h"
+#include "knetlib/ObjectPool.h"
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+// SQ 的大小，CQ 默认是它的两倍；提交队列满时会先提交再继续
+const unsigned kRingEntries = 1024;
+
+// 取消请求等不需要处理的完成事件
+const uint64_t kIgnoredId = 0;
+
+// 完成请求的 id 带上最高位，和 Channel 的 poll 请求区分开
+const uint64_t kOperationBit = 1ULL << 63;
+
+// 接收缓冲区组的组号，每个 io_uring 只用一组
+const uint16_t kRecvBufferGroup = 0;
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+unsigned loadAcquire(const unsigned* p) {
+    return std::atomic_ref<const unsigned>(*p).load(std::memory_order_acquire);
+}
+
+void storeRelease(unsigned* p, unsigned value) {
+    std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+}
+
+} // anonymous namespace
+
+// 一个完成请求，从对象池中取出，请求结束后归还
+struct IoUringPoller::Operation {
+    enum Kind { kAccept, kRecv, kSend };
+
+    Kind kind = kAccept;
+    bool forgotten = false;
+    AcceptCallback accept;
+    RecvCallback recv;
+    SendCallback send;
+    // sendmsg 的参数，请求结束之前内核可能还会读取
+    struct msghdr msg;
+    struct iovec iov[kMaxSendIov];
+};
+
+std::unique_ptr<IoUringPoller> IoUringPoller::create(EventLoop* loop) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = ioUringSetup(kRingEntries, &params);
+    if (fd == -1) {
+        SYSERR("IoUringPoller io_uring_setup");
+        return nullptr;
+    }
+    // 多次触发的 poll 需要 5.13，用同版本引入的 RSRC_TAGS 判断；带超时的等待需要 EXT_ARG
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                              IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+    if ((params.features & required) != required) {
+        WARN("IoUringPoller kernel features 0x%x not supported", params.features);
+        ::close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<IoUringPoller> poller(new IoUringPoller(loop, fd));
+    if (!poller->setupRings(&params)) {
+        return nullptr;
+    }
+    poller->completionIo_ = poller->setupCompletionIo();
+    return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop* loop, int ringfd)
+        : loop_(loop),
+          ringfd_(ringfd),
+          sqRing_(MAP_FAILED),
+          sqRingSize_(0),
+          cqRing_(MAP_FAILED),
+          cqRingSize_(0),
+          sqes_(nullptr),
+          sqesSize_(0),
+          sqHead_(nullptr),
+          sqTail_(nullptr),
+          sqMask_(0),
+          sqEntries_(0),
+          cqHead_(nullptr),
+          cqTail_(nullptr),
+          cqMask_(0),
+          cqes_(nullptr),
+          sqLocalTail_(0),
+          toSubmit_(0),
+          nextId_(kIgnoredId + 1),
+          completionIo_(false),
+          recvBuffers_(nullptr)
+{
+}
+
+IoUringPoller::~IoUringPoller() {
+    // 先关闭 io_uring，内核取消所有未完成的请求，之后才释放它们引用的缓冲区
+    if (ringfd_ != -1) {
+        ::close(ringfd_);
+    }
+    if (sqes_ != nullptr) {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (sqRing_ != MAP_FAILED) {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (recvBuffers_ != nullptr) {
+        ::munmap(recvBuffers_, kRecvBufferSize * kRecvBufferCount);
+    }
+    // 回调可能持有连接，连接在这里析构
+    for (auto& item : operations_) {
+        Operation* op = item.second;
+        op->accept = nullptr;
+        op->recv = nullptr;
+        op->send = nullptr;
+        ObjectPool<Operation>::release(op);
+    }
+}
+
+bool IoUringPoller::setupRings(const void* p) {
+    const io_uring_params& params = *static_cast<const io_uring_params*>(p);
+    // SINGLE_MMAP：SQ 环和 CQ 环在同一次映射中
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringfd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        SYSERR("IoUringPoller mmap sq ring");
+        return false;
+    }
+    cqRing_ = sqRing_;
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringfd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        SYSERR("IoUringPoller mmap sqes");
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    // SQ 数组与 SQE 一一对应，之后只需要移动尾部
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i) {
+        array[i] = i;
+    }
+    sqLocalTail_ = *sqTail_;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool IoUringPoller::setupCompletionIo() {
+    // 多次触发的 recv 和 SEND_ZC 同在 6.0 引入，用后者判断；多次触发的 accept 更早（5.19）
+    const unsigned kProbeOps = 256;
+    std::vector<char> storage(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (ioUringRegister(ringfd_, IORING_REGISTER_PROBE, probe, kProbeOps) == -1) {
+        return false;
+    }
+    if (probe->last_op < IORING_OP_SEND_ZC ||
+        (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED) == 0) {
+        return false;
+    }
+
+    // 匿名映射只占虚拟地址，内核第一次收数据进某个缓冲区时才分配物理页
+    void* buffers = ::mmap(nullptr, kRecvBufferSize * kRecvBufferCount, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) {
+        SYSERR("IoUringPoller mmap recv buffers");
+        return false;
+    }
+    recvBuffers_ = static_cast<char*>(buffers);
+
+    // 第一次提供缓冲区时等待结果，确认内核接受
+    provideRecvBuffers(0, kRecvBufferCount);
+    enter(1, -1);
+    unsigned head = *cqHead_;
+    if (head == loadAcquire(cqTail_)) {
+        return false;
+    }
+    int res = cqes_[head & cqMask_].res;
+    storeRelease(cqHead_, head + 1);
+    if (res < 0) {
+        errno = -res;
+        SYSERR("IoUringPoller provide buffers");
+        return false;
+    }
+    return true;
+}
+
+void IoUringPoller::provideRecvBuffers(unsigned bid, unsigned count) {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(recvBuffers_ + bid * kRecvBufferSize);
+    sqe->len = static_cast<uint32_t>(kRecvBufferSize);
+    sqe->off = bid;
+    sqe->buf_group = kRecvBufferGroup;
+    sqe->user_data = kIgnoredId;
+}
+
+void IoUringPoller::returnRecvBuffers() {
+    if (returnedBuffers_.empty()) return;
+    std::sort(returnedBuffers_.begin(), returnedBuffers_.end());
+    size_t begin = 0;
+    for (size_t i = 1; i <= returnedBuffers_.size(); ++i) {
+        if (i == returnedBuffers_.size() || returnedBuffers_[i] != returnedBuffers_[i - 1] + 1) {
+            provideRecvBuffers(returnedBuffers_[begin], static_cast<unsigned>(i - begin));
+            begin = i;
+        }
+    }
+    returnedBuffers_.clear();
+}
+
+void IoUringPoller::poll(ChannelList& activeChannels, int timeout) {
+    loop_->assertInLoopThread();
+    // 上一轮触发过的单次 poll 重新提交，和本次等待一起进入内核
+    for (uint64_t id : rearm_) {
+        auto it = channels_.find(id);
+        if (it == channels_.end()) continue;
+        Channel* channel = it->second;
+        Registration& registration = registrations_[channel];
+        if (!registration.armed) {
+            arm(channel, registration);
+        }
+    }
+    rearm_.clear();
+
+    enter(timeout == 0 ? 0 : 1, timeout);
+
+    unsigned head = *cqHead_;
+    unsigned tail = loadAcquire(cqTail_);
+    // 超过上限的完成事件留在 CQ 中，下一次 enter 会立即返回
+    if (maxEvents_ > 0 && tail - head > maxEvents_) {
+        tail = head + static_cast<unsigned>(maxEvents_);
+    }
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        if (cqe.user_data == kIgnoredId) continue;
+        completions_.push_back(Completion{cqe.user_data, cqe.res, cqe.flags});
+    }
+    storeRelease(cqHead_, head);
+
+    // 先执行完成请求的回调。回调中可能关闭连接、注销甚至销毁 Channel，
+    // 所以之后再按 id 查找就绪的 Channel，已经注销的不会出现在 activeChannels 中
+    for (const Completion& completion : completions_) {
+        if (completion.id & kOperationBit) {
+            complete(completion.id, completion.res, completion.flags);
+        }
+    }
+    // 用完的接收缓冲区和下一次等待一起归还内核
+    returnRecvBuffers();
+    for (const Completion& completion : completions_) {
+        if (completion.id & kOperationBit) continue;
+        auto it = channels_.find(completion.id);
+        if (it == channels_.end()) continue; // 已经取消或修改过的旧请求
+        Channel* channel = it->second;
+        Registration& registration = registrations_[channel];
+        const bool more = (completion.flags & IORING_CQE_F_MORE) != 0;
+        if (!more) {
+            registration.armed = false;
+        }
+
+        unsigned revents = 0;
+        if (completion.res >= 0) {
+            revents = static_cast<unsigned>(completion.res);
+            if (!more) {
+                rearm_.push_back(registration.id);
+            }
+        }
+        else if (completion.res == -ECANCELED) {
+            continue;
+        }
+        else {
+            // fd 已经无效等错误，报告给 Channel 一次，不再重新提交，避免空转
+            errno = -completion.res;
+            SYSERR("IoUringPoller poll fd=%d", channel->fd());
+            revents = EPOLLERR;
+        }
+        channel->setRevents(revents);
+        activeChannels.push_back(channel);
+    }
+    completions_.clear();
+}
+
+void IoUringPoller::updateChannel(Channel* channel) {
+    loop_->assertInLoopThread();
+    if (!channel->pooling) {
+        assert(!channel->isNoneEvents());
+        channel->pooling = true;
+        Registration& registration = registrations_[channel];
+        // 同一地址上已经销毁但没有注销的 Channel 留下的请求
+        if (registration.id != kIgnoredId) {
+            disarm(registration);
+        }
+        registration = Registration{nextId_++, channel->events(), false};
+        channels_[registration.id] = channel;
+        arm(channel, registration);
+        countKernelUpdate();
+        return;
+    }
+
+    Registration& registration = registrations_[channel];
+    if (channel->isNoneEvents()) {
+        disarm(registration);
+        registrations_.erase(channel);
+        channel->pooling = false;
+        return;
+    }
+    if (registration.events == channel->events()) return;
+    // 修改监听：取消旧请求，用新的 id 提交新请求
+    disarm(registration);
+    registration = Registration{nextId_++, channel->events(), false};
+    channels_[registration.id] = channel;
+    arm(channel, registration);
+    countKernelUpdate();
+}
+
+void IoUringPoller::removeChannel(Channel* channel) {
+    loop_->assertInLoopThread();
+    if (!channel->pooling) return;
+    auto it = registrations_.find(channel);
+    if (it != registrations_.end()) {
+        disarm(it->second);
+        registrations_.erase(it);
+    }
+    channel->pooling = false;
+}
+
+void IoUringPoller::arm(Channel* channel, Registration& registration) {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = channel->fd();
+    // EPOLLET 不是 poll 的事件位，用多次触发的 poll 代替
+    sqe->poll32_events = registration.events & ~static_cast<unsigned>(EPOLLET);
+    if (registration.events & EPOLLET) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = registration.id;
+    registration.armed = true;
+}
+
+void IoUringPoller::disarm(Registration& registration) {
+    channels_.erase(registration.id);
+    if (registration.armed) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = registration.id;
+        sqe->user_data = kIgnoredId;
+        registration.armed = false;
+        countKernelUpdate();
+    }
+    registration.id = kIgnoredId;
+}
+
+uint64_t IoUringPoller::acceptMultishot(int listenfd, AcceptCallback callback) {
+    loop_->assertInLoopThread();
+    assert(completionIo_);
+    Operation* op = ObjectPool<Operation>::acquire();
+    op->kind = Operation::kAccept;
+    op->accept = std::move(callback);
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenfd;
+    // 对端地址之后用 getpeername 取得：多次触发时所有连接共用同一块地址内存
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    return submitOperation(op, sqe);
+}
+
+uint64_t IoUringPoller::recvMultishot(int fd, RecvCallback callback) {
+    loop_->assertInLoopThread();
+    assert(completionIo_);
+    Operation* op = ObjectPool<Operation>::acquire();
+    op->kind = Operation::kRecv;
+    op->recv = std::move(callback);
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kRecvBufferGroup;
+    return submitOperation(op, sqe);
+}
+
+uint64_t IoUringPoller::send(int fd, const struct iovec* iov, int iovcnt, SendCallback callback) {
+    loop_->assertInLoopThread();
+    assert(completionIo_);
+    assert(iovcnt > 0);
+    Operation* op = ObjectPool<Operation>::acquire();
+    op->kind = Operation::kSend;
+    op->send = std::move(callback);
+    iovcnt = std::min(iovcnt, kMaxSendIov);
+    std::copy(iov, iov + iovcnt, op->iov);
+    std::memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = op->iov;
+    op->msg.msg_iovlen = static_cast<size_t>(iovcnt);
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&op->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    return submitOperation(op, sqe);
+}
+
+void IoUringPoller::cancel(uint64_t id) {
+    loop_->assertInLoopThread();
+    if (operations_.find(id) == operations_.end()) return;
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = id;
+    sqe->user_data = kIgnoredId;
+}
+
+void IoUringPoller::cancelAndForget(uint64_t id) {
+    loop_->assertInLoopThread();
+    auto it = operations_.find(id);
+    if (it == operations_.end()) return;
+    Operation* op = it->second;
+    assert(op->kind != Operation::kSend);
+    op->forgotten = true;
+    op->accept = nullptr;
+    op->recv = nullptr;
+    cancel(id);
+}
+
+uint64_t IoUringPoller::submitOperation(Operation* op, io_uring_sqe* sqe) {
+    uint64_t id = nextId_++ | kOperationBit;
+    sqe->user_data = id;
+    operations_[id] = op;
+    completionRequests_.store(completionRequests_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return id;
+}
+
+void IoUringPoller::complete(uint64_t id, int res, unsigned flags) {
+    auto it = operations_.find(id);
+    if (it == operations_.end()) return;
+    Operation* op = it->second;
+    const bool more = (flags & IORING_CQE_F_MORE) != 0;
+    completionEvents_.store(completionEvents_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    switch (op->kind) {
+        case Operation::kAccept:
+            if (!op->forgotten) {
+                op->accept(res, more);
+            }
+            else if (res >= 0) {
+                ::close(res);
+            }
+            break;
+        case Operation::kRecv:
+            if ((flags & IORING_CQE_F_BUFFER) != 0) {
+                unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+                if (!op->forgotten) {
+                    op->recv(recvBuffers_ + bid * kRecvBufferSize, res, more);
+                }
+                returnedBuffers_.push_back(static_cast<uint16_t>(bid));
+            }
+            else if (!op->forgotten) {
+                op->recv(nullptr, res, more);
+            }
+            break;
+        case Operation::kSend:
+            op->send(res);
+            break;
+    }
+
+    // 请求已经结束，回调中可能提交了新请求，迭代器已经失效，按 id 删除
+    if (!more) {
+        operations_.erase(id);
+        op->forgotten = false;
+        op->accept = nullptr;
+        op->recv = nullptr;
+        op->send = nullptr;
+        ObjectPool<Operation>::release(op);
+    }
+}
+
+io_uring_sqe* IoUringPoller::nextSqe() {
+    // 提交队列满了先提交一次，不等待
+    if (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_) {
+        enter(0, 0);
+    }
+    io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++sqLocalTail_;
+    ++toSubmit_;
+    return sqe;
+}
+
+void IoUringPoller::enter(unsigned minComplete, int timeout) {
+    storeRelease(sqTail_, sqLocalTail_);
+    unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    void* argp = nullptr;
+    size_t argSize = 0;
+    if (minComplete > 0 && timeout > 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout % 1000) * 1000000;
+        std::memset(&arg, 0, sizeof(arg));
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argSize = sizeof(arg);
+    }
+    int ret = ioUringEnter(ringfd_, toSubmit_, minComplete, flags, argp, argSize);
+    if (ret >= 0) {
+        toSubmit_ -= std::min(toSubmit_, static_cast<unsigned>(ret));
+        return;
+    }
+    // 被信号打断、超时、完成队列暂时满了都是正常的：未提交的 SQE 留到下一次 enter
+    if (errno != EINTR && errno != ETIME && errno != EAGAIN && errno != EBUSY) {
+        SYSERR("IoUringPoller io_uring_enter");
+    }
+}
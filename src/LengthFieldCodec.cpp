@@ -0,0 +1,130 @@
+#include "knetlib/LengthFieldCodec.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/Logger.h"
+#include <sys/uio.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+// 帧头（前缀 + 长度字段）的最大长度，发送时帧头在栈上编码
+const size_t kMaxInlineHeader = 64;
+
+} // anonymous namespace
+
+LengthFieldCodec::LengthFieldCodec(const FrameCallback& callback,
+                                   int lengthFieldSize,
+                                   ByteOrder byteOrder,
+                                   size_t maxFrameSize,
+                                   size_t lengthFieldOffset)
+        : frameCallback_(callback),
+          lengthFieldSize_(lengthFieldSize),
+          byteOrder_(byteOrder),
+          maxFrameSize_(maxFrameSize),
+          lengthFieldOffset_(lengthFieldOffset)
+{
+    assert(lengthFieldSize == 1 || lengthFieldSize == 2 || lengthFieldSize == 4 || lengthFieldSize == 8);
+    assert(headerLength() <= kMaxInlineHeader);
+}
+
+void LengthFieldCodec::onMessage(const TcpConnectionPtr& conn, Buffer& buffer) {
+    const size_t headerLen = headerLength();
+    while (buffer.readableBytes() >= headerLen) {
+        uint64_t length = decodeLength(buffer.peek() + lengthFieldOffset_);
+        if (length > maxFrameSize_) {
+            ERROR("LengthFieldCodec frame length %llu exceeds %zu, close connection",
+                  static_cast<unsigned long long>(length), maxFrameSize_);
+            buffer.retrieveAll();
+            if (conn) conn->forceClose();
+            return;
+        }
+        const size_t frameLen = headerLen + static_cast<size_t>(length);
+        if (buffer.readableBytes() < frameLen) {
+            // 已经知道整帧的大小，提前扩容减少接收大帧时的扩容次数；
+            // 预留量有上限，只发帧头的连接占不了多少内存
+            buffer.ensureWritableBytes(std::min(frameLen - buffer.readableBytes(), kMaxReserveBytes));
+            break;
+        }
+        // 回调返回后才移动读指针，string_view 在回调期间始终有效
+        frameCallback_(conn, std::string_view(buffer.peek() + headerLen, static_cast<size_t>(length)));
+        buffer.retrieve(frameLen);
+    }
+}
+
+void LengthFieldCodec::send(const TcpConnectionPtr& conn, Buffer& payload, std::string_view prefix) {
+    char header[kMaxInlineHeader];
+    size_t headerLen = encodeHeader(payload.readableBytes(), prefix, header);
+    if (headerLen == 0) {
+        payload.retrieveAll();
+        return;
+    }
+    if (headerLen <= payload.prependableBytes()) {
+        payload.prepend(header, headerLen);
+        conn->send(payload);
+    }
+    else {
+        // 预留空间不够（前缀较长或调用方用掉了预留空间），帧头和负载分两段发送
+        struct iovec parts[2] = {
+            {header, headerLen},
+            {const_cast<char*>(payload.peek()), payload.readableBytes()},
+        };
+        conn->send(std::span<const struct iovec>(parts, 2));
+        payload.retrieveAll();
+    }
+}
+
+void LengthFieldCodec::send(const TcpConnectionPtr& conn, std::string_view payload, std::string_view prefix) {
+    char header[kMaxInlineHeader];
+    size_t headerLen = encodeHeader(payload.size(), prefix, header);
+    if (headerLen == 0) return;
+    struct iovec parts[2] = {
+        {header, headerLen},
+        {const_cast<char*>(payload.data()), payload.size()},
+    };
+    conn->send(std::span<const struct iovec>(parts, 2));
+}
+
+bool LengthFieldCodec::checkLength(size_t length) const {
+    if (length > maxFrameSize_) return false;
+    if (lengthFieldSize_ == 8) return true;
+    return static_cast<uint64_t>(length) < (uint64_t(1) << (8 * lengthFieldSize_));
+}
+
+uint64_t LengthFieldCodec::decodeLength(const char* data) const {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    uint64_t length = 0;
+    if (byteOrder_ == kBigEndian) {
+        for (int i = 0; i < lengthFieldSize_; ++i) {
+            length = (length << 8) | bytes[i];
+        }
+    }
+    else {
+        for (int i = lengthFieldSize_ - 1; i >= 0; --i) {
+            length = (length << 8) | bytes[i];
+        }
+    }
+    return length;
+}
+
+void LengthFieldCodec::encodeLength(uint64_t length, char* data) const {
+    for (int i = 0; i < lengthFieldSize_; ++i) {
+        int index = byteOrder_ == kBigEndian ? lengthFieldSize_ - 1 - i : i;
+        data[index] = static_cast<char>(length & 0xff);
+        length >>= 8;
+    }
+}
+
+size_t LengthFieldCodec::encodeHeader(size_t length, std::string_view prefix, char* header) const {
+    if (prefix.size() != lengthFieldOffset_) {
+        ERROR("LengthFieldCodec prefix size %zu, expected %zu", prefix.size(), lengthFieldOffset_);
+        return 0;
+    }
+    if (!checkLength(length)) {
+        ERROR("LengthFieldCodec payload length %zu cannot be encoded, give up send", length);
+        return 0;
+    }
+    std::memcpy(header, prefix.data(), prefix.size());
+    encodeLength(length, header + lengthFieldOffset_);
+    return headerLength();
+}
@@ -0,0 +1,15 @@
+#include "knetlib/Poller.h"
+#include "knetlib/Epoll.h"
+#include "knetlib/IoUringPoller.h"
+#include "knetlib/Logger.h"
+
+std::unique_ptr<Poller> Poller::create(PollerBackend backend, EventLoop* loop) {
+    if (backend == PollerBackend::kIoUring) {
+        std::unique_ptr<Poller> poller = IoUringPoller::create(loop);
+        if (poller) {
+            return poller;
+        }
+        WARN("Poller io_uring unavailable, fall back to epoll");
+    }
+    return std::make_unique<Epoll>(loop);
+}
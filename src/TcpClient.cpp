@@ -11,7 +11,6 @@ TcpClient::TcpClient(EventLoop* loop, const InetAddress& peer)
         : loop_(loop),
           connected_(false),
           peer_(peer),
-          retryTimer_(nullptr),
           connector_(new Connector(loop, peer))
 {
     connector_->setNewConnectionCallback(std::bind(
@@ -27,7 +26,7 @@ TcpClient::~TcpClient() {
     if (connection_ && !connection_->disconnected()) {
         connection_->forceClose();
     }
-    if (retryTimer_ != nullptr) {
+    if (retryTimer_.valid()) {
         loop_->cancelTimer(retryTimer_);
     }
 }
@@ -79,13 +78,15 @@ void TcpClient::retry() {
 void TcpClient::newConnection(int connfd, const InetAddress& local, const InetAddress& peer) {
     loop_->assertInLoopThread();
     loop_->cancelTimer(retryTimer_);
-    retryTimer_ = nullptr;
+    retryTimer_ = TimerId();
     connected_ = true;
-    auto conn = std::make_shared<TcpConnection>(loop_, connfd, local, peer);
+    auto conn = TcpConnection::create(loop_, connfd, local, peer);
     connection_ = conn;
-    conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(std::bind(&TcpClient::closeConnection, this, std::placeholders::_1));
+    auto callbacks = std::make_shared<TcpConnectionCallbacks>();
+    callbacks->message = messageCallback_;
+    callbacks->writeComplete = writeCompleteCallback_;
+    callbacks->close = [this](const TcpConnectionPtr& conn) { closeConnection(conn); };
+    conn->setCallbacks(std::move(callbacks));
 
     conn->connectEstablished();
     if (connectionCallback_) {
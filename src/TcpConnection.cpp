@@ -1,13 +1,36 @@
 #include "knetlib/TcpConnection.h"
 #include "knetlib/EventLoop.h"
+#include "knetlib/IoUringPoller.h"
 #include "knetlib/Logger.h"
+#include "knetlib/ObjectPool.h"
 #include "knetlib/utils.h"
 #include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <climits>
+#include <algorithm>
 #include <cerrno>
 #include <cassert>
 #include <cstring>
 
+// 跨线程 send 的数据块，data 的容量随块一起回收复用
+// 跨线程的 send、sendFile、shutdown 都经过 sendQueue_，loop 线程按调用顺序处理
+struct SendChunk : MpscNode {
+    enum Kind { kData, kFile, kShutdown };
+
+    Kind kind = kData;
+    std::string data;
+    // kFile：要发送的文件区间，fd 由 sendFile() 复制，交给 sendFileInLoop 后归它关闭
+    int fd = -1;
+    off_t offset = 0;
+    size_t len = 0;
+
+    static SendChunk* acquire();
+    static void release(SendChunk* chunk);
+};
+
 namespace {
 
 enum ConnectState {
@@ -17,26 +40,84 @@ enum ConnectState {
     kDisconnected
 };
 
+// drainSendQueue 一次 writev 最多合并的数据块个数
+const int kMaxSendBatch = 64;
+
+// 容量超过该值的 string 不回收，避免偶尔的大消息长期占住内存
+const size_t kMaxRecycledCapacity = 64 * 1024;
+
+// 尚未设置回调的连接共用的空回调
+const TcpConnectionCallbacksPtr& noCallbacks() {
+    static const TcpConnectionCallbacksPtr callbacks = std::make_shared<TcpConnectionCallbacks>();
+    return callbacks;
+}
+
 } // anonymous namespace
 
+// 数据块由生产者线程取出、在 loop 线程归还，经 ObjectPool 跨线程复用
+SendChunk* SendChunk::acquire() {
+    return ObjectPool<SendChunk>::acquire();
+}
+
+void SendChunk::release(SendChunk* chunk) {
+    if (chunk->data.capacity() > kMaxRecycledCapacity) {
+        std::string().swap(chunk->data);
+    }
+    chunk->data.clear();
+    chunk->kind = kData;
+    chunk->fd = -1;
+    ObjectPool<SendChunk>::release(chunk);
+}
+
 TcpConnection::TcpConnection(EventLoop* loop, int sockfd, const InetAddress& local, const InetAddress& peer)
         : loop_(loop),
+          ring_(loop->completionPoller()),
           sockfd_(sockfd),
           channel_(loop, sockfd_),
           state_(kConnecting),
           local_(local),
           peer_(peer),
-          highWaterMark_(0)
+          inputBuffer_(0),
+          bufferBytes_(0),
+          sparseReads_(0),
+          inMessageCallback_(false),
+          fileBytes_(0),
+          regionedBytes_(0),
+          sendScheduled_(false),
+          highWaterMark_(0),
+          readBudget_(kDefaultReadBudget),
+          sharedReadBuffer_(false),
+          recvId_(0),
+          sendId_(0),
+          recvWanted_(false),
+          idleWheel_(nullptr),
+          callbacks_(noCallbacks())
 {
     channel_.setReadCallback([this](){handleRead();});
     channel_.setWriteCallback([this](){handleWrite();});
     channel_.setCloseCallback([this](){handleClose();});
     channel_.setErrorCallback([this](){handleError();});
+    idleEntry_.conn = this;
 
-    TRACE("TcpConnection() {} fd={}", name().c_str(), sockfd_);
+    // name() 要拼接字符串，没有开启 TRACE 时不生成
+    if (logLevel == LOG_LEVEL::LOG_LEVEL_TRACE) {
+        TRACE("TcpConnection() %s fd=%d", name().c_str(), sockfd_);
+    }
 }
 
 TcpConnection::~TcpConnection() {
+    if (idleWheel_ != nullptr) {
+        idleWheel_->remove(&idleEntry_);
+    }
+    clearFileRegions();
+    while (SendChunk* chunk = sendQueue_.pop()) {
+        if (chunk->fd != -1) {
+            ::close(chunk->fd);
+        }
+        SendChunk::release(chunk);
+    }
+    // 析构时 loop 可能已经不存在（比如用户代码持有的 TcpClient 连接），这里不能再访问 loop_。
+    // 缓冲区字节数在 handleClose 中清零，Channel 的监听也在那里注销
     int currentState = state_.load(std::memory_order_acquire);
     // 如果连接状态不是 kDisconnected，说明连接没有被正确关闭
     // 这可能发生在 EventLoop 退出时，连接还在运行
@@ -50,25 +131,56 @@ TcpConnection::~TcpConnection() {
         }
         // 注意：我们不设置状态为 kDisconnected，因为对象正在析构
     } else {
-        TRACE("~TcpConnection() {} fd={}", name().c_str(), sockfd_);
+        if (logLevel == LOG_LEVEL::LOG_LEVEL_TRACE) {
+            TRACE("~TcpConnection() %s fd=%d", name().c_str(), sockfd_);
+        }
         if (sockfd_ != -1) {
             close(sockfd_);
         }
     }
 }
 
+TcpConnectionPtr TcpConnection::create(EventLoop* loop, int sockfd,
+                                       const InetAddress& local, const InetAddress& peer) {
+    return std::allocate_shared<TcpConnection>(PoolAllocator<TcpConnection>(), loop, sockfd, local, peer);
+}
+
+void TcpConnection::setCallbacks(TcpConnectionCallbacksPtr callbacks) {
+    assert(callbacks != nullptr);
+    callbacks_ = std::move(callbacks);
+}
 void TcpConnection::setMessageCallback(const MessageCallback& callback) {
-    messageCallback_ = callback;
+    auto callbacks = std::make_shared<TcpConnectionCallbacks>(*callbacks_);
+    callbacks->message = callback;
+    callbacks_ = std::move(callbacks);
 }
 void TcpConnection::setWriteCompleteCallback(const WriteCompleteCallback& callback) {
-    writeCompleteCallback_ = callback;
+    auto callbacks = std::make_shared<TcpConnectionCallbacks>(*callbacks_);
+    callbacks->writeComplete = callback;
+    callbacks_ = std::move(callbacks);
 }
 void TcpConnection::setHighWaterMarkCallback(const HighWaterMarkCallback& callback, size_t mark) {
     highWaterMark_ = mark;
     highWaterMarkCallback_ = callback;
 }
 void TcpConnection::setCloseCallback(const CloseCallback& callback) {
-    closeCallback_ = callback;
+    auto callbacks = std::make_shared<TcpConnectionCallbacks>(*callbacks_);
+    callbacks->close = callback;
+    callbacks_ = std::move(callbacks);
+}
+
+void TcpConnection::setEdgeTriggered(size_t readBudget) {
+    loop_->assertInLoopThread();
+    assert(state_.load(std::memory_order_acquire) == kConnecting);
+    assert(readBudget > 0);
+    readBudget_ = readBudget;
+    channel_.useET();
+}
+
+void TcpConnection::setSharedReadBuffer(bool on) {
+    loop_->assertInLoopThread();
+    assert(state_.load(std::memory_order_acquire) == kConnecting);
+    sharedReadBuffer_ = on;
 }
 
 void TcpConnection::connectEstablished() {
@@ -76,8 +188,21 @@ void TcpConnection::connectEstablished() {
     assert(state_.load(std::memory_order_acquire) == kConnecting);
     state_.store(kConnected, std::memory_order_release);
     channel_.tie(shared_from_this()); // 将socketfd_的Channel和TcpConnection绑定
+    if (ring_ != nullptr) {
+        // 读由 recv 请求完成，Channel 只在发送文件区间时等待可写
+        recvWanted_ = true;
+        startRecv();
+        return;
+    }
     channel_.enableRead(); // 打开socket的读
 }
+void TcpConnection::setIdleTimeoutWheel(IdleTimeoutWheel* wheel) {
+    loop_->assertInLoopThread();
+    assert(idleWheel_ == nullptr);
+    if (state_.load(std::memory_order_acquire) == kDisconnected) return;
+    idleWheel_ = wheel;
+    idleWheel_->add(&idleEntry_);
+}
 bool TcpConnection::connected() const {
     return state_.load(std::memory_order_acquire) == kConnected;
 }
@@ -108,6 +233,21 @@ std::any& TcpConnection::getContext() {
 void TcpConnection::send(const std::string& data) {
     send(data.data(), data.length());
 }
+void TcpConnection::send(std::string&& data) {
+    if (state_.load(std::memory_order_acquire) != kConnected) {
+        WARN("TcpConnection::send() not connected, give up send");
+        return;
+    }
+    if (loop_->isInLoopThread()) {
+        sendInLoop(data);
+    }
+    else {
+        SendChunk* chunk = SendChunk::acquire();
+        // 交换而不是拷贝，调用方的 string 顺便拿走数据块原先的空闲内存
+        chunk->data.swap(data);
+        queueSendChunk(chunk);
+    }
+}
 void TcpConnection::send(const char* data, size_t len) {
     if (state_.load(std::memory_order_acquire) != kConnected) {
         WARN("TcpConnection::send() not connected, give up send");
@@ -119,9 +259,9 @@ void TcpConnection::send(const char* data, size_t len) {
     }
     // 多Reactor，没有在自己所属的EventLoop中
     else {
-        loop_->queueInLoop(
-                [ptr = shared_from_this(), str = std::string(data, data+len)]()
-                { ptr->sendInLoop(str);});
+        SendChunk* chunk = SendChunk::acquire();
+        chunk->data.assign(data, len);
+        queueSendChunk(chunk);
     }
 }
 void TcpConnection::send(Buffer& buffer) {
@@ -134,7 +274,102 @@ void TcpConnection::send(Buffer& buffer) {
         buffer.retrieveAll();
     }
     else {
-        loop_->queueInLoop([ptr = shared_from_this(), str = buffer.retrieveAllAsString()](){ptr->sendInLoop(str);});
+        SendChunk* chunk = SendChunk::acquire();
+        chunk->data.assign(buffer.peek(), buffer.readableBytes());
+        buffer.retrieveAll();
+        queueSendChunk(chunk);
+    }
+}
+
+void TcpConnection::send(std::span<const struct iovec> parts) {
+    if (state_.load(std::memory_order_acquire) != kConnected) {
+        WARN("TcpConnection::send() not connected, give up send");
+        return;
+    }
+    if (loop_->isInLoopThread()) {
+        sendInLoop(parts.data(), static_cast<int>(parts.size()));
+    }
+    else {
+        // 跨线程时调用方的内存不能被引用到 loop 线程中，只能拼接成一份拷贝
+        SendChunk* chunk = SendChunk::acquire();
+        for (const auto& part : parts) {
+            chunk->data.append(static_cast<const char*>(part.iov_base), part.iov_len);
+        }
+        queueSendChunk(chunk);
+    }
+}
+
+void TcpConnection::queueSendChunk(SendChunk* chunk) {
+    sendQueue_.push(chunk);
+    // 只有把 sendScheduled_ 从 false 置为 true 的那次 send 才投递任务并唤醒 loop，
+    // 同一批次里其余的 send 只入队，不再碰 EventLoop 的任务队列
+    if (!sendScheduled_.exchange(true, std::memory_order_acq_rel)) {
+        loop_->queueInLoop([ptr = shared_from_this()]() { ptr->drainSendQueue(); });
+    }
+}
+
+void TcpConnection::drainSendQueue() {
+    loop_->assertInLoopThread();
+    // 先清除标记再取数据：之后入队的生产者会看到 false 并重新投递任务，不会有数据被遗漏
+    sendScheduled_.exchange(false, std::memory_order_acq_rel);
+
+    struct iovec iov[kMaxSendBatch];
+    SendChunk* batch[kMaxSendBatch];
+    int count = 0;
+    auto flush = [&]() {
+        if (count == 0) return;
+        sendInLoop(iov, count);
+        for (int i = 0; i < count; ++i) {
+            SendChunk::release(batch[i]);
+        }
+        count = 0;
+    };
+    while (SendChunk* chunk = sendQueue_.pop()) {
+        if (chunk->kind != SendChunk::kData) {
+            // 先把排在前面的数据交给 sendInLoop，文件区间和关闭写端才不会越过它们
+            flush();
+            if (chunk->kind == SendChunk::kFile) {
+                int fd = chunk->fd;
+                chunk->fd = -1;
+                sendFileInLoop(fd, chunk->offset, chunk->len);
+            }
+            else {
+                shutdownInLoop();
+            }
+            SendChunk::release(chunk);
+            continue;
+        }
+        batch[count] = chunk;
+        iov[count].iov_base = chunk->data.data();
+        iov[count].iov_len = chunk->data.size();
+        if (++count == kMaxSendBatch) {
+            flush();
+        }
+    }
+    flush();
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len) {
+    if (state_.load(std::memory_order_acquire) != kConnected) {
+        WARN("TcpConnection::sendFile() not connected, give up send");
+        return;
+    }
+    int filefd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (filefd == -1) {
+        SYSERR("TcpConnection::sendFile() dup");
+        return;
+    }
+    if (loop_->isInLoopThread()) {
+        sendFileInLoop(filefd, offset, len);
+    }
+    else {
+        // 和跨线程的 send 走同一个队列，排在之前 send 的数据之后
+        SendChunk* chunk = SendChunk::acquire();
+        chunk->kind = SendChunk::kFile;
+        chunk->fd = filefd;
+        chunk->offset = offset;
+        chunk->len = len;
+        queueSendChunk(chunk);
     }
 }
 
@@ -145,8 +380,10 @@ void TcpConnection::shutdown() {
             shutdownInLoop();
         }
         else {
-            // 成员函数第一个隐藏形参为this指针
-            loop_->queueInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
+            // 排在之前跨线程 send、sendFile 的数据之后再关闭写端
+            SendChunk* chunk = SendChunk::acquire();
+            chunk->kind = SendChunk::kShutdown;
+            queueSendChunk(chunk);
         }
     }
 }
@@ -165,27 +402,31 @@ void TcpConnection::forceClose() {
 }
 
 void TcpConnection::stopRead() {
-    loop_->runInLoop([this]() {
-        if (channel_.isReading()) {
-            channel_.disableRead();
-        }
-    });
+    // 在 loop 线程中（通常是消息回调里）直接修改，不再构造任务
+    if (loop_->isInLoopThread()) {
+        stopReadInLoop();
+        return;
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
 }
 void TcpConnection::startRead() {
-    loop_->runInLoop([this]() {
-        if (!channel_.isReading()) {
-            channel_.enableRead();
-        }
-    });
+    if (loop_->isInLoopThread()) {
+        startReadInLoop();
+        return;
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
 }
 bool TcpConnection::isReading() {
+    if (ring_ != nullptr) {
+        return recvWanted_;
+    }
     return channel_.isReading();
 }
 
 const Buffer& TcpConnection::inputBuffer() const {
     return inputBuffer_;
 }
-const Buffer& TcpConnection::outputBuffer() const {
+const ChainBuffer& TcpConnection::outputBuffer() const {
     return outputBuffer_;
 }
 
@@ -195,8 +436,14 @@ void TcpConnection::handleRead() {
     if (state_.load(std::memory_order_acquire) == kDisconnected) {
         return;
     }
+    if (channel_.isEdgeTriggered()) {
+        handleReadEdgeTriggered();
+        return;
+    }
     int savedErrno;
-    ssize_t n = inputBuffer_.readFd(sockfd_, &savedErrno);
+    size_t readBytes = 0;
+    Buffer& buffer = readTarget();
+    ssize_t n = buffer.readFd(sockfd_, &savedErrno);
     if (n == -1) {
         errno = savedErrno;
         SYSERR("TcpConnection::read()");
@@ -206,40 +453,126 @@ void TcpConnection::handleRead() {
         handleClose();
     }
     else {
-        if (messageCallback_) {
-            messageCallback_(shared_from_this(), inputBuffer_);
+        if (idleWheel_ != nullptr) {
+            idleWheel_->touch(&idleEntry_);
+        }
+        readBytes = buffer.readableBytes();
+        dispatchMessage(buffer);
+    }
+    stashReadBuffer(buffer);
+    if (n > 0) {
+        shrinkInputIfSparse(readBytes);
+    }
+}
+void TcpConnection::handleReadEdgeTriggered() {
+    // 边缘触发：不读到 EAGAIN，剩余的数据不会再有通知
+    size_t total = 0;
+    bool eof = false;
+    int savedErrno = 0;
+    Buffer& buffer = readTarget();
+    while (total < readBudget_) {
+        // 每次只读预算剩下的部分，一次 readv 不会越过预算
+        ssize_t n = buffer.readFd(sockfd_, &savedErrno, readBudget_ - total);
+        if (n > 0) {
+            total += static_cast<size_t>(n);
+            continue;
+        }
+        if (n == 0) {
+            eof = true;
+        }
+        else if (savedErrno == EINTR) {
+            continue;
+        }
+        break;
+    }
+    const bool failed = !eof && total < readBudget_ && savedErrno != EAGAIN;
+
+    // 读到的数据一次交给上层，之后再处理关闭和出错
+    size_t readBytes = buffer.readableBytes();
+    if (total > 0) {
+        if (idleWheel_ != nullptr) {
+            idleWheel_->touch(&idleEntry_);
         }
+        dispatchMessage(buffer);
     }
+    stashReadBuffer(buffer);
+    if (total > 0) {
+        shrinkInputIfSparse(readBytes);
+    }
+    // 上层可能已经在回调中关闭了连接
+    if (state_.load(std::memory_order_acquire) == kDisconnected) {
+        return;
+    }
+    if (failed) {
+        errno = savedErrno;
+        SYSERR("TcpConnection::read()");
+        handleError();
+    }
+    else if (eof) {
+        handleClose();
+    }
+    else if (total >= readBudget_) {
+        // 超过本轮预算，剩余数据排到本轮其他事件之后再读
+        loop_->queueInLoop([self = shared_from_this()]() {
+            if (self->channel_.isReading()) {
+                self->handleRead();
+            }
+        });
+    }
+}
+Buffer& TcpConnection::readTarget() {
+    if (sharedReadBuffer_ && inputBuffer_.readableBytes() == 0) {
+        return loop_->readBuffer();
+    }
+    return inputBuffer_;
+}
+void TcpConnection::dispatchMessage(Buffer& buffer) {
+    if (!callbacks_->message) return;
+    inMessageCallback_ = true;
+    callbacks_->message(shared_from_this(), buffer);
+    inMessageCallback_ = false;
+}
+void TcpConnection::stashReadBuffer(Buffer& buffer) {
+    if (&buffer == &inputBuffer_) return;
+    if (buffer.readableBytes() > 0) {
+        inputBuffer_.append(buffer.peek(), buffer.readableBytes());
+    }
+    buffer.retrieveAll();
 }
 void TcpConnection::handleWrite() {
     loop_->assertInLoopThread();
     if (state_.load(std::memory_order_acquire) == kDisconnected) {
-        WARN("TcpConnection::handleWrite() disconnected, give up writing %zu bytes", outputBuffer_.readableBytes());
+        WARN("TcpConnection::handleWrite() disconnected, give up writing %zu bytes", pendingBytes());
         return;
     }
-    assert(outputBuffer_.readableBytes() > 0);
+    assert(pendingBytes() > 0);
     assert(channel_.isWriting());
-    ssize_t n = ::write(sockfd_, outputBuffer_.peek(), outputBuffer_.readableBytes());
-    if (n == -1) {
-        int savedErrno = errno;
+    // 对端在正常接收数据，同样算作活动
+    if (idleWheel_ != nullptr) {
+        idleWheel_->touch(&idleEntry_);
+    }
+    int savedErrno = 0;
+    if (!drainOutput(&savedErrno)) {
         if (savedErrno != EAGAIN) {
+            errno = savedErrno;
             SYSERR("TcpConnection::write()");
-            if (savedErrno == EPIPE || savedErrno == ECONNRESET) {
+            // 对端断开，或者文件区间发送失败导致输出流无法按序继续，只能关闭连接
+            if (savedErrno == EPIPE || savedErrno == ECONNRESET || !fileRegions_.empty()) {
                 handleError();
             }
         }
     }
     else {
-        outputBuffer_.retrieve(static_cast<size_t>(n));
-        if (outputBuffer_.readableBytes() == 0) {
+        if (pendingBytes() == 0) {
             channel_.disableWrite();
             if (state_.load(std::memory_order_acquire) == kDisconnecting)
                 shutdownInLoop();
-            if (writeCompleteCallback_) {
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            if (callbacks_->writeComplete) {
+                loop_->queueInLoop(std::bind(callbacks_->writeComplete, shared_from_this()));
             }
         }
     }
+    updateBufferBytes();
 }
 void TcpConnection::handleClose() {
     loop_->assertInLoopThread();
@@ -247,9 +580,23 @@ void TcpConnection::handleClose() {
     assert(currentState == kConnected || currentState == kDisconnecting);
     state_.store(kDisconnected, std::memory_order_release);
     loop_->removeChannel(&channel_);
-    if (closeCallback_) {
-        closeCallback_(shared_from_this());
+    // 请求的回调持有连接，取消后由结束的完成事件释放；send 请求结束前 outputBuffer_ 不能释放
+    if (recvId_ != 0) {
+        ring_->cancel(recvId_);
+    }
+    if (sendId_ != 0) {
+        ring_->cancel(sendId_);
+    }
+    clearFileRegions();
+    if (idleWheel_ != nullptr) {
+        idleWheel_->remove(&idleEntry_);
+        idleWheel_ = nullptr;
+    }
+    if (callbacks_->close) {
+        callbacks_->close(shared_from_this());
     }
+    // 连接已经关闭，缓冲区归还，不再计入 loop 的统计
+    updateBufferBytes();
 }
 void TcpConnection::handleError() {
     loop_->assertInLoopThread();
@@ -263,12 +610,159 @@ void TcpConnection::handleError() {
     handleClose();
 }
 
+void TcpConnection::startRecv() {
+    recvId_ = ring_->recvMultishot(sockfd_, [self = shared_from_this()](const char* data, int res, bool more) {
+        self->handleRecvComplete(data, res, more);
+    });
+}
+
+void TcpConnection::handleRecvComplete(const char* data, int res, bool more) {
+    loop_->assertInLoopThread();
+    if (!more) {
+        recvId_ = 0;
+    }
+    if (state_.load(std::memory_order_acquire) == kDisconnected) {
+        return;
+    }
+    if (res > 0) {
+        if (!recvWanted_) {
+            // stopRead 之前已经完成的 recv，数据留到 startRead 时再交给上层
+            inputBuffer_.append(data, static_cast<size_t>(res));
+            updateBufferBytes();
+            return;
+        }
+        if (idleWheel_ != nullptr) {
+            idleWheel_->touch(&idleEntry_);
+        }
+        Buffer& buffer = readTarget();
+        buffer.append(data, static_cast<size_t>(res));
+        size_t readBytes = buffer.readableBytes();
+        dispatchMessage(buffer);
+        stashReadBuffer(buffer);
+        shrinkInputIfSparse(readBytes);
+    }
+    else if (res == 0) {
+        handleClose();
+        return;
+    }
+    else if (res != -ENOBUFS && res != -ECANCELED) {
+        errno = -res;
+        SYSERR("TcpConnection::recv()");
+        handleError();
+        return;
+    }
+    // 接收缓冲区暂时用完或者被取消时请求已经结束，还需要读就重新提交
+    if (recvId_ == 0 && recvWanted_ && state_.load(std::memory_order_acquire) != kDisconnected) {
+        startRecv();
+    }
+}
+
+void TcpConnection::submitSend() {
+    assert(sendId_ == 0);
+    assert(fileRegions_.empty());
+    struct iovec iov[IoUringPoller::kMaxSendIov];
+    int iovcnt = outputBuffer_.readableIovec(iov, IoUringPoller::kMaxSendIov);
+    sendId_ = ring_->send(sockfd_, iov, iovcnt, [self = shared_from_this()](int res) {
+        self->handleSendComplete(res);
+    });
+}
+
+void TcpConnection::handleSendComplete(int res) {
+    loop_->assertInLoopThread();
+    sendId_ = 0;
+    if (state_.load(std::memory_order_acquire) == kDisconnected) {
+        updateBufferBytes();
+        return;
+    }
+    if (res < 0) {
+        errno = -res;
+        SYSERR("TcpConnection::send()");
+        handleError();
+        return;
+    }
+    size_t n = static_cast<size_t>(res);
+    outputBuffer_.retrieve(n);
+    // 请求提交时还没有文件区间，发出的都是排在第一个区间之前的数据
+    if (!fileRegions_.empty()) {
+        assert(n <= fileRegions_.front().bytesBefore);
+        fileRegions_.front().bytesBefore -= n;
+        regionedBytes_ -= n;
+    }
+    if (idleWheel_ != nullptr) {
+        idleWheel_->touch(&idleEntry_);
+    }
+    if (pendingBytes() == 0) {
+        if (state_.load(std::memory_order_acquire) == kDisconnecting) {
+            shutdownInLoop();
+        }
+        if (callbacks_->writeComplete) {
+            loop_->queueInLoop(std::bind(callbacks_->writeComplete, shared_from_this()));
+        }
+    }
+    else if (!fileRegions_.empty()) {
+        // 文件区间用 sendfile 发送，之后的数据也按可写事件继续发送
+        channel_.enableWrite();
+    }
+    else {
+        submitSend();
+    }
+    updateBufferBytes();
+}
+
+void TcpConnection::stopReadInLoop() {
+    if (ring_ == nullptr) {
+        if (channel_.isReading()) {
+            channel_.disableRead();
+        }
+        return;
+    }
+    if (!recvWanted_) return;
+    recvWanted_ = false;
+    if (recvId_ != 0) {
+        ring_->cancel(recvId_);
+    }
+}
+
+void TcpConnection::startReadInLoop() {
+    if (ring_ == nullptr) {
+        if (!channel_.isReading()) {
+            channel_.enableRead();
+        }
+        return;
+    }
+    if (recvWanted_ || state_.load(std::memory_order_acquire) == kDisconnected) return;
+    recvWanted_ = true;
+    // 被取消的请求还没有结束时，由它结束的完成事件重新提交
+    if (recvId_ == 0) {
+        startRecv();
+    }
+    // 暂停期间收到的数据，排在当前回调之后交给上层
+    if (inputBuffer_.readableBytes() > 0) {
+        loop_->queueInLoop([self = shared_from_this()]() {
+            if (self->recvWanted_ && !self->disconnected() && self->inputBuffer_.readableBytes() > 0) {
+                self->dispatchMessage(self->inputBuffer_);
+                self->updateBufferBytes();
+            }
+        });
+    }
+}
+
 void TcpConnection::sendInLoop(const char *data, size_t len) {
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = len;
+    sendInLoop(&iov, 1);
+}
+void TcpConnection::sendInLoop(const struct iovec* iov, int iovcnt) {
     loop_->assertInLoopThread();
     if (state_.load(std::memory_order_acquire) == kDisconnected) {
         WARN("TcpConnection::sendInLoop() disconnected, give up send");
         return;
     }
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        len += iov[i].iov_len;
+    }
     ssize_t n = 0;
     size_t remain = len;
     bool faultError = false;
@@ -276,9 +770,11 @@ void TcpConnection::sendInLoop(const char *data, size_t len) {
      * 如果已经在监听EPOLLOUT事件了，说明sockfd_内核缓冲区已经是已满状态，因此就不会尝试执行write
      * 的操作，而是直接执行下面的逻辑，将待发送数据追加到outputBuffer_ 
     **/
-    if (!channel_.isWriting()) {
-        assert(outputBuffer_.readableBytes() == 0);
-        n = ::write(sockfd_, data, len);
+    // 完成模式下数据先进 outputBuffer_，由 send 请求和本轮的其他请求一起提交
+    if (ring_ == nullptr && !channel_.isWriting()) {
+        assert(pendingBytes() == 0);
+        // 多个片段一次 writev 发出，超过 IOV_MAX 的部分留给 outputBuffer_
+        n = ::writev(sockfd_, iov, std::min(iovcnt, IOV_MAX));
         if (n == -1) {
             if (errno != EAGAIN) {
                 SYSERR("TcpConnection::write()");
@@ -292,9 +788,9 @@ void TcpConnection::sendInLoop(const char *data, size_t len) {
         }
         else {
             remain -= static_cast<size_t>(n);
-            if (remain == 0 && writeCompleteCallback_) {
+            if (remain == 0 && callbacks_->writeComplete) {
                 // 正常写完了，执行写完成回调
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                loop_->queueInLoop(std::bind(callbacks_->writeComplete, shared_from_this()));
             }
         }
     }
@@ -306,23 +802,181 @@ void TcpConnection::sendInLoop(const char *data, size_t len) {
     **/
     if (!faultError && remain > 0) {
         if (highWaterMarkCallback_) {
-            size_t oldLen = outputBuffer_.readableBytes();
+            size_t oldLen = pendingBytes();
             size_t newLen = oldLen + remain;
             if (oldLen < highWaterMark_ && newLen >= highWaterMark_)
                 loop_->queueInLoop(std::bind(
                         highWaterMarkCallback_, shared_from_this(), newLen));
         }
-        outputBuffer_.append(data + n, remain);
+        // 跳过已经写出的 n 字节，只追加剩余部分
+        size_t skip = static_cast<size_t>(n);
+        for (int i = 0; i < iovcnt; ++i) {
+            if (skip >= iov[i].iov_len) {
+                skip -= iov[i].iov_len;
+                continue;
+            }
+            outputBuffer_.append(static_cast<const char*>(iov[i].iov_base) + skip, iov[i].iov_len - skip);
+            skip = 0;
+        }
+        updateBufferBytes();
+        if (ring_ != nullptr) {
+            // 已有 send 请求或者正在等可写发送文件区间时，由它们接着发送
+            if (sendId_ == 0 && !channel_.isWriting()) {
+                submitSend();
+            }
+            return;
+        }
         channel_.enableWrite();
+        // 边缘触发时超过 IOV_MAX 的部分还没有尝试写，内核缓冲区未必已满，不会有可写通知
+        if (channel_.isEdgeTriggered() && iovcnt > IOV_MAX && n > 0) {
+            handleWrite();
+        }
     }
 }
 void TcpConnection::sendInLoop(const std::string& message) {
     sendInLoop(message.data(), message.length());
 }
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len) {
+    loop_->assertInLoopThread();
+    if (state_.load(std::memory_order_acquire) == kDisconnected) {
+        WARN("TcpConnection::sendFileInLoop() disconnected, give up send");
+        ::close(fd);
+        return;
+    }
+    if (len == 0) {
+        ::close(fd);
+        return;
+    }
+    // 文件区间排在 outputBuffer_ 中已有数据之后，之后 send 的数据又排在它之后
+    size_t oldLen = pendingBytes();
+    fileRegions_.push_back(FileRegion{fd, offset, len, outputBuffer_.readableBytes() - regionedBytes_});
+    regionedBytes_ = outputBuffer_.readableBytes();
+    fileBytes_ += len;
+
+    // send 请求完成后会转为等待可写来发送文件区间
+    if (!channel_.isWriting() && sendId_ == 0) {
+        // 前面没有排队的数据，直接尝试 sendfile
+        int savedErrno = 0;
+        if (!drainOutput(&savedErrno) && savedErrno != EAGAIN) {
+            errno = savedErrno;
+            SYSERR("TcpConnection::sendfile()");
+            handleError();
+            return;
+        }
+        if (pendingBytes() == 0) {
+            if (callbacks_->writeComplete) {
+                loop_->queueInLoop(std::bind(callbacks_->writeComplete, shared_from_this()));
+            }
+            return;
+        }
+        channel_.enableWrite();
+    }
+    if (highWaterMarkCallback_) {
+        size_t newLen = pendingBytes();
+        if (oldLen < highWaterMark_ && newLen >= highWaterMark_)
+            loop_->queueInLoop(std::bind(
+                    highWaterMarkCallback_, shared_from_this(), newLen));
+    }
+}
+
+bool TcpConnection::drainOutput(int* savedErrno) {
+    if (!channel_.isEdgeTriggered()) {
+        return drainOutputOnce(savedErrno);
+    }
+    // 一次最多写出 1MB 或一个文件区间的一部分，没有遇到 EAGAIN 就继续写，否则不会再有可写通知
+    while (pendingBytes() > 0) {
+        if (!drainOutputOnce(savedErrno)) return false;
+    }
+    return true;
+}
+
+bool TcpConnection::drainOutputOnce(int* savedErrno) {
+    while (!fileRegions_.empty()) {
+        FileRegion& region = fileRegions_.front();
+        // 先发出排在该文件区间之前的普通数据
+        if (region.bytesBefore > 0) {
+            ssize_t n = outputBuffer_.writeFd(sockfd_, savedErrno, region.bytesBefore);
+            if (n == -1) return false;
+            region.bytesBefore -= static_cast<size_t>(n);
+            regionedBytes_ -= static_cast<size_t>(n);
+            if (region.bytesBefore > 0) return true; // 内核缓冲区已满，等下一次可写事件
+        }
+        ssize_t n = ::sendfile(sockfd_, region.fd, &region.offset, region.remain);
+        if (n == -1) {
+            *savedErrno = errno;
+            return false;
+        }
+        if (n == 0) {
+            // 文件比请求的区间短，之后排队的数据无法再按原来的偏移发出，只能关闭连接
+            ERROR("TcpConnection::sendfile() unexpected EOF, %zu bytes unsent", region.remain);
+            *savedErrno = EIO;
+            return false;
+        }
+        region.remain -= static_cast<size_t>(n);
+        fileBytes_ -= static_cast<size_t>(n);
+        if (region.remain > 0) return true;
+        ::close(region.fd);
+        fileRegions_.pop_front();
+    }
+    regionedBytes_ = 0;
+    // outputBuffer_ 由多个块组成，writeFd 通过一次 writev 把所有块一起写出
+    if (outputBuffer_.readableBytes() > 0) {
+        if (outputBuffer_.writeFd(sockfd_, savedErrno) == -1) return false;
+    }
+    return true;
+}
+
+size_t TcpConnection::pendingBytes() const {
+    return outputBuffer_.readableBytes() + fileBytes_;
+}
+
+void TcpConnection::clearFileRegions() {
+    for (auto& region : fileRegions_) {
+        ::close(region.fd);
+    }
+    fileRegions_.clear();
+    fileBytes_ = 0;
+    regionedBytes_ = 0;
+}
+
+void TcpConnection::shrinkInputIfSparse(size_t readBytes) {
+    const size_t capacity = inputBuffer_.capacity();
+    if (capacity > Buffer::kCheapPrepend + Buffer::kInitialSize && inputBuffer_.readableBytes() * 4 <= capacity &&
+        readBytes * 4 <= capacity) {
+        if (++sparseReads_ >= kShrinkAfterSparseReads) {
+            inputBuffer_.shrink(0);
+            sparseReads_ = 0;
+        }
+    }
+    else {
+        sparseReads_ = 0;
+    }
+    updateBufferBytes();
+}
+
+void TcpConnection::updateBufferBytes() {
+    // 关闭之后剩下的数据不会再被处理或发出
+    if (state_.load(std::memory_order_acquire) == kDisconnected) {
+        // 在 MessageCallback 中关闭时上层还在使用 inputBuffer_，由读路径在回调返回后再来释放
+        if (!inMessageCallback_) {
+            inputBuffer_.retrieveAll();
+            inputBuffer_.shrink(0);
+        }
+        // 内核可能还在读 send 请求引用的数据，等请求结束再释放
+        if (sendId_ == 0) {
+            outputBuffer_.retrieveAll();
+        }
+    }
+    size_t bytes = inputBuffer_.capacity() + outputBuffer_.capacity();
+    if (bytes != bufferBytes_) {
+        loop_->updateConnectionBufferBytes(bufferBytes_, bytes);
+        bufferBytes_ = bytes;
+    }
+}
 
 void TcpConnection::shutdownInLoop() {
     loop_->assertInLoopThread();
-    if (state_.load(std::memory_order_acquire) != kDisconnected && !channel_.isWriting()) {
+    if (state_.load(std::memory_order_acquire) != kDisconnected && !channel_.isWriting() && sendId_ == 0) {
         if (::shutdown(sockfd_, SHUT_WR) == -1) {
             SYSERR("TcpConnection::shutdown()");
         }
@@ -1,14 +1,31 @@
 #include "knetlib/TcpServer.h"
+#include "knetlib/Acceptor.h"
 #include "knetlib/EventLoop.h"
 #include "knetlib/EventLoopThreadPool.h"
 #include "knetlib/TcpConnection.h"
+#include "knetlib/IdleTimeoutWheel.h"
 #include "knetlib/Logger.h"
+#include <algorithm>
 #include <cassert>
+#include <future>
+#include <sys/socket.h>
+#include <unistd.h>
 
 TcpServer::TcpServer(EventLoop* loop, const InetAddress& local)
         : baseLoop_(loop),
           started_(false),
-          local_(local)
+          local_(local),
+          idleTimeout_(Nanoseconds::zero()),
+          reusePort_(false),
+          reusePortCpuAffinity_(false),
+          acceptBatch_(1),
+          socketBusyPollUs_(0),
+          readBudget_(0),
+          sharedReadBuffer_(false),
+          maxConnections_(0),
+          numConnections_(0),
+          rejectedConnections_(0),
+          stopping_(false)
 {
     assert(baseLoop_ != nullptr);
     INFO("create TcpServer %s", local.toIpPort().c_str());
@@ -18,18 +35,27 @@ TcpServer::TcpServer(EventLoop* loop, const InetAddress& local)
 }
 
 TcpServer::~TcpServer() {
+    // 下面要等待每个 loop 执行完清理任务，在其他线程析构时 baseLoop_ 可能不在运行，会永远等下去
+    baseLoop_->assertInLoopThread();
+    stopping_ = true;
     // 停止 acceptor
-    if (acceptor_ && baseLoop_) {
-        if (baseLoop_->isInLoopThread()) {
-            acceptor_->stop();
-        } else {
-            baseLoop_->runInLoop([this]() {
-                if (acceptor_) {
-                    acceptor_->stop();
-                }
-            });
-        }
+    if (acceptor_) {
+        acceptor_->stop();
     }
+
+    // 在各自的 loop 线程中关闭剩余的连接，等待完成后才能释放 context 和停止线程池。
+    // context 的状态只能在其 loop 线程中读取，所以每个 context 都要处理；start() 中创建时间轮的
+    // 任务先于这里的任务进入同一个队列，执行 teardownContext 时一定已经完成
+    for (auto& context : contexts_) {
+        std::promise<void> done;
+        LoopContext* ctx = context.get();
+        ctx->loop->runInLoop([ctx, &done]() {
+            teardownContext(ctx);
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+    contexts_.clear();
     
     TRACE("~TcpServer");
 }
@@ -43,22 +69,130 @@ void TcpServer::setNumThread(size_t n) {
     }
 }
 
+void TcpServer::setThreadName(const std::string& prefix) {
+    assert(!started_);
+    threadPool_->setThreadName(prefix);
+}
+
+void TcpServer::setCpuAffinity(const std::vector<int>& cpus) {
+    assert(!started_);
+    threadPool_->setCpuAffinity(cpus);
+}
+
+void TcpServer::setNumaLocal(bool on) {
+    assert(!started_);
+    threadPool_->setNumaLocal(on);
+}
+
+void TcpServer::setBusyPoll(Nanoseconds budget, int socketBusyPollUs) {
+    assert(!started_);
+    threadPool_->setBusyPoll(budget);
+    socketBusyPollUs_ = socketBusyPollUs;
+}
+
+void TcpServer::setIterationBudget(size_t maxEvents, size_t maxTasks) {
+    assert(!started_);
+    threadPool_->setIterationBudget(maxEvents, maxTasks);
+}
+
+void TcpServer::setPollerBackend(PollerBackend backend) {
+    assert(!started_);
+    threadPool_->setPollerBackend(backend);
+}
+
+void TcpServer::setSharedReadBuffer(bool on) {
+    assert(!started_);
+    sharedReadBuffer_ = on;
+}
+
+void TcpServer::setEdgeTriggered(bool on, size_t readBudget) {
+    assert(!started_);
+    if (!on) {
+        readBudget_ = 0;
+    } else {
+        readBudget_ = readBudget > 0 ? readBudget : TcpConnection::kDefaultReadBudget;
+    }
+}
+
+void TcpServer::setIdleTimeout(Nanoseconds timeout) {
+    assert(!started_);
+    if (timeout > Nanoseconds::zero()) {
+        idleTimeout_ = timeout;
+    } else {
+        ERROR("TcpServer::setIdleTimeout timeout <= 0");
+    }
+}
+
+void TcpServer::setReusePort(bool on, bool cpuAffinity) {
+    assert(!started_);
+    reusePort_ = on;
+    reusePortCpuAffinity_ = on && cpuAffinity;
+}
+
+void TcpServer::setAcceptBatch(int n) {
+    assert(!started_);
+    if (n > 0) {
+        acceptBatch_ = n;
+    } else {
+        ERROR("TcpServer::setAcceptBatch n <= 0");
+    }
+}
+
+void TcpServer::setLoadBalance(LoadBalance strategy) {
+    assert(!started_);
+    threadPool_->setLoadBalance(strategy);
+}
+
+void TcpServer::setMaxConnections(size_t n) {
+    assert(!started_);
+    maxConnections_ = n;
+}
+
 void TcpServer::start() {
     if (started_.exchange(true)) return;
 
     baseLoop_->runInLoop([this](){startInLoop();});
 }
 
+size_t TcpServer::numConnections() const {
+    return numConnections_.load(std::memory_order_relaxed);
+}
+
+size_t TcpServer::connectionBufferBytes() const {
+    size_t bytes = 0;
+    for (auto& context : contexts_) {
+        bytes += context->loop->connectionBufferBytes();
+    }
+    return bytes;
+}
+
+uint64_t TcpServer::rejectedConnections() const {
+    uint64_t rejected = rejectedConnections_.load(std::memory_order_relaxed);
+    if (acceptor_) {
+        rejected += acceptor_->rejectedAccepts();
+    }
+    for (auto& context : contexts_) {
+        if (context->acceptor) {
+            rejected += context->acceptor->rejectedAccepts();
+        }
+    }
+    return rejected;
+}
+
 void TcpServer::setThreadInitCallback(const ThreadInitCallback& callback) {
+    assert(!started_);
     threadInitCallback_ = callback;
 }
 void TcpServer::setConnectionCallback(const ConnectionCallback& callback) {
+    assert(!started_);
     connectionCallback_ = callback;
 }
 void TcpServer::setMessageCallback(const MessageCallback& callback) {
+    assert(!started_);
     messageCallback_ = callback;
 }
 void TcpServer::setWriteCompleteCallback(const WriteCompleteCallback& callback) {
+    assert(!started_);
     writeCompleteCallback_ = callback;
 }
 
@@ -68,6 +202,28 @@ void TcpServer::startInLoop() {
     
     // 启动线程池
     threadPool_->start();
+
+    // 每个 loop 一个 context，时间轮在所属 loop 线程中创建，先于该 loop 上的任何连接
+    for (EventLoop* loop : threadPool_->getAllLoops()) {
+        auto context = std::make_unique<LoopContext>();
+        context->loop = loop;
+        context->index = contexts_.size();
+        auto callbacks = std::make_shared<TcpConnectionCallbacks>();
+        callbacks->message = messageCallback_;
+        callbacks->writeComplete = writeCompleteCallback_;
+        LoopContext* ctx = context.get();
+        callbacks->close = [this, ctx](const TcpConnectionPtr& conn) {
+            closeConnection(ctx, conn);
+        };
+        context->callbacks = std::move(callbacks);
+        if (idleTimeout_ > Nanoseconds::zero()) {
+            Nanoseconds timeout = idleTimeout_;
+            loop->runInLoop([ctx, timeout]() {
+                ctx->idleWheel = std::make_unique<IdleTimeoutWheel>(ctx->loop, timeout);
+            });
+        }
+        contexts_.push_back(std::move(context));
+    }
     
     // 调用线程初始化回调
     if (threadInitCallback_) {
@@ -83,16 +239,30 @@ void TcpServer::startInLoop() {
         }
     }
     
-    // 创建 Acceptor（只在主线程中）
-    acceptor_ = std::make_unique<TcpServerSingle>(baseLoop_, local_);
-    
-    // 设置新连接回调（在主线程中 accept，然后分配给子线程）
-    acceptor_->setNewConnectionCallback([this](int sockfd, const InetAddress& local, const InetAddress& peer) {
-        newConnection(sockfd, local, peer);
-    });
-    
-    // 启动监听
-    acceptor_->start();
+    if (reusePort_) {
+        startReusePortAcceptors();
+    }
+    else {
+        // 创建 Acceptor（只在主线程中）
+        acceptor_ = std::make_unique<TcpServerSingle>(baseLoop_, local_);
+
+        // 设置新连接回调（在主线程中 accept，然后分配给子线程）
+        acceptor_->setMaxAcceptsPerRead(acceptBatch_);
+        if (acceptBatch_ > 1) {
+            acceptor_->setNewConnectionBatchCallback(
+                    [this](const InetAddress& local, std::vector<AcceptedSocket>& sockets) {
+                newConnectionBatch(local, sockets);
+            });
+        }
+        else {
+            acceptor_->setNewConnectionCallback([this](int sockfd, const InetAddress& local, const InetAddress& peer) {
+                newConnection(sockfd, local, peer);
+            });
+        }
+
+        // 启动监听
+        acceptor_->start();
+    }
     
     INFO("TcpServer::start() %s with %zu eventLoop thread(s)", 
          local_.toIpPort().c_str(), 
@@ -104,36 +274,177 @@ void TcpServer::newConnection(int sockfd, const InetAddress& local, const InetAd
     assert(baseLoop_->isInLoopThread());
     
     // 获取下一个 EventLoop（轮询分配）
-    EventLoop* ioLoop = threadPool_->getNextLoop();
+    if (!admitConnection(sockfd)) return;
+    LoopContext* context = selectContext(peer);
     
     // 在 ioLoop 的线程中创建连接
-    ioLoop->runInLoop([this, sockfd, local, peer, ioLoop]() {
-        // 创建连接
-        auto conn = std::make_shared<TcpConnection>(ioLoop, sockfd, local, peer);
-        
-        // 设置回调
-        conn->setMessageCallback(messageCallback_);
-        conn->setWriteCompleteCallback(writeCompleteCallback_);
-        conn->setCloseCallback([this](const TcpConnectionPtr& conn) {
-            closeConnection(conn);
+    context->loop->runInLoop([this, sockfd, local, peer, context]() {
+        establishConnection(context, sockfd, local, peer);
+    });
+}
+
+// 在主线程中调用，一批连接按目标 loop 分组，每个 loop 投递一个任务
+void TcpServer::newConnectionBatch(const InetAddress& local, std::vector<AcceptedSocket>& sockets) {
+    assert(baseLoop_->isInLoopThread());
+
+    std::vector<std::vector<AcceptedSocket>> batches(contexts_.size());
+    for (AcceptedSocket& socket : sockets) {
+        if (!admitConnection(socket.sockfd)) continue;
+        LoopContext* context = selectContext(socket.peer);
+        batches[context->index].push_back(std::move(socket));
+    }
+    for (size_t i = 0; i < batches.size(); ++i) {
+        if (batches[i].empty()) continue;
+        LoopContext* context = contexts_[i].get();
+        context->loop->runInLoop([this, context, local, batch = std::move(batches[i])]() {
+            for (const AcceptedSocket& socket : batch) {
+                establishConnection(context, socket.sockfd, local, socket.peer);
+            }
+        });
+    }
+}
+
+bool TcpServer::admitConnection(int sockfd) {
+    const size_t count = numConnections_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (maxConnections_ == 0) return true;
+    if (count > maxConnections_) {
+        // 批量 accept 或多个 SO_REUSEPORT acceptor 同时 accept 时可能超出上限
+        numConnections_.fetch_sub(1, std::memory_order_acq_rel);
+        rejectedConnections_.fetch_add(1, std::memory_order_relaxed);
+        ::close(sockfd);
+        WARN("TcpServer::admitConnection reach max connections %zu, reject", maxConnections_);
+        updateAccepting();
+        return false;
+    }
+    if (count == maxConnections_) {
+        updateAccepting();
+    }
+    return true;
+}
+
+void TcpServer::updateAccepting() {
+    // 每次都在 acceptor 的线程中按最新的连接数重新判断，暂停和恢复的任务乱序到达也没有关系
+    auto update = [this](auto* acceptor) {
+        if (numConnections_.load(std::memory_order_acquire) < maxConnections_) {
+            acceptor->resumeAccepting();
+        } else {
+            acceptor->pauseAccepting();
+        }
+    };
+    if (acceptor_) {
+        baseLoop_->runInLoop([this, update]() {
+            if (acceptor_) update(acceptor_.get());
         });
-        
-        // 建立连接
-        conn->connectEstablished();
-        
-        // 调用连接回调
-        if (connectionCallback_) {
-            connectionCallback_(conn);
+    }
+    for (auto& context : contexts_) {
+        if (!context->acceptor) continue;
+        LoopContext* ctx = context.get();
+        ctx->loop->runInLoop([ctx, update]() {
+            if (ctx->acceptor) update(ctx->acceptor.get());
+        });
+    }
+}
+
+TcpServer::LoopContext* TcpServer::selectContext(const InetAddress& peer) {
+    EventLoop* loop = threadPool_->getNextLoop(peer);
+    // 选中时立即计入，同一批中后面的连接能看到这次分配
+    threadPool_->connectionOpened(loop);
+    return contextOf(loop);
+}
+
+TcpServer::LoopContext* TcpServer::contextOf(EventLoop* loop) {
+    auto it = std::find_if(contexts_.begin(), contexts_.end(),
+                           [loop](const auto& context) { return context->loop == loop; });
+    assert(it != contexts_.end());
+    return it->get();
+}
+
+// SO_REUSEPORT 模式：每个 IO loop 一个监听 socket，在本线程 accept 并直接创建连接。
+// 有工作线程时主线程不处理 IO，与 getNextLoop() 的分配范围一致
+void TcpServer::startReusePortAcceptors() {
+    assert(baseLoop_->isInLoopThread());
+    const size_t first = contexts_.size() > 1 ? 1 : 0;
+    const int groupSize = static_cast<int>(contexts_.size() - first);
+    // 监听 socket 都在这里创建并绑定，端口为 0 时后面的 socket 沿用第一个实际分配到的端口
+    InetAddress local = local_;
+    for (size_t i = first; i < contexts_.size(); ++i) {
+        LoopContext* context = contexts_[i].get();
+        auto acceptor = std::make_unique<Acceptor>(context->loop, local, true);
+        if (i == first) {
+            local = acceptor->local();
+            if (reusePortCpuAffinity_) {
+                acceptor->attachReusePortCpuSteering(groupSize);
+            }
         }
-    });
+        acceptor->setMaxAcceptsPerRead(acceptBatch_);
+        acceptor->setNewConnectionCallback(
+                [this, context](int sockfd, const InetAddress& local, const InetAddress& peer) {
+            if (admitConnection(sockfd)) {
+                threadPool_->connectionOpened(context->loop);
+                establishConnection(context, sockfd, local, peer);
+            }
+        });
+        Acceptor* raw = acceptor.get();
+        context->acceptor = std::move(acceptor);
+        context->loop->runInLoop([raw]() { raw->listen(); });
+    }
+}
+
+// 在 context 所属的线程中调用
+void TcpServer::establishConnection(LoopContext* context, int sockfd,
+                                    const InetAddress& local, const InetAddress& peer) {
+    context->loop->assertInLoopThread();
+    if (socketBusyPollUs_ > 0 &&
+        ::setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &socketBusyPollUs_, sizeof(socketBusyPollUs_)) == -1) {
+        SYSERR("TcpServer setsockopt SO_BUSY_POLL");
+    }
+    // 创建连接，由所属 loop 的 context 持有直到关闭
+    auto conn = TcpConnection::create(context->loop, sockfd, local, peer);
+    context->connections.insert(conn);
+    conn->setCallbacks(context->callbacks);
+
+    // 建立连接
+    if (readBudget_ > 0) {
+        conn->setEdgeTriggered(readBudget_);
+    }
+    conn->setSharedReadBuffer(sharedReadBuffer_);
+    conn->connectEstablished();
+    if (context->idleWheel) {
+        conn->setIdleTimeoutWheel(context->idleWheel.get());
+    }
+
+    // 调用连接回调
+    if (connectionCallback_) {
+        connectionCallback_(conn);
+    }
 }
 
 // 在连接所属的线程中调用
-void TcpServer::closeConnection(const TcpConnectionPtr& conn) {
+void TcpServer::closeConnection(LoopContext* context, const TcpConnectionPtr& conn) {
+    context->loop->assertInLoopThread();
     // 调用连接回调（通知连接关闭）
     if (connectionCallback_) {
         connectionCallback_(conn);
     }
-    // 注意：连接的清理由 TcpConnection 自己负责
+    // conn 由调用方持有，从集合中删除后在 handleClose 返回时析构
+    context->connections.erase(conn);
+    threadPool_->connectionClosed(context->loop);
+    const size_t count = numConnections_.fetch_sub(1, std::memory_order_acq_rel);
+    if (maxConnections_ != 0 && count == maxConnections_ && !stopping_) {
+        updateAccepting();
+    }
+}
+
+void TcpServer::teardownContext(LoopContext* context) {
+    context->loop->assertInLoopThread();
+    // 先停止本 loop 的监听，不再有新连接
+    context->acceptor.reset();
+    // forceClose 会回调 closeConnection 从集合中删除，所以遍历副本
+    auto connections = context->connections;
+    for (auto& conn : connections) {
+        conn->forceClose();
+    }
+    context->connections.clear();
+    context->idleWheel.reset();
 }
 
@@ -49,14 +49,33 @@ void TcpServerSingle::setConnectionCallback(const ConnectionCallback& callback)
 }
 void TcpServerSingle::setMessageCallback(const MessageCallback& callback) {
     messageCallback_ = callback;
+    callbacks_.reset();
 }
 void TcpServerSingle::setWriteCompleteCallback(const WriteCompleteCallback& callback) {
     writeCompleteCallback_ = callback;
+    callbacks_.reset();
 }
 void TcpServerSingle::setNewConnectionCallback(const NewConnectionCallback& callback) {
     acceptor_.setNewConnectionCallback(callback);
 }
 
+void TcpServerSingle::setNewConnectionBatchCallback(const NewConnectionBatchCallback& callback) {
+    acceptor_.setNewConnectionBatchCallback(callback);
+}
+void TcpServerSingle::setMaxAcceptsPerRead(int n) {
+    acceptor_.setMaxAcceptsPerRead(n);
+}
+
+void TcpServerSingle::pauseAccepting() {
+    acceptor_.pauseAccepting();
+}
+void TcpServerSingle::resumeAccepting() {
+    acceptor_.resumeAccepting();
+}
+uint64_t TcpServerSingle::rejectedAccepts() const {
+    return acceptor_.rejectedAccepts();
+}
+
 void TcpServerSingle::start() {
     acceptor_.listen();
 }
@@ -79,11 +98,16 @@ void TcpServerSingle::stop() {
 // 这里的逻辑将会传递给acceptor_.setNewConnectionCallback，当acceptfd_有可读事件触发，即有新连接请求到来时，就执行该逻辑
 void TcpServerSingle::newConnection(int connfd, const InetAddress& local, const InetAddress& peer) {
     loop_->assertInLoopThread();
-    auto conn = std::make_shared<TcpConnection>(loop_, connfd, local, peer);
+    if (!callbacks_) {
+        auto callbacks = std::make_shared<TcpConnectionCallbacks>();
+        callbacks->message = messageCallback_;
+        callbacks->writeComplete = writeCompleteCallback_;
+        callbacks->close = [this](const TcpConnectionPtr& conn) { closeConnection(conn); };
+        callbacks_ = std::move(callbacks);
+    }
+    auto conn = TcpConnection::create(loop_, connfd, local, peer);
     connections_.insert(conn);
-    conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(std::bind(&TcpServerSingle::closeConnection, this, std::placeholders::_1));
+    conn->setCallbacks(callbacks_);
     
     // 将connfd的channel tie上TcpConnection对象
     conn->connectEstablished();
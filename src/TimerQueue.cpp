@@ -1,4 +1,5 @@
 #include <sys/timerfd.h>
+#include <cassert>
 #include <chrono>
 #include <cstring>
 #include <unistd.h>
@@ -68,53 +69,62 @@ void timerfdSet(int fd, Timestamp when) {
 TimerQueue::TimerQueue(EventLoop* loop)
         : loop_(loop),
           timerfd_(timerfdCreate()),
-          timerChannel_(loop, timerfd_)
+          timerChannel_(loop, timerfd_),
+          wheel_(time_utils::now()),
+          armedDeadline_(Timestamp::max()),
+          numChunks_(0),
+          freeHead_(kNoFreeSlot)
 {
     loop_->assertInLoopThread();
+    for (auto& chunk : chunks_) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
     timerChannel_.setReadCallback([this](){this->handleRead();}); // 定时器触发时，timerFd_会有可读事件，交由handleRead来处理
     timerChannel_.enableRead();
 }
 
 TimerQueue::~TimerQueue() {
-    for (auto& p : timers_) {
-        delete p.second;
+    // 槽位里的定时器随块一起释放，这里只需要把它们从时间轮中摘掉
+    std::vector<Timer*> timers;
+    wheel_.removeAll(timers);
+    for (uint32_t i = 0; i < numChunks_; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
     }
     if (timerfd_ != -1) {
         close(timerfd_);
     }
 }
 
-Timer* TimerQueue::addTimer(TimerCallback callback, Timestamp when, Nanoseconds interval) {
-    Timer* timer = new Timer(std::move(callback), when, interval);
+TimerId TimerQueue::addTimer(Task callback, Timestamp when, Nanoseconds interval) {
+    uint32_t generation;
+    Slot* slot = allocSlot(&generation);
+    slot->reset(std::move(callback), when, interval);
     loop_->runInLoop(
-        [this, when, timer]() {
-            auto checkPair = timers_.insert({when, timer});
-            assert(checkPair.second);
-            // 新插入的就是时间最邻近的，那么就设置定时器触发时刻为最近的时间点
-            if (timers_.begin() == checkPair.first) {
-                timerfdSet(timerfd_, when);
+        [this, slot]() {
+            // 在其他线程添加时，cancelTimer 可能先于这里执行
+            if (slot->canceled()) {
+                freeSlot(slot);
+                return;
             }
+            wheel_.add(slot);
+            resetTimerfd();
         }
     );
-    return timer;
+    return TimerId(slot->index, generation);
 }
 
-void TimerQueue::cancelTimer(Timer* timer) {
+void TimerQueue::cancelTimer(TimerId timerId) {
     loop_->runInLoop(
-        [this, timer]() {
-            timer->cancel();
-            // 查找并删除包含此 timer 的 Entry
-            // 由于 timer 可能已经重启（when() 改变），需要遍历查找
-            for (auto it = timers_.begin(); it != timers_.end(); ++it) {
-                if (it->second == timer) {
-                    timers_.erase(it);
-                    delete timer;
-                    return;
-                }
+        [this, timerId]() {
+            Slot* slot = findSlot(timerId);
+            if (slot == nullptr || slot->canceled()) return;
+            slot->cancel();
+            // 时间轮中的定时器直接 O(1) 摘除；不在时间轮中说明它正在 handleRead 中等待执行，
+            // 或者还没来得及加入时间轮，已经标记为取消，由对应的地方释放
+            if (wheel_.contains(slot)) {
+                wheel_.remove(slot);
+                freeSlot(slot);
             }
-            // 如果没找到，说明定时器可能已经被处理或删除
-            // 但 timer 已经被标记为取消，所以是安全的
-            delete timer;
         }
     );
 }
@@ -122,10 +132,12 @@ void TimerQueue::cancelTimer(Timer* timer) {
 void TimerQueue::handleRead() {
     loop_->assertInLoopThread();
     timerfdRead(timerfd_); // 将可读的内容读取一下从而清空缓冲区
+    armedDeadline_ = Timestamp::max();
 
     Timestamp now(time_utils::now());
-    for (auto& e : getExpired(now)) {
-        Timer* timer = e.second;
+    expired_.clear();
+    wheel_.advance(now, expired_);
+    for (Timer* timer : expired_) {
         assert(timer->expired(now)); // now >= when
 
         if (!timer->canceled()) {
@@ -133,26 +145,62 @@ void TimerQueue::handleRead() {
         }
         if (!timer->canceled() && timer->repeat()) {
             timer->restart();
-            e.first = timer->when(); // 如果需要重复，那就按interval设置新的时间戳，并加入定时器管理集合
-            timers_.insert(e);
+            wheel_.add(timer); // 如果需要重复，那就按interval设置新的时间戳，重新放入时间轮
         }
-        else delete timer; //否则说明已经被取消了，直接丢弃
+        else freeSlot(static_cast<Slot*>(timer)); //否则说明已经被取消了，直接丢弃
     }
+    expired_.clear();
+
+    resetTimerfd(); // 向内核中注册的定时器其实只有一个，定时器队列由网络库维护
+}
 
-    if (!timers_.empty()) {
-        timerfdSet(timerfd_, timers_.begin()->first); // 如果还有未到时间的定时器，那就把最近的时间点作为触发时间点（向内核中注册的定时器其实只有一个，定时器队列由网络库维护）
+void TimerQueue::resetTimerfd() {
+    Timestamp deadline;
+    if (wheel_.nextDeadline(&deadline) && deadline < armedDeadline_) {
+        timerfdSet(timerfd_, deadline);
+        armedDeadline_ = deadline;
     }
 }
 
-// 将已过期的定时器从set中移除，并返回已过期的Entry数组
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
-    using namespace std::chrono;
-    Entry endEntry(now + 1ns, nullptr);
-    std::vector<Entry> ret;
+TimerQueue::Slot* TimerQueue::allocSlot(uint32_t* generation) {
+    std::lock_guard<std::mutex> guard(slotMutex_);
+    if (freeHead_ == kNoFreeSlot) {
+        if (numChunks_ == kMaxChunks) {
+            FATAL("TimerQueue::allocSlot() too many timers");
+        }
+        Slot* chunk = new Slot[kChunkSize];
+        const uint32_t first = numChunks_ * kChunkSize;
+        // 新块的槽位串成空闲链表
+        for (uint32_t i = 0; i < kChunkSize; ++i) {
+            chunk[i].index = first + i;
+            chunk[i].nextFree = i + 1 < kChunkSize ? first + i + 1 : kNoFreeSlot;
+        }
+        chunks_[numChunks_].store(chunk, std::memory_order_release);
+        ++numChunks_;
+        freeHead_ = first;
+    }
+    Slot* slot = chunks_[freeHead_ / kChunkSize].load(std::memory_order_relaxed) + freeHead_ % kChunkSize;
+    freeHead_ = slot->nextFree;
+    *generation = slot->generation;
+    return slot;
+}
 
-    auto end = timers_.lower_bound(endEntry);
-    ret.assign(timers_.begin(), end);
-    timers_.erase(timers_.begin(), end);
-    return ret;
+void TimerQueue::freeSlot(Slot* slot) {
+    loop_->assertInLoopThread();
+    slot->reset(nullptr, Timestamp(), Nanoseconds::zero()); // 释放回调捕获的资源
+    std::lock_guard<std::mutex> guard(slotMutex_);
+    ++slot->generation;
+    slot->nextFree = freeHead_;
+    freeHead_ = slot->index;
 }
 
+TimerQueue::Slot* TimerQueue::findSlot(TimerId timerId) const {
+    if (!timerId.valid()) return nullptr;
+    const uint32_t chunkIndex = timerId.index_ / kChunkSize;
+    if (chunkIndex >= kMaxChunks) return nullptr;
+    Slot* chunk = chunks_[chunkIndex].load(std::memory_order_acquire);
+    if (chunk == nullptr) return nullptr;
+    Slot* slot = chunk + timerId.index_ % kChunkSize;
+    // 代数只在 loop 线程中修改，这里读取不需要加锁
+    return slot->generation == timerId.generation_ ? slot : nullptr;
+}
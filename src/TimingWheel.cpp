@@ -0,0 +1,220 @@
+#include "knetlib/TimingWheel.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+TimingWheel::TimingWheel(Timestamp now)
+        : currentTick_(tickOf(now)),
+          size_(0)
+{
+    std::fill(std::begin(slots_), std::end(slots_), nullptr);
+    std::memset(occupied_, 0, sizeof(occupied_));
+}
+
+void TimingWheel::add(Timer* timer) {
+    assert(!contains(timer));
+    // 时间轮中没有定时器时，currentTick_ 可能已经落后很久，直接拨到当前时刻，
+    // 避免之后的 advance 空转补齐这段时间
+    if (size_ == ordered_.size()) {
+        currentTick_ = std::max(currentTick_, tickOf(time_utils::now()));
+    }
+    place(timer);
+    ++size_;
+}
+
+void TimingWheel::remove(Timer* timer) {
+    if (timer->slot_ == Timer::kOrdered) {
+        ordered_.erase({timer->when_, timer});
+        timer->slot_ = Timer::kDetached;
+    }
+    else if (timer->slot_ >= 0) {
+        unlinkSlot(timer);
+    }
+    else return;
+    --size_;
+}
+
+void TimingWheel::advance(Timestamp now, std::vector<Timer*>& expired) {
+    const size_t first = expired.size();
+    const uint64_t target = tickOf(now);
+    while (currentTick_ <= target) {
+        // 时间轮里已经没有定时器了，直接拨到 target 之后
+        if (size_ == ordered_.size()) {
+            currentTick_ = target + 1;
+            break;
+        }
+        const uint64_t tick = currentTick_;
+        const int index = static_cast<int>(tick & (kLevel0Slots - 1));
+        if (index == 0) {
+            // 第 0 层转完一圈，依次把高层当前的槽下放，某层下标不为 0 时更高层还没转到
+            for (int level = 1; level < kLevels; ++level) {
+                if (cascade(level) != 0) break;
+            }
+        }
+        else if (slots_[index] == nullptr) {
+            // 跳过空槽：直接拨到本层下一个非空槽，或下一次 cascade 的位置
+            uint64_t boundary = (tick | (kLevel0Slots - 1)) + 1;
+            int next = findOccupied(0, index);
+            uint64_t skipTo = next > index ? tick - index + next : boundary;
+            currentTick_ = std::min({skipTo, boundary, target + 1});
+            continue;
+        }
+
+        Timer* timer = slots_[index];
+        while (timer != nullptr) {
+            Timer* next = timer->next_;
+            unlinkSlot(timer);
+            if (timer->when_ <= now) {
+                expired.push_back(timer);
+                --size_;
+            }
+            else {
+                // 只有 tick == target 时才会发生：同一个 tick 内还没到的部分，交给有序集合精确触发
+                ordered_.insert({timer->when_, timer});
+                timer->slot_ = Timer::kOrdered;
+            }
+            timer = next;
+        }
+        ++currentTick_;
+    }
+
+    while (!ordered_.empty() && ordered_.begin()->first <= now) {
+        Timer* timer = ordered_.begin()->second;
+        ordered_.erase(ordered_.begin());
+        timer->slot_ = Timer::kDetached;
+        expired.push_back(timer);
+        --size_;
+    }
+
+    std::sort(expired.begin() + first, expired.end(),
+              [](const Timer* lhs, const Timer* rhs) { return lhs->when_ < rhs->when_; });
+}
+
+bool TimingWheel::nextDeadline(Timestamp* deadline) const {
+    if (size_ == 0) return false;
+
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    for (int level = 0; level < kLevels; ++level) {
+        const int shift = shiftOf(level);
+        const int mask = slotsOf(level) - 1;
+        const int current = static_cast<int>((currentTick_ >> shift) & mask);
+        const int index = findOccupied(level, current);
+        if (index < 0) continue;
+        const uint64_t distance = static_cast<uint64_t>((index - current) & mask);
+        // 第 0 层是该槽到期的 tick，高层是该槽被下放的 tick
+        uint64_t tick = ((currentTick_ >> shift) + distance) << shift;
+        if (tick < currentTick_) tick += uint64_t(slotsOf(level)) << shift;
+        best = std::min(best, tick);
+    }
+
+    Timestamp result = Timestamp::max();
+    if (best != std::numeric_limits<uint64_t>::max()) {
+        result = timeOfTick(best);
+    }
+    if (!ordered_.empty()) {
+        result = std::min(result, ordered_.begin()->first);
+    }
+    *deadline = result;
+    return true;
+}
+
+void TimingWheel::removeAll(std::vector<Timer*>& timers) {
+    for (int slot = 0; slot < kNumSlots; ++slot) {
+        while (slots_[slot] != nullptr) {
+            Timer* timer = slots_[slot];
+            unlinkSlot(timer);
+            timers.push_back(timer);
+        }
+    }
+    for (auto& entry : ordered_) {
+        entry.second->slot_ = Timer::kDetached;
+        timers.push_back(entry.second);
+    }
+    ordered_.clear();
+    size_ = 0;
+}
+
+uint64_t TimingWheel::tickOf(Timestamp when) {
+    return static_cast<uint64_t>(when.time_since_epoch().count() / kTick.count());
+}
+
+Timestamp TimingWheel::timeOfTick(uint64_t tick) {
+    return Timestamp(Nanoseconds(static_cast<int64_t>(tick) * kTick.count()));
+}
+
+void TimingWheel::place(Timer* timer) {
+    uint64_t tick = tickOf(timer->when_);
+    if (tick < currentTick_) {
+        ordered_.insert({timer->when_, timer});
+        timer->slot_ = Timer::kOrdered;
+        return;
+    }
+    uint64_t delta = tick - currentTick_;
+    if (delta >= kMaxDelta) {
+        // 超出时间轮范围，先放在最远的位置，转到时再按真实时间重新放置
+        delta = kMaxDelta - 1;
+        tick = currentTick_ + delta;
+    }
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (uint64_t(1) << shiftOf(level + 1))) {
+        ++level;
+    }
+    const int index = static_cast<int>((tick >> shiftOf(level)) & (slotsOf(level) - 1));
+    linkSlot(timer, baseOf(level) + index);
+}
+
+void TimingWheel::linkSlot(Timer* timer, int slot) {
+    timer->prev_ = nullptr;
+    timer->next_ = slots_[slot];
+    if (timer->next_ != nullptr) {
+        timer->next_->prev_ = timer;
+    }
+    slots_[slot] = timer;
+    timer->slot_ = slot;
+    occupied_[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TimingWheel::unlinkSlot(Timer* timer) {
+    const int slot = timer->slot_;
+    assert(slot >= 0);
+    if (timer->prev_ != nullptr) timer->prev_->next_ = timer->next_;
+    else slots_[slot] = timer->next_;
+    if (timer->next_ != nullptr) timer->next_->prev_ = timer->prev_;
+    if (slots_[slot] == nullptr) {
+        occupied_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+    timer->prev_ = nullptr;
+    timer->next_ = nullptr;
+    timer->slot_ = Timer::kDetached;
+}
+
+int TimingWheel::cascade(int level) {
+    const int index = static_cast<int>((currentTick_ >> shiftOf(level)) & (slotsOf(level) - 1));
+    const int slot = baseOf(level) + index;
+    Timer* timer = slots_[slot];
+    slots_[slot] = nullptr;
+    occupied_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    while (timer != nullptr) {
+        Timer* next = timer->next_;
+        place(timer);
+        timer = next;
+    }
+    return index;
+}
+
+int TimingWheel::findOccupied(int level, int from) const {
+    // 每层的槽都按 64 位对齐，第 0 层占 4 个字，其余各层各占 1 个字
+    const int firstWord = baseOf(level) / 64;
+    const int words = slotsOf(level) / 64;
+    const int bit = from % 64;
+    for (int i = 0; i <= words; ++i) {
+        const int word = (from / 64 + i) % words;
+        uint64_t bits = occupied_[firstWord + word];
+        if (i == 0) bits &= ~uint64_t(0) << bit;                         // from 及之后
+        else if (i == words) bits &= (uint64_t(1) << bit) - 1;           // 绕回来，from 之前
+        if (bits != 0) return word * 64 + std::countr_zero(bits);
+    }
+    return -1;
+}
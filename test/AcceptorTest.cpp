@@ -5,6 +5,10 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 class AcceptorTest : public ::testing::Test {
 protected:
@@ -71,3 +75,103 @@ TEST_F(AcceptorTest, ListeningState) {
     EXPECT_TRUE(acceptor.listening());
 }
 
+
+// 测试批量 accept：一次可读事件取完所有排队的连接，只回调一次
+TEST_F(AcceptorTest, BatchAccept) {
+    Acceptor acceptor(loop, InetAddress(0, true));
+    acceptor.setMaxAcceptsPerRead(16);
+    std::vector<size_t> batchSizes;
+    acceptor.setNewConnectionBatchCallback([&](const InetAddress&, std::vector<AcceptedSocket>& sockets) {
+        batchSizes.push_back(sockets.size());
+        for (auto& socket : sockets) {
+            ::close(socket.sockfd);
+        }
+    });
+    acceptor.listen();
+
+    // 先完成 5 个连接的握手，再运行 loop
+    const int kClients = 5;
+    std::vector<int> clients;
+    for (int i = 0; i < kClients; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(::connect(fd, acceptor.local().getSockaddr(), acceptor.local().getSocklen()), 0);
+        clients.push_back(fd);
+    }
+    loop->runAfter(std::chrono::milliseconds(100), [this]() { loop->quit(); });
+    loop->loop();
+
+    ASSERT_EQ(batchSizes.size(), 1u);
+    EXPECT_EQ(batchSizes[0], static_cast<size_t>(kClients));
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
+
+// 测试每次可读事件最多 accept 的个数
+TEST_F(AcceptorTest, MaxAcceptsPerRead) {
+    Acceptor acceptor(loop, InetAddress(0, true));
+    acceptor.setMaxAcceptsPerRead(2);
+    std::vector<size_t> batchSizes;
+    acceptor.setNewConnectionBatchCallback([&](const InetAddress&, std::vector<AcceptedSocket>& sockets) {
+        batchSizes.push_back(sockets.size());
+        for (auto& socket : sockets) {
+            ::close(socket.sockfd);
+        }
+    });
+    acceptor.listen();
+
+    std::vector<int> clients;
+    for (int i = 0; i < 5; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(::connect(fd, acceptor.local().getSockaddr(), acceptor.local().getSocklen()), 0);
+        clients.push_back(fd);
+    }
+    loop->runAfter(std::chrono::milliseconds(100), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(batchSizes, (std::vector<size_t>{2, 2, 1}));
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
+
+// 测试文件描述符耗尽：借用预留的 fd accept 后立即关闭，对端收到 FIN，不会让 loop 空转
+TEST_F(AcceptorTest, RejectWhenOutOfFds) {
+    Acceptor acceptor(loop, InetAddress(0, true));
+    std::atomic<int> accepted(0);
+    acceptor.setNewConnectionCallback([&accepted](int sockfd, const InetAddress&, const InetAddress&) {
+        accepted++;
+        ::close(sockfd);
+    });
+    acceptor.listen();
+
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(::connect(client, acceptor.local().getSockaddr(), acceptor.local().getSocklen()), 0);
+
+    // 临时调低描述符上限并占满剩余的 fd
+    struct rlimit saved;
+    ASSERT_EQ(::getrlimit(RLIMIT_NOFILE, &saved), 0);
+    struct rlimit limited = saved;
+    limited.rlim_cur = 256;
+    ASSERT_EQ(::setrlimit(RLIMIT_NOFILE, &limited), 0);
+    std::vector<int> fillers;
+    int fd;
+    while ((fd = ::dup(client)) != -1) {
+        fillers.push_back(fd);
+    }
+    ASSERT_EQ(errno, EMFILE);
+
+    loop->runAfter(std::chrono::milliseconds(50), [this]() { loop->quit(); });
+    loop->loop();
+
+    for (int filler : fillers) {
+        ::close(filler);
+    }
+    ASSERT_EQ(::setrlimit(RLIMIT_NOFILE, &saved), 0);
+
+    EXPECT_EQ(accepted.load(), 0);
+    EXPECT_EQ(acceptor.rejectedAccepts(), 1u);
+    char byte;
+    EXPECT_EQ(::read(client, &byte, 1), 0);
+    ::close(client);
+}
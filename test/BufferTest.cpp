@@ -186,3 +186,153 @@ TEST_F(BufferTest, RetrieveUntil) {
     }
 }
 
+
+// 测试向量化查找与逐字节查找的结果一致：分隔符落在向量块边界、孤立的 '\r'、末尾的 '\r'
+TEST_F(BufferTest, FindMatchesScalar) {
+    const ByteSet set(" ;,\t");
+    for (size_t len = 0; len <= 100; ++len) {
+        for (size_t pos = 0; pos < len; ++pos) {
+            std::string data(len, 'x');
+            data[pos] = '\r';
+            if (pos + 1 < len) data[pos + 1] = (pos % 3 == 0) ? 'y' : '\n';
+            if (pos >= 2) data[pos - 2] = '\r';  // 孤立的 '\r'
+            Buffer b;
+            b.append(data);
+            const char* crlf = b.findCRLF();
+            size_t expected = data.find("\r\n");
+            if (expected == std::string::npos) {
+                EXPECT_EQ(crlf, nullptr) << len << " " << pos;
+            }
+            else {
+                ASSERT_NE(crlf, nullptr) << len << " " << pos;
+                EXPECT_EQ(static_cast<size_t>(crlf - b.peek()), expected) << len << " " << pos;
+            }
+
+            data[pos] = (pos % 2 == 0) ? ';' : '\t';
+            b.retrieveAll();
+            b.append(data);
+            const char* found = b.findFirstOf(set);
+            ASSERT_NE(found, nullptr);
+            EXPECT_EQ(static_cast<size_t>(found - b.peek()), data.find_first_of(" ;,\t"));
+        }
+    }
+}
+
+// 测试多分隔符查找，集合超过向量比较的上限时退回查表
+TEST_F(BufferTest, FindFirstOf) {
+    buffer->append(std::string(40, 'a') + "key=value&next");
+    ByteSet delimiters("=&");
+    const char* eq = buffer->findFirstOf(delimiters);
+    ASSERT_NE(eq, nullptr);
+    EXPECT_EQ(*eq, '=');
+    const char* amp = buffer->findFirstOf(eq + 1, delimiters);
+    ASSERT_NE(amp, nullptr);
+    EXPECT_EQ(amp - buffer->peek(), 49);
+    EXPECT_EQ(buffer->findFirstOf(ByteSet("#!")), nullptr);
+
+    ByteSet many("0123456789ABCDEFGHIJ");
+    EXPECT_EQ(many.size(), 20u);
+    buffer->append(std::string("xyzJ"));
+    const char* j = buffer->findFirstOf(many);
+    ASSERT_NE(j, nullptr);
+    EXPECT_EQ(*j, 'J');
+}
+
+// 测试可恢复的查找：分段到达时从上次停下的位置继续，retrieve 和扩容搬移后游标仍然正确
+TEST_F(BufferTest, ScanResumable) {
+    Buffer b(16);
+    const std::string line = "GET /index.html HTTP/1.1\r\n";
+    for (size_t i = 0; i + 1 < line.size(); ++i) {
+        b.append(&line[i], 1);
+        EXPECT_EQ(b.scanCRLF(), nullptr);
+    }
+    b.append("\n", 1);
+    const char* crlf = b.scanCRLF();
+    ASSERT_NE(crlf, nullptr);
+    EXPECT_EQ(static_cast<size_t>(crlf - b.peek()), line.size() - 2);
+    // 游标停在分隔符上，重复调用结果不变
+    EXPECT_EQ(b.scanCRLF(), crlf);
+    b.retrieveUntil(crlf + 2);
+
+    // 第二行分段到达，中间触发扩容和数据搬移
+    b.append(std::string("Host: "));
+    EXPECT_EQ(b.scanCRLF(), nullptr);
+    b.append(std::string(100, 'h'));
+    EXPECT_EQ(b.scanCRLF(), nullptr);
+    b.append(std::string("\r"));
+    EXPECT_EQ(b.scanCRLF(), nullptr);
+    b.append(std::string("\n"));
+    crlf = b.scanCRLF();
+    ASSERT_NE(crlf, nullptr);
+    EXPECT_EQ(crlf - b.peek(), 106);
+
+    // 换用另一种分隔符前重置游标
+    b.resetScan();
+    const char* colon = b.scanFirstOf(ByteSet(":"));
+    ASSERT_NE(colon, nullptr);
+    EXPECT_EQ(colon - b.peek(), 4);
+    b.retrieveAll();
+    b.append(std::string("a\nb\n"));
+    const char* eol = b.scanEOL();
+    ASSERT_NE(eol, nullptr);
+    EXPECT_EQ(eol - b.peek(), 1);
+}
+
+// 测试延迟分配和 shrink：构造时不持有存储，读空后 shrink(0) 把存储还给线程本地池，下次分配复用
+TEST_F(BufferTest, LazyStorageAndShrink) {
+    Buffer lazy(0);
+    EXPECT_EQ(lazy.capacity(), 0);
+    EXPECT_EQ(lazy.readableBytes(), 0);
+
+    std::string burst(20000, 'b');
+    lazy.append(burst);
+    const size_t peak = lazy.capacity();
+    EXPECT_GE(peak, Buffer::kCheapPrepend + burst.size());
+
+    // 有可读数据时只缩小到刚好容纳
+    lazy.retrieve(19990);
+    lazy.shrink(0);
+    EXPECT_LT(lazy.capacity(), peak);
+    EXPECT_EQ(lazy.retrieveAllAsString(), std::string(10, 'b'));
+
+    const size_t cached = BufferPool::cachedBytes();
+    lazy.shrink(0);
+    EXPECT_EQ(lazy.capacity(), 0);
+    EXPECT_GT(BufferPool::cachedBytes(), cached);
+
+    // 释放后仍然可以继续使用，同一级别的存储从池中取出
+    lazy.append(burst.data(), 100);
+    EXPECT_EQ(lazy.readableBytes(), 100);
+    EXPECT_EQ(BufferPool::cachedBytes(), cached);
+}
+
+// 测试扩容逐级进行：每次写满后多追加一个字节，扩容都落在 BufferPool 相邻的下一级，不会跳级
+TEST_F(BufferTest, GrowthUsesConsecutiveClasses) {
+    Buffer growing;
+    size_t capacity = growing.capacity();
+    EXPECT_EQ(capacity, Buffer::kCheapPrepend + Buffer::kInitialSize);
+    while (capacity < Buffer::kCheapPrepend + 64 * 1024) {
+        growing.append(std::string(growing.writableBytes() + 1, 'g'));
+        const size_t grown = growing.capacity();
+        EXPECT_EQ(grown - Buffer::kCheapPrepend, 2 * (capacity - Buffer::kCheapPrepend));
+        capacity = grown;
+    }
+}
+
+// 测试拷贝和移动：拷贝只复制可读数据，移动后源对象回到未分配状态
+TEST_F(BufferTest, CopyAndMove) {
+    buffer->append(std::string("header"));
+    buffer->retrieve(2);
+    Buffer copy(*buffer);
+    EXPECT_EQ(copy.retrieveAllAsString(), "ader");
+    EXPECT_EQ(buffer->readableBytes(), 4);
+
+    Buffer moved(std::move(*buffer));
+    EXPECT_EQ(buffer->capacity(), 0);
+    EXPECT_EQ(buffer->readableBytes(), 0);
+    EXPECT_EQ(moved.retrieveAllAsString(), "ader");
+
+    copy = moved;
+    copy.append(std::string("xyz"));
+    EXPECT_EQ(copy.retrieveAllAsString(), "xyz");
+}
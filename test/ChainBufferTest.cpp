@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include "knetlib/ChainBuffer.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <thread>
+
+class ChainBufferTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        buffer = new ChainBuffer();
+    }
+
+    void TearDown() override {
+        delete buffer;
+    }
+
+    ChainBuffer* buffer;
+};
+
+// 测试基本构造
+TEST_F(ChainBufferTest, Constructor) {
+    EXPECT_EQ(buffer->readableBytes(), 0);
+    EXPECT_EQ(buffer->numBlocks(), 0);
+    EXPECT_EQ(buffer->contiguousBytes(), 0);
+}
+
+// 测试 append 和 retrieve
+TEST_F(ChainBufferTest, AppendAndRetrieve) {
+    buffer->append("Hello, ", 7);
+    buffer->append(std::string_view("World!"));
+    EXPECT_EQ(buffer->readableBytes(), 13);
+    EXPECT_EQ(buffer->contiguousBytes(), 13);
+    EXPECT_EQ(memcmp(buffer->peek(), "Hello, World!", 13), 0);
+
+    buffer->retrieve(7);
+    EXPECT_EQ(buffer->retrieveAllAsString(), "World!");
+    EXPECT_EQ(buffer->readableBytes(), 0);
+}
+
+// 测试跨块追加：已有数据不移动，只追加新块
+TEST_F(ChainBufferTest, AppendAcrossBlocks) {
+    std::string first(ChainBuffer::kBlockSize - 10, 'A');
+    buffer->append(first.data(), first.size());
+    const char* head = buffer->peek();
+
+    std::string second(100, 'B');
+    buffer->append(second.data(), second.size());
+
+    EXPECT_EQ(buffer->numBlocks(), 2);
+    EXPECT_EQ(buffer->peek(), head);  // 扩容后首块地址不变
+    EXPECT_EQ(buffer->contiguousBytes(), ChainBuffer::kBlockSize);
+    EXPECT_EQ(buffer->retrieveAllAsString(), first + second);
+}
+
+// 测试大消息：多 MB 数据完整保存
+TEST_F(ChainBufferTest, LargePayload) {
+    std::string payload(3 * 1024 * 1024 + 123, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i % 251);
+    }
+    for (size_t off = 0; off < payload.size(); off += 1000) {
+        buffer->append(payload.data() + off, std::min<size_t>(1000, payload.size() - off));
+    }
+    EXPECT_EQ(buffer->readableBytes(), payload.size());
+    EXPECT_EQ(buffer->retrieveAsString(payload.size()), payload);
+}
+
+// 测试部分 retrieve 释放已读块
+TEST_F(ChainBufferTest, RetrieveReleasesBlocks) {
+    std::string data(3 * ChainBuffer::kBlockSize, 'x');
+    buffer->append(data.data(), data.size());
+    EXPECT_EQ(buffer->numBlocks(), 3);
+
+    buffer->retrieve(ChainBuffer::kBlockSize + 1);
+    EXPECT_EQ(buffer->numBlocks(), 2);
+    EXPECT_EQ(buffer->readableBytes(), 2 * ChainBuffer::kBlockSize - 1);
+
+    // 读空后所有块都归还块池
+    buffer->retrieveAll();
+    EXPECT_EQ(buffer->numBlocks(), 0);
+    EXPECT_EQ(buffer->readableBytes(), 0);
+}
+
+// 测试 copyOut 不移动读指针
+TEST_F(ChainBufferTest, CopyOut) {
+    std::string data(ChainBuffer::kBlockSize + 16, 'y');
+    data[ChainBuffer::kBlockSize - 1] = 'a';
+    data[ChainBuffer::kBlockSize] = 'b';
+    buffer->append(data.data(), data.size());
+
+    buffer->retrieve(ChainBuffer::kBlockSize - 1);
+    char out[2];
+    EXPECT_EQ(buffer->copyOut(out, 2), 2);
+    EXPECT_EQ(out[0], 'a');
+    EXPECT_EQ(out[1], 'b');
+    EXPECT_EQ(buffer->readableBytes(), 17);
+}
+
+// 测试 iovec 视图
+TEST_F(ChainBufferTest, ReadableIovec) {
+    std::string data(2 * ChainBuffer::kBlockSize + 5, 'z');
+    buffer->append(data.data(), data.size());
+
+    struct iovec iov[8];
+    int n = buffer->readableIovec(iov, 8);
+    ASSERT_EQ(n, 3);
+    size_t total = 0;
+    for (int i = 0; i < n; ++i) {
+        total += iov[i].iov_len;
+    }
+    EXPECT_EQ(total, data.size());
+    EXPECT_EQ(buffer->readableIovec(iov, 1), 1);
+}
+
+// 测试 readFd / writeFd
+TEST_F(ChainBufferTest, ReadWriteFd) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    std::string data(40000, 'q');
+    ChainBuffer out;
+    out.append(data.data(), data.size());
+    int savedErrno = 0;
+    EXPECT_EQ(out.writeFd(fds[0], &savedErrno), static_cast<ssize_t>(data.size()));
+    EXPECT_EQ(out.readableBytes(), 0);
+
+    size_t received = 0;
+    while (received < data.size()) {
+        ssize_t n = buffer->readFd(fds[1], &savedErrno);
+        ASSERT_GT(n, 0);
+        received += static_cast<size_t>(n);
+    }
+    EXPECT_EQ(buffer->retrieveAllAsString(), data);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 测试 swap
+TEST_F(ChainBufferTest, Swap) {
+    ChainBuffer other;
+    buffer->append("Buffer1", 7);
+    other.append("Buffer2", 7);
+
+    buffer->swap(other);
+    EXPECT_EQ(buffer->retrieveAllAsString(), "Buffer2");
+    EXPECT_EQ(other.retrieveAllAsString(), "Buffer1");
+}
+
+// 测试 writeFd 限制写出字节数
+TEST_F(ChainBufferTest, WriteFdMaxBytes) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    std::string data(ChainBuffer::kBlockSize + 100, 'm');
+    buffer->append(data.data(), data.size());
+    int savedErrno = 0;
+    EXPECT_EQ(buffer->writeFd(fds[0], &savedErrno, ChainBuffer::kBlockSize + 1),
+              static_cast<ssize_t>(ChainBuffer::kBlockSize + 1));
+    EXPECT_EQ(buffer->readableBytes(), 99);
+    EXPECT_EQ(buffer->writeFd(fds[0], &savedErrno, 0), 0);
+    EXPECT_EQ(buffer->readableBytes(), 99);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 测试线程退出时块池先于 ChainBuffer 析构：之后归还的块直接交还系统，不写入已经析构的池
+TEST_F(ChainBufferTest, FreedAfterPoolDestroyed) {
+    size_t appended = 0;
+    std::thread worker([&appended]() {
+        // 先于块池构造的 thread_local 对象后于块池析构
+        thread_local ChainBuffer chain;
+        std::string data(3 * ChainBuffer::kBlockSize, 'd');
+        chain.append(data.data(), data.size());
+        appended = chain.readableBytes();
+    });
+    worker.join();
+    EXPECT_EQ(appended, 3 * ChainBuffer::kBlockSize);
+}
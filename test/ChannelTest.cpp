@@ -144,11 +144,44 @@ TEST_F(ChannelTest, SetRevents) {
     // revents 已设置，但需要通过 events() 检查
 }
 
-// 测试兼容 API: useET
+// 测试边缘触发：注册时带上 EPOLLET 和常驻的 EPOLLOUT，开关写事件不改变注册的事件
 TEST_F(ChannelTest, UseET) {
-    // useET 目前是空实现，只测试不会崩溃
     channel->useET();
-    EXPECT_TRUE(true);  // 如果到这里没有崩溃，测试通过
+    EXPECT_TRUE(channel->isEdgeTriggered());
+    EXPECT_TRUE(channel->isNoneEvents());
+
+    channel->enableRead();
+    const unsigned registered = channel->events();
+    EXPECT_TRUE(registered & EPOLLET);
+    EXPECT_TRUE(registered & EPOLLOUT);
+    EXPECT_FALSE(channel->isWriting());
+
+    channel->enableWrite();
+    EXPECT_TRUE(channel->isWriting());
+    EXPECT_EQ(channel->events(), registered);
+    channel->disableWrite();
+    EXPECT_FALSE(channel->isWriting());
+    EXPECT_EQ(channel->events(), registered);
+
+    channel->disableAll();
+    EXPECT_TRUE(channel->isNoneEvents());
+}
+
+// 测试边缘触发下没有打开写事件时，EPOLLOUT 不会调用写回调
+TEST_F(ChannelTest, UseETIgnoresWritableWhenNotWriting) {
+    int writes = 0;
+    channel->setWriteCallback([&writes]() { ++writes; });
+    channel->useET();
+    channel->enableRead();
+
+    channel->setRevents(EPOLLOUT);
+    channel->handleEvents();
+    EXPECT_EQ(writes, 0);
+
+    channel->enableWrite();
+    channel->handleEvents();
+    EXPECT_EQ(writes, 1);
+    channel->disableAll();
 }
 
 // 测试兼容 API: setUseThreadPool
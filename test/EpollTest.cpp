@@ -4,6 +4,8 @@
 #include "knetlib/Channel.h"
 #include <unistd.h>
 #include <sys/epoll.h>
+#include <memory>
+#include <vector>
 
 class EpollTest : public ::testing::Test {
 protected:
@@ -98,3 +100,56 @@ TEST_F(EpollTest, Poll) {
     EXPECT_TRUE(true);
 }
 
+
+// 测试事件数组：填满时加倍，长时间用不满时减半，不小于初始大小；设置上限后每次最多返回上限个事件
+TEST_F(EpollTest, AdaptiveEventList) {
+    const int kPipes = 300;
+    std::vector<int> fds;
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (int i = 0; i < kPipes; ++i) {
+        int p[2];
+        ASSERT_EQ(pipe(p), 0);
+        fds.push_back(p[0]);
+        fds.push_back(p[1]);
+        ASSERT_EQ(write(p[1], "x", 1), 1);
+        // 先通过 loop 设置事件再从 loop 中移除，然后注册到被测的 epoll 上
+        auto ch = std::make_unique<Channel>(loop, p[0]);
+        ch->enableRead();
+        loop->removeChannel(ch.get());
+        epoll->updateChannel(ch.get());
+        channels.push_back(std::move(ch));
+    }
+
+    Epoll::ChannelList active;
+    epoll->poll(active, 0);
+    EXPECT_EQ(active.size(), 128u);
+    EXPECT_EQ(epoll->eventListSize(), 256u);
+    active.clear();
+    epoll->poll(active, 0);
+    EXPECT_EQ(active.size(), 256u);
+    EXPECT_EQ(epoll->eventListSize(), 512u);
+
+    epoll->setMaxEvents(16);
+    active.clear();
+    epoll->poll(active, 0);
+    EXPECT_EQ(active.size(), 16u);
+    epoll->setMaxEvents(0);
+
+    // 读走数据后没有就绪事件，数组逐步缩回初始大小
+    char byte;
+    for (int i = 0; i < kPipes; ++i) {
+        ASSERT_EQ(read(fds[2 * i], &byte, 1), 1);
+    }
+    for (int i = 0; i < 200; ++i) {
+        active.clear();
+        epoll->poll(active, 0);
+    }
+    EXPECT_EQ(epoll->eventListSize(), 128u);
+
+    for (auto& ch : channels) {
+        epoll->removeChannel(ch.get());
+    }
+    for (int fd : fds) {
+        close(fd);
+    }
+}
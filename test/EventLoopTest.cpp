@@ -5,6 +5,7 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <vector>
 #include <unistd.h>
 #include <sys/eventfd.h>
 #include <cstring>
@@ -181,3 +182,113 @@ TEST_F(EventLoopTest, MultipleTasks) {
     EXPECT_EQ(counter.load(), 0);  // 还没有执行
 }
 
+
+// 测试多个线程并发 queueInLoop：任务全部执行，且每个生产者的任务按投递顺序执行
+TEST_F(EventLoopTest, ConcurrentQueueInLoop) {
+    const int kProducers = 4;
+    const int kTasks = 10000;
+    std::vector<int> next(kProducers, 0);
+    bool ordered = true;
+    int executed = 0;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < kTasks; ++i) {
+                loop->queueInLoop([&, p, i]() {
+                    if (next[p] != i) ordered = false;
+                    next[p] = i + 1;
+                    if (++executed == kProducers * kTasks) loop->quit();
+                });
+            }
+        });
+    }
+    loop->loop();
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    EXPECT_EQ(executed, kProducers * kTasks);
+    EXPECT_TRUE(ordered);
+}
+
+// 测试忙轮询模式：跨线程任务和定时器照常执行，超过忙轮询时间后阻塞也能被唤醒
+TEST_F(EventLoopTest, BusyPoll) {
+    loop->setBusyPoll(Milliseconds(20));
+    std::atomic<int> executed(0);
+    std::thread producer([&]() {
+        for (int i = 0; i < 100; ++i) {
+            loop->queueInLoop([&executed]() { executed++; });
+        }
+        // 等 loop 退回阻塞模式后再投递
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        loop->queueInLoop([&executed]() { executed++; });
+    });
+    bool timerFired = false;
+    loop->runAfter(Milliseconds(5), [&timerFired]() { timerFired = true; });
+    loop->runEvery(Milliseconds(10), [&]() {
+        if (executed.load() == 101) loop->quit();
+    });
+    loop->loop();
+    producer.join();
+
+    EXPECT_EQ(executed.load(), 101);
+    EXPECT_TRUE(timerFired);
+}
+
+// 测试监听修改的合并：同一轮内反复开关写事件不产生 epoll_ctl，最终有变化时只提交一次
+TEST_F(EventLoopTest, CoalescedChannelUpdates) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    Channel channel(loop, fds[1]);
+    channel.enableRead();
+    // 跑一轮循环把之前的修改都提交
+    loop->runAfter(std::chrono::milliseconds(1), [this]() { loop->quit(); });
+    loop->loop();
+
+    uint64_t requests = loop->channelUpdateRequests();
+    uint64_t kernel = loop->pollerKernelUpdates();
+    for (int i = 0; i < 100; ++i) {
+        channel.enableWrite();
+        channel.disableWrite();
+    }
+    loop->runAfter(std::chrono::milliseconds(1), [this]() { loop->quit(); });
+    loop->loop();
+    EXPECT_EQ(loop->channelUpdateRequests() - requests, 200u);
+    EXPECT_EQ(loop->pollerKernelUpdates(), kernel);
+
+    channel.enableWrite();
+    channel.disableRead();
+    loop->runAfter(std::chrono::milliseconds(1), [this]() { loop->quit(); });
+    loop->loop();
+    EXPECT_EQ(loop->pollerKernelUpdates() - kernel, 1u);
+
+    // 修改尚未提交时删除，立即生效
+    channel.enableRead();
+    channel.disableAll();
+    EXPECT_FALSE(channel.pooling);
+    EXPECT_FALSE(channel.updatePending);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 测试每轮任务上限：大批任务分多轮执行，期间到期的定时器不必等全部任务执行完
+TEST_F(EventLoopTest, IterationBudget) {
+    loop->setIterationBudget(0, 10);
+    const int kTasks = 1000;
+    int done = 0;
+    int doneAtTimer = -1;
+    loop->runAfter(std::chrono::milliseconds(1), [&]() { doneAtTimer = done; });
+    for (int i = 0; i < kTasks; ++i) {
+        loop->queueInLoop([&]() {
+            auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(50);
+            while (std::chrono::steady_clock::now() < until) {}
+            if (++done == kTasks) loop->quit();
+        });
+    }
+    loop->loop();
+
+    EXPECT_EQ(done, kTasks);
+    EXPECT_GE(doneAtTimer, 0);
+    EXPECT_LT(doneAtTimer, kTasks);
+}
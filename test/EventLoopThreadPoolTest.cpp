@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
 #include "knetlib/EventLoopThreadPool.h"
 #include "knetlib/EventLoop.h"
+#include "knetlib/InetAddress.h"
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <future>
 #include <set>
+#include <pthread.h>
 
 class EventLoopThreadPoolTest : public ::testing::Test {
 protected:
@@ -133,3 +136,88 @@ TEST_F(EventLoopThreadPoolTest, RoundRobin) {
     loop->quit();
 }
 
+
+// 测试最少连接数分配：新连接总是分配到连接数最少的线程
+TEST_F(EventLoopThreadPoolTest, LeastConnections) {
+    EventLoopThreadPool pool(loop);
+    pool.setThreadNum(3);
+    pool.setLoadBalance(LoadBalance::kLeastConnections);
+    pool.start();
+
+    auto loops = pool.getAllLoops();
+    // 线程 1 上有 2 个连接，线程 2 上有 1 个
+    pool.connectionOpened(loops[1]);
+    pool.connectionOpened(loops[1]);
+    pool.connectionOpened(loops[2]);
+    EXPECT_EQ(pool.numConnections(loops[1]), 2u);
+
+    EXPECT_EQ(pool.getNextLoop(), loops[3]);
+    pool.connectionOpened(loops[3]);
+    EXPECT_EQ(pool.getNextLoop(), loops[2]);
+    pool.connectionOpened(loops[2]);
+    pool.connectionClosed(loops[1]);
+    pool.connectionClosed(loops[1]);
+    EXPECT_EQ(pool.getNextLoop(), loops[1]);
+}
+
+// 测试最少待执行任务分配：跳过任务队列积压的线程
+TEST_F(EventLoopThreadPoolTest, LeastPendingTasks) {
+    EventLoopThreadPool pool(loop);
+    pool.setThreadNum(2);
+    pool.setLoadBalance(LoadBalance::kLeastPendingTasks);
+    pool.start();
+
+    auto loops = pool.getAllLoops();
+    // 阻塞线程 1，让后面投递的任务积压在队列中
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    loops[1]->runInLoop([released]() { released.wait(); });
+    for (int i = 0; i < 10; ++i) {
+        loops[1]->runInLoop([]() {});
+    }
+    EXPECT_GE(loops[1]->pendingTaskCount(), 10u);
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(pool.getNextLoop(), loops[2]);
+    }
+    release.set_value();
+}
+
+// 测试一致性哈希：同一个 IP 总是分配到同一个线程，不同 IP 分散到各个线程
+TEST_F(EventLoopThreadPoolTest, ConsistentHash) {
+    EventLoopThreadPool pool(loop);
+    pool.setThreadNum(4);
+    pool.setLoadBalance(LoadBalance::kConsistentHash);
+    pool.start();
+
+    EventLoop* first = pool.getNextLoop(InetAddress("10.0.0.1", 1000));
+    EXPECT_NE(first, loop);
+    EXPECT_EQ(pool.getNextLoop(InetAddress("10.0.0.1", 2000)), first);
+
+    std::set<EventLoop*> used;
+    for (int i = 0; i < 200; ++i) {
+        std::string ip = "10.0." + std::to_string(i / 100) + "." + std::to_string(i % 100 + 1);
+        used.insert(pool.getNextLoop(InetAddress(ip, 80)));
+    }
+    EXPECT_EQ(used.size(), 4u);
+}
+
+// 测试工作线程按前缀命名
+TEST_F(EventLoopThreadPoolTest, ThreadName) {
+    EventLoopThreadPool pool(loop);
+    pool.setThreadNum(2);
+    pool.setThreadName("io");
+    pool.setCpuAffinity(std::vector<int>{0});
+    pool.start();
+
+    auto loops = pool.getAllLoops();
+    for (size_t i = 1; i < loops.size(); ++i) {
+        std::promise<std::string> name;
+        loops[i]->runInLoop([&name]() {
+            char buf[16] = {0};
+            pthread_getname_np(pthread_self(), buf, sizeof(buf));
+            name.set_value(buf);
+        });
+        EXPECT_EQ(name.get_future().get(), "io" + std::to_string(i - 1));
+    }
+}
@@ -4,6 +4,9 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <future>
+#include <pthread.h>
+#include <sched.h>
 
 class EventLoopThreadTest : public ::testing::Test {
 protected:
@@ -80,3 +83,25 @@ TEST_F(EventLoopThreadTest, StopAndRestart) {
     thread2.stop();
 }
 
+
+// 测试线程名和 CPU 亲和性在 EventLoop 线程中生效
+TEST_F(EventLoopThreadTest, NameAndCpuAffinity) {
+    EventLoopThread thread;
+    thread.setName("knet-io-thread-with-long-name");
+    thread.setCpuAffinity({0});
+    thread.setNumaLocal(true);
+    EventLoop* loop = thread.startLoop();
+
+    std::promise<std::pair<std::string, bool>> result;
+    loop->runInLoop([&result]() {
+        char name[16] = {0};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(0, sizeof(set), &set);
+        result.set_value({name, CPU_COUNT(&set) == 1 && CPU_ISSET(0, &set)});
+    });
+    auto [name, pinned] = result.get_future().get();
+    EXPECT_EQ(name, "knet-io-thread-");  // 截断为 15 个字符
+    EXPECT_TRUE(pinned);
+}
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "knetlib/HttpParser.h"
+#include "knetlib/HttpResponse.h"
+#include "knetlib/Buffer.h"
+#include <string>
+
+// 测试解析请求行、查询串和头部，头部名称不区分大小写
+TEST(HttpParserTest, SimpleGet) {
+    HttpParser parser;
+    Buffer buffer;
+    buffer.append(std::string("GET /index.html?a=1&b=2 HTTP/1.1\r\nHost: localhost\r\nX-Token:  abc \r\n\r\n"));
+    ASSERT_EQ(parser.parse(buffer), HttpParser::kComplete);
+    const HttpRequest& req = parser.request();
+    EXPECT_EQ(req.method(), "GET");
+    EXPECT_EQ(req.path(), "/index.html");
+    EXPECT_EQ(req.query(), "a=1&b=2");
+    EXPECT_EQ(req.versionMinor(), 1);
+    EXPECT_EQ(req.headers().size(), 2u);
+    EXPECT_EQ(req.header("host"), "localhost");
+    EXPECT_EQ(req.header("X-TOKEN"), "abc");
+    EXPECT_EQ(req.header("Missing"), "");
+    EXPECT_TRUE(req.body().empty());
+    EXPECT_TRUE(req.keepAlive());
+    parser.retrieveRequest(buffer);
+    EXPECT_EQ(buffer.readableBytes(), 0u);
+}
+
+// 测试请求逐字节到达：收齐前一直返回 kIncomplete，收齐后视图指向搬移后的缓冲区
+TEST(HttpParserTest, PartialRequest) {
+    const std::string raw = "POST /upload HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world";
+    HttpParser parser;
+    Buffer buffer(16);
+    for (size_t i = 0; i + 1 < raw.size(); ++i) {
+        buffer.append(&raw[i], 1);
+        ASSERT_EQ(parser.parse(buffer), HttpParser::kIncomplete) << i;
+    }
+    buffer.append(&raw.back(), 1);
+    ASSERT_EQ(parser.parse(buffer), HttpParser::kComplete);
+    EXPECT_EQ(parser.request().method(), "POST");
+    EXPECT_EQ(parser.request().path(), "/upload");
+    EXPECT_EQ(parser.request().header("Content-Length"), "11");
+    EXPECT_EQ(parser.request().body(), "hello world");
+}
+
+// 测试流水线：一个缓冲区中的多个请求依次解析
+TEST(HttpParserTest, Pipelining) {
+    HttpParser parser;
+    Buffer buffer;
+    buffer.append(std::string("GET /a HTTP/1.1\r\n\r\n"
+                              "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz"
+                              "GET /c HTTP/1.1\r\n\r\n"
+                              "GET /d HTT"));
+    std::string paths;
+    while (parser.parse(buffer) == HttpParser::kComplete) {
+        paths.append(parser.request().path());
+        parser.retrieveRequest(buffer);
+    }
+    EXPECT_EQ(paths, "/a/b/c");
+    buffer.append(std::string("P/1.1\r\n\r\n"));
+    ASSERT_EQ(parser.parse(buffer), HttpParser::kComplete);
+    EXPECT_EQ(parser.request().path(), "/d");
+}
+
+// 测试 chunked 请求体在缓冲区中就地拼接，扩展和尾部字段被忽略
+TEST(HttpParserTest, ChunkedBody) {
+    const std::string raw = "POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                            "5;ext=1\r\nhello\r\n"
+                            "1\r\n \r\n"
+                            "a\r\n0123456789\r\n"
+                            "0\r\nTrailer: x\r\n\r\n"
+                            "GET /next HTTP/1.1\r\n\r\n";
+    // 一次到达
+    {
+        HttpParser parser;
+        Buffer buffer;
+        buffer.append(raw);
+        ASSERT_EQ(parser.parse(buffer), HttpParser::kComplete);
+        EXPECT_EQ(parser.request().body(), "hello 0123456789");
+        parser.retrieveRequest(buffer);
+        ASSERT_EQ(parser.parse(buffer), HttpParser::kComplete);
+        EXPECT_EQ(parser.request().path(), "/next");
+    }
+    // 逐字节到达
+    {
+        HttpParser parser;
+        Buffer buffer(16);
+        int complete = 0;
+        for (char c : raw) {
+            buffer.append(&c, 1);
+            if (parser.parse(buffer) == HttpParser::kComplete) {
+                if (complete++ == 0) {
+                    EXPECT_EQ(parser.request().header("transfer-encoding"), "chunked");
+                    EXPECT_EQ(parser.request().body(), "hello 0123456789");
+                }
+                parser.retrieveRequest(buffer);
+            }
+        }
+        EXPECT_EQ(complete, 2);
+    }
+}
+
+// 测试长连接的判断：HTTP/1.1 默认保持，HTTP/1.0 需要 keep-alive
+TEST(HttpParserTest, KeepAlive) {
+    struct Case {
+        const char* raw;
+        bool keepAlive;
+    } cases[] = {
+        {"GET / HTTP/1.1\r\n\r\n", true},
+        {"GET / HTTP/1.1\r\nConnection: close\r\n\r\n", false},
+        {"GET / HTTP/1.1\r\nConnection: Upgrade, Close\r\n\r\n", false},
+        {"GET / HTTP/1.0\r\n\r\n", false},
+        {"GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", true},
+    };
+    for (const auto& c : cases) {
+        HttpParser parser;
+        Buffer buffer;
+        buffer.append(std::string(c.raw));
+        ASSERT_EQ(parser.parse(buffer), HttpParser::kComplete) << c.raw;
+        EXPECT_EQ(parser.request().keepAlive(), c.keepAlive) << c.raw;
+    }
+}
+
+// 测试非法请求返回对应的错误码
+TEST(HttpParserTest, Errors) {
+    struct Case {
+        std::string raw;
+        int status;
+    } cases[] = {
+        {"GARBAGE\r\n\r\n", 400},
+        {"GET / HTTP/2.0\r\n\r\n", 505},
+        {"GET / HTTP/1.1\r\nNoColon\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nName : v\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", 400},
+        {"POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n", 400},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", 501},
+        {"POST / HTTP/1.1\r\nContent-Length: 4096\r\n\r\n", 413},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 400},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n801\r\n", 413},
+        // 已有请求体之后块大小接近 UINT64_MAX，与已有长度相加会回绕
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\na\r\nFFFFFFFFFFFFFFFF\r\n", 413},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10000000000000000\r\n", 413},
+        {"GET / HTTP/1.1\r\nX: " + std::string(600, 'a') + "\r\n\r\n", 431},
+        {"GET / HTTP/1.1\r\nX: " + std::string(600, 'a'), 431},
+    };
+    for (const auto& c : cases) {
+        HttpParser parser(512, 2048);
+        Buffer buffer;
+        buffer.append(c.raw);
+        ASSERT_EQ(parser.parse(buffer), HttpParser::kError) << c.raw;
+        EXPECT_EQ(parser.errorStatus(), c.status) << c.raw;
+    }
+}
+
+// 测试应答的格式：状态行、公共头部、HTTP/1.0 长连接、HEAD 请求不带应答体
+TEST(HttpParserTest, Response) {
+    HttpParser parser;
+    Buffer input;
+    input.append(std::string("HEAD / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"));
+    ASSERT_EQ(parser.parse(input), HttpParser::kComplete);
+
+    Buffer output;
+    HttpResponse response(&output, parser.request());
+    response.setStatus(HttpResponse::k404NotFound);
+    response.setContentType("text/plain");
+    response.setBody("not found");
+    EXPECT_TRUE(response.finished());
+    std::string text = output.retrieveAllAsString();
+    EXPECT_EQ(text.rfind("HTTP/1.1 404 Not Found\r\nDate: ", 0), 0u);
+    EXPECT_NE(text.find("\r\nServer: KnetLib\r\n"), std::string::npos);
+    EXPECT_NE(text.find("\r\nContent-Type: text/plain\r\n"), std::string::npos);
+    EXPECT_NE(text.find("\r\nConnection: keep-alive\r\n"), std::string::npos);
+    EXPECT_NE(text.find("\r\nContent-Length: 9\r\n\r\n"), std::string::npos);
+    EXPECT_EQ(text.substr(text.size() - 4), "\r\n\r\n");
+
+    HttpResponse error(&output, HttpResponse::k400BadRequest);
+    error.finish();
+    text = output.retrieveAllAsString();
+    EXPECT_EQ(text.rfind("HTTP/1.1 400 Bad Request\r\n", 0), 0u);
+    EXPECT_NE(text.find("\r\nConnection: close\r\nContent-Length: 0\r\n\r\n"), std::string::npos);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "knetlib/HttpServer.h"
+#include "knetlib/EventLoop.h"
+#include "knetlib/InetAddress.h"
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+int connectLoopback(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", port);
+    for (int i = 0; i < 50; ++i) {
+        if (::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0) return fd;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(fd);
+    return -1;
+}
+
+bool writeAll(int fd, const std::string& data) {
+    return ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+}
+
+// 读到对端关闭为止
+std::string readUntilClose(int fd) {
+    std::string result;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        result.append(buf, static_cast<size_t>(n));
+    }
+    return result;
+}
+
+size_t count(const std::string& text, const std::string& pattern) {
+    size_t n = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+class HttpServerTest : public ::testing::Test {
+protected:
+    // ctest 会并行运行各个用例，SO_REUSEPORT 下同一端口会在进程间分流，每个用例使用不同的端口
+    void start(uint16_t port) {
+        server = std::make_unique<HttpServer>(&loop, InetAddress(port, true));
+        server->setNumThread(1);
+        server->tcpServer().setReusePort(true);  // 工作线程自己 accept，主线程的 loop 不运行
+        server->setMaxBodySize(1024);
+        // 回显路径和请求体
+        server->setHttpCallback([](const HttpRequest& request, HttpResponse& response) {
+            if (request.path() == "/missing") {
+                response.setStatus(HttpResponse::k404NotFound);
+                return;
+            }
+            response.setContentType("text/plain");
+            response.addHeader("X-Path", request.path());
+            response.setBody(request.body());
+        });
+        server->start();
+    }
+
+    EventLoop loop;
+    std::unique_ptr<HttpServer> server;
+};
+
+} // anonymous namespace
+
+// 测试长连接上的流水线请求按顺序应答，最后的 Connection: close 请求应答后关闭连接
+TEST_F(HttpServerTest, PipelinedKeepAlive) {
+    const uint16_t port = 19516;
+    start(port);
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    std::string requests;
+    for (int i = 0; i < 10; ++i) {
+        requests += "GET /p" + std::to_string(i) + " HTTP/1.1\r\nHost: x\r\n\r\n";
+    }
+    requests += "GET /missing HTTP/1.1\r\n\r\n";
+    requests += "POST /last HTTP/1.1\r\nConnection: close\r\nContent-Length: 4\r\n\r\ndone";
+    ASSERT_TRUE(writeAll(fd, requests));
+    std::string response = readUntilClose(fd);
+    ::close(fd);
+
+    EXPECT_EQ(count(response, "HTTP/1.1 200 OK\r\n"), 11u);
+    EXPECT_EQ(count(response, "HTTP/1.1 404 Not Found\r\n"), 1u);
+    size_t last = 0;
+    for (int i = 0; i < 10; ++i) {
+        size_t pos = response.find("X-Path: /p" + std::to_string(i) + "\r\n");
+        ASSERT_NE(pos, std::string::npos);
+        EXPECT_GT(pos, last);
+        last = pos;
+    }
+    EXPECT_NE(response.find("X-Path: /last\r\nConnection: close\r\nContent-Length: 4\r\n\r\ndone"),
+              std::string::npos);
+}
+
+// 测试分多次到达的 chunked 请求体
+TEST_F(HttpServerTest, ChunkedRequest) {
+    const uint16_t port = 19517;
+    start(port);
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(writeAll(fd, "POST /chunked HTTP/1.1\r\nConnection: close\r\n"
+                             "Transfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(writeAll(fd, "4\r\ndefg\r\n0\r\n\r\n"));
+    std::string response = readUntilClose(fd);
+    ::close(fd);
+    EXPECT_NE(response.find("Content-Length: 7\r\n\r\nabcdefg"), std::string::npos);
+}
+
+// 测试无法解析或超过上限的请求回复错误码并关闭连接
+TEST_F(HttpServerTest, BadRequest) {
+    const uint16_t port = 19518;
+    start(port);
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(writeAll(fd, "GET / HTTP/1.1\r\n\r\nPOST / HTTP/1.1\r\nContent-Length: 4096\r\n\r\n"));
+    std::string response = readUntilClose(fd);
+    ::close(fd);
+    EXPECT_EQ(response.find("HTTP/1.1 200 OK\r\n"), 0u);
+    EXPECT_NE(response.find("HTTP/1.1 413 Payload Too Large\r\n"), std::string::npos);
+    EXPECT_NE(response.find("Connection: close\r\n"), std::string::npos);
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "knetlib/InplaceTask.h"
+#include "knetlib/Callbacks.h"
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+
+// 测试默认构造和空的 std::function 都得到空任务
+TEST(InplaceTaskTest, Empty) {
+    Task task;
+    EXPECT_FALSE(task);
+
+    std::function<void()> empty;
+    Task fromEmpty(empty);
+    EXPECT_FALSE(fromEmpty);
+
+    Task fromNull(nullptr);
+    EXPECT_FALSE(fromNull);
+}
+
+// 测试捕获 shared_ptr 和 string 的典型闭包存放在对象内部
+TEST(InplaceTaskTest, TypicalClosureStoredInline) {
+    auto ptr = std::make_shared<int>(0);
+    std::string str = "hello";
+    Task task([ptr, str]() { *ptr += static_cast<int>(str.size()); });
+    EXPECT_TRUE(task.storedInline());
+
+    task();
+    EXPECT_EQ(*ptr, 5);
+}
+
+// 测试超过内联容量的闭包退化为堆分配，仍然可以正常调用和移动
+TEST(InplaceTaskTest, LargeClosureOnHeap) {
+    std::array<char, 128> big{};
+    big[0] = 'x';
+    char seen = 0;
+    Task task([big, &seen]() { seen = big[0]; });
+    EXPECT_FALSE(task.storedInline());
+
+    Task moved(std::move(task));
+    EXPECT_FALSE(task);
+    moved();
+    EXPECT_EQ(seen, 'x');
+}
+
+// 测试可以捕获只能移动的对象，移动后原对象为空，捕获的对象只被释放一次
+TEST(InplaceTaskTest, MoveOnlyCapture) {
+    auto ptr = std::make_shared<int>(42);
+    std::weak_ptr<int> weak = ptr;
+    auto owner = std::make_unique<std::shared_ptr<int>>(std::move(ptr));
+    int value = 0;
+
+    Task task([owner = std::move(owner), &value]() { value = **owner; });
+    Task other;
+    other = std::move(task);
+    EXPECT_FALSE(task);
+    ASSERT_TRUE(other);
+
+    other();
+    EXPECT_EQ(value, 42);
+    EXPECT_FALSE(weak.expired());
+
+    other = nullptr;
+    EXPECT_TRUE(weak.expired());
+}
+
+// 测试带参数和返回值的签名
+TEST(InplaceTaskTest, ArgumentsAndResult) {
+    InplaceTask<int(int, int), 32> add([](int a, int b) { return a + b; });
+    EXPECT_EQ(add(2, 3), 5);
+
+    int (*fn)(int, int) = [](int a, int b) { return a * b; };
+    InplaceTask<int(int, int), 32> mul(fn);
+    EXPECT_EQ(mul(2, 3), 6);
+}
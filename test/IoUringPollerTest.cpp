@@ -0,0 +1,355 @@
+#include <gtest/gtest.h>
+#include "knetlib/IoUringPoller.h"
+#include "knetlib/EventLoop.h"
+#include "knetlib/Channel.h"
+#include "knetlib/TcpServer.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/InetAddress.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IoUringPollerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        loop = new EventLoop(PollerBackend::kIoUring);
+        int pipefd[2];
+        ASSERT_EQ(pipe(pipefd), 0) << "Failed to create pipe";
+        readFd = pipefd[0];
+        writeFd = pipefd[1];
+    }
+
+    void TearDown() override {
+        close(readFd);
+        close(writeFd);
+        delete loop;
+    }
+
+    EventLoop* loop;
+    int readFd;
+    int writeFd;
+};
+
+// 测试内核支持时能创建 io_uring 后端，不支持时返回 nullptr 而不是崩溃
+TEST_F(IoUringPollerTest, Create) {
+    auto poller = IoUringPoller::create(loop);
+    if (!poller) {
+        GTEST_SKIP() << "io_uring 不可用";
+    }
+    Poller::ChannelList activeChannels;
+    poller->poll(activeChannels, 0);
+    EXPECT_TRUE(activeChannels.empty());
+}
+
+// 测试水平触发：一次写入 3 个字节，每次回调只读 1 个字节，应收到 3 次可读事件
+TEST_F(IoUringPollerTest, LevelTriggered) {
+    Channel channel(loop, readFd);
+    int reads = 0;
+    channel.setReadCallback([&]() {
+        char byte;
+        ASSERT_EQ(::read(readFd, &byte, 1), 1);
+        if (++reads == 3) {
+            channel.disableAll();
+            loop->quit();
+        }
+    });
+    channel.enableRead();
+    ASSERT_EQ(::write(writeFd, "abc", 3), 3);
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(reads, 3);
+    EXPECT_FALSE(channel.pooling);
+}
+
+// 测试修改监听：关闭写事件后不再收到可写事件，之后打开读事件仍能收到数据
+TEST_F(IoUringPollerTest, ModifyInterest) {
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    Channel channel(loop, sv[0]);
+    int writes = 0;
+    int reads = 0;
+    channel.setWriteCallback([&]() {
+        ++writes;
+        channel.disableWrite();
+        channel.enableRead();
+        ASSERT_EQ(::write(sv[1], "x", 1), 1);
+    });
+    channel.setReadCallback([&]() {
+        char byte;
+        ASSERT_EQ(::read(sv[0], &byte, 1), 1);
+        ++reads;
+        loop->runAfter(std::chrono::milliseconds(50), [this]() { loop->quit(); });
+    });
+    channel.enableWrite();
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(writes, 1);
+    EXPECT_EQ(reads, 1);
+    channel.disableAll();
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+// 测试定时器和跨线程唤醒在 io_uring 后端上正常工作
+TEST_F(IoUringPollerTest, TimerAndWakeup) {
+    std::atomic<bool> timerFired(false);
+    std::atomic<bool> taskRun(false);
+    loop->runAfter(std::chrono::milliseconds(20), [&]() { timerFired = true; });
+    std::thread other([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        loop->queueInLoop([&]() {
+            taskRun = true;
+            loop->quit();
+        });
+    });
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+    other.join();
+
+    EXPECT_TRUE(timerFired.load());
+    EXPECT_TRUE(taskRun.load());
+}
+
+// 测试工作线程使用 io_uring 后端的 TcpServer 能正常 accept 和回显
+TEST_F(IoUringPollerTest, TcpServerEcho) {
+    const uint16_t port = 19513;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(2);
+    server.setReusePort(true);
+    server.setPollerBackend(PollerBackend::kIoUring);
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buffer) {
+        conn->send(buffer.retrieveAllAsString());
+    });
+    server.start();
+
+    for (int i = 0; i < 8; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        InetAddress addr("127.0.0.1", port);
+        bool connected = false;
+        for (int retry = 0; retry < 50 && !connected; ++retry) {
+            connected = ::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0;
+            if (!connected) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_TRUE(connected);
+        const std::string message = "ping" + std::to_string(i);
+        ASSERT_EQ(::write(fd, message.data(), message.size()), static_cast<ssize_t>(message.size()));
+        std::string reply;
+        char buf[64];
+        while (reply.size() < message.size()) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            ASSERT_GT(n, 0);
+            reply.append(buf, static_cast<size_t>(n));
+        }
+        EXPECT_EQ(reply, message);
+        ::close(fd);
+    }
+}
+
+// 测试多次触发的 recv：一个请求收到多次数据，数据来自接收缓冲区组；取消后以 -ECANCELED 结束
+TEST_F(IoUringPollerTest, MultishotRecv) {
+    IoUringPoller* ring = loop->completionPoller();
+    if (ring == nullptr) {
+        GTEST_SKIP() << "内核不支持基于完成事件的收发";
+    }
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    std::string received;
+    int completions = 0;
+    int finalRes = 0;
+    bool ended = false;
+    uint64_t id = ring->recvMultishot(sv[0], [&](const char* data, int res, bool more) {
+        ++completions;
+        if (res > 0) {
+            received.append(data, static_cast<size_t>(res));
+        }
+        if (!more) {
+            ended = true;
+            finalRes = res;
+            loop->quit();
+        }
+        else if (received == "helloworld") {
+            ring->cancel(id);
+        }
+    });
+    ASSERT_EQ(::write(sv[1], "hello", 5), 5);
+    loop->runAfter(std::chrono::milliseconds(20), [&]() { ASSERT_EQ(::write(sv[1], "world", 5), 5); });
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(received, "helloworld");
+    EXPECT_GE(completions, 3);
+    EXPECT_TRUE(ended);
+    EXPECT_EQ(finalRes, -ECANCELED);
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+// 测试多次触发的 accept：一个请求接受多个连接，取消后以 -ECANCELED 结束
+TEST_F(IoUringPollerTest, MultishotAccept) {
+    IoUringPoller* ring = loop->completionPoller();
+    if (ring == nullptr) {
+        GTEST_SKIP() << "内核不支持基于完成事件的收发";
+    }
+    const uint16_t port = 19521;
+    int listenfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ASSERT_GE(listenfd, 0);
+    int on = 1;
+    ::setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    InetAddress addr("127.0.0.1", port);
+    ASSERT_EQ(::bind(listenfd, addr.getSockaddr(), addr.getSocklen()), 0);
+    ASSERT_EQ(::listen(listenfd, 16), 0);
+
+    std::vector<int> accepted;
+    int finalRes = 0;
+    bool ended = false;
+    uint64_t id = ring->acceptMultishot(listenfd, [&](int res, bool more) {
+        if (res >= 0) {
+            accepted.push_back(res);
+            if (accepted.size() == 3) {
+                ring->cancel(id);
+            }
+        }
+        if (!more) {
+            ended = true;
+            finalRes = res;
+            loop->quit();
+        }
+    });
+    std::vector<int> clients;
+    for (int i = 0; i < 3; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_EQ(::connect(fd, addr.getSockaddr(), addr.getSocklen()), 0);
+        clients.push_back(fd);
+    }
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(accepted.size(), 3u);
+    EXPECT_TRUE(ended);
+    EXPECT_EQ(finalRes, -ECANCELED);
+    for (int fd : accepted) ::close(fd);
+    for (int fd : clients) ::close(fd);
+    ::close(listenfd);
+}
+
+// 测试 send 请求：多段 iovec 一次发出，回调收到发出的总字节数
+TEST_F(IoUringPollerTest, SendCompletion) {
+    IoUringPoller* ring = loop->completionPoller();
+    if (ring == nullptr) {
+        GTEST_SKIP() << "内核不支持基于完成事件的收发";
+    }
+    int sv[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    char head[] = "head-";
+    char body[] = "body";
+    iovec iov[2];
+    iov[0].iov_base = head;
+    iov[0].iov_len = 5;
+    iov[1].iov_base = body;
+    iov[1].iov_len = 4;
+    int sent = 0;
+    ring->send(sv[0], iov, 2, [&](int res) {
+        sent = res;
+        loop->quit();
+    });
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(sent, 9);
+    char buf[16];
+    ASSERT_EQ(::read(sv[1], buf, sizeof(buf)), 9);
+    EXPECT_EQ(std::string(buf, 9), "head-body");
+    EXPECT_GE(ring->completionRequests(), 1u);
+    EXPECT_GE(ring->completionEvents(), 1u);
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+// 测试完成模式下的 TcpServer：大块数据分多个接收缓冲区回显完整，
+// 文件区间和前后的普通数据、shutdown 仍按调用顺序发出
+TEST_F(IoUringPollerTest, TcpServerLargeEchoAndSendFile) {
+    if (loop->completionPoller() == nullptr) {
+        GTEST_SKIP() << "内核不支持基于完成事件的收发";
+    }
+    const uint16_t port = 19522;
+    const std::string fileContent(100000, 'f');
+    char path[] = "/tmp/knetlib_uring_XXXXXX";
+    int filefd = ::mkstemp(path);
+    ASSERT_GE(filefd, 0);
+    ::unlink(path);
+    ASSERT_EQ(::write(filefd, fileContent.data(), fileContent.size()), static_cast<ssize_t>(fileContent.size()));
+
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(2);
+    server.setReusePort(true);
+    server.setPollerBackend(PollerBackend::kIoUring);
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buffer) {
+        std::string data = buffer.retrieveAllAsString();
+        if (data == "file") {
+            conn->send("HEAD");
+            conn->sendFile(filefd, 0, fileContent.size());
+            conn->send("TAIL");
+            conn->shutdown();
+        }
+        else {
+            conn->send(data);
+        }
+    });
+    server.start();
+
+    auto connectTo = [&]() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        InetAddress addr("127.0.0.1", port);
+        for (int retry = 0; retry < 50; ++retry) {
+            if (::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0) return fd;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ::close(fd);
+        return -1;
+    };
+
+    // 1MB 超过全部接收缓冲区的容量，写和读并发进行
+    const std::string message(1 << 20, 'x');
+    int fd = connectTo();
+    ASSERT_GE(fd, 0);
+    std::thread writer([&]() {
+        size_t written = 0;
+        while (written < message.size()) {
+            ssize_t n = ::write(fd, message.data() + written, message.size() - written);
+            if (n <= 0) break;
+            written += static_cast<size_t>(n);
+        }
+    });
+    std::string reply;
+    std::vector<char> buf(65536);
+    while (reply.size() < message.size()) {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0) break;
+        reply.append(buf.data(), static_cast<size_t>(n));
+    }
+    writer.join();
+    EXPECT_EQ(reply.size(), message.size());
+    EXPECT_TRUE(reply == message);
+    ::close(fd);
+
+    fd = connectTo();
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, "file", 4), 4);
+    reply.clear();
+    for (;;) {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0) break;
+        reply.append(buf.data(), static_cast<size_t>(n));
+    }
+    EXPECT_EQ(reply, "HEAD" + fileContent + "TAIL");
+    ::close(fd);
+    ::close(filefd);
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include "knetlib/LengthFieldCodec.h"
+#include "knetlib/TcpServer.h"
+#include "knetlib/TcpConnection.h"
+#include "knetlib/EventLoop.h"
+#include "knetlib/InetAddress.h"
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// 解码时不需要真实连接，出错路径在 conn 为空时只丢弃数据
+const TcpConnectionPtr kNoConn;
+
+std::string frame(const std::string& lengthField, const std::string& payload) {
+    return lengthField + payload;
+}
+
+int connectLoopback(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", port);
+    for (int i = 0; i < 50; ++i) {
+        if (::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0) return fd;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(fd);
+    return -1;
+}
+
+bool readFull(int fd, char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+// 测试一个缓冲区中的多个完整帧依次交付，负载指向输入缓冲区
+TEST(LengthFieldCodecTest, MultipleFrames) {
+    std::vector<std::string> frames;
+    Buffer buffer;
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    LengthFieldCodec codec([&](const TcpConnectionPtr&, std::string_view payload) {
+        EXPECT_GE(payload.data(), begin);
+        EXPECT_LE(payload.data() + payload.size(), end);
+        frames.emplace_back(payload);
+    });
+    buffer.append(frame(std::string("\0\0\0\5", 4), "hello"));
+    buffer.append(frame(std::string("\0\0\0\0", 4), ""));
+    buffer.append(frame(std::string("\0\0\0\3", 4), "abc"));
+    begin = buffer.peek();
+    end = begin + buffer.readableBytes();
+    codec.onMessage(kNoConn, buffer);
+
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0], "hello");
+    EXPECT_EQ(frames[1], "");
+    EXPECT_EQ(frames[2], "abc");
+    EXPECT_EQ(buffer.readableBytes(), 0u);
+}
+
+// 测试帧头和负载被拆成多次到达时，收齐后才交付
+TEST(LengthFieldCodecTest, PartialFrame) {
+    std::vector<std::string> frames;
+    LengthFieldCodec codec([&](const TcpConnectionPtr&, std::string_view payload) {
+        frames.emplace_back(payload);
+    }, 2);
+    const std::string data = frame(std::string("\0\x0a", 2), "0123456789") + std::string("\0", 1);
+    Buffer buffer;
+    for (char c : data) {
+        buffer.append(&c, 1);
+        codec.onMessage(kNoConn, buffer);
+    }
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(frames[0], "0123456789");
+    // 下一帧的长度字段只到了一半，留在缓冲区里
+    EXPECT_EQ(buffer.readableBytes(), 1u);
+}
+
+// 测试只收到大帧的帧头时，输入缓冲区不会按帧长一次扩容到位
+TEST(LengthFieldCodecTest, PartialFrameReserveCapped) {
+    int frames = 0;
+    LengthFieldCodec codec([&](const TcpConnectionPtr&, std::string_view) { ++frames; });
+    Buffer buffer;
+    // 帧长 4MB，正好是默认上限
+    buffer.append(std::string("\0\x40\0\0", 4));
+    codec.onMessage(kNoConn, buffer);
+    EXPECT_EQ(frames, 0);
+    EXPECT_EQ(buffer.readableBytes(), 4u);
+    EXPECT_GE(buffer.writableBytes(), 1024u);
+    EXPECT_LE(buffer.writableBytes(), 2 * LengthFieldCodec::kMaxReserveBytes);
+}
+
+// 测试 1/2/4/8 字节、大端与小端的长度字段经过编码再解码保持不变
+TEST(LengthFieldCodecTest, FieldSizesAndByteOrder) {
+    for (int size : {1, 2, 4, 8}) {
+        for (auto order : {LengthFieldCodec::kBigEndian, LengthFieldCodec::kLittleEndian}) {
+            std::string received;
+            LengthFieldCodec codec([&](const TcpConnectionPtr&, std::string_view payload) {
+                received.assign(payload);
+            }, size, order);
+            std::string payload(200, 'x');
+            Buffer buffer;
+            // 按协议手工写出长度字段
+            uint64_t length = payload.size();
+            std::string field(static_cast<size_t>(size), '\0');
+            for (int i = 0; i < size; ++i) {
+                int index = order == LengthFieldCodec::kBigEndian ? size - 1 - i : i;
+                field[static_cast<size_t>(index)] = static_cast<char>(length & 0xff);
+                length >>= 8;
+            }
+            buffer.append(field + payload);
+            codec.onMessage(kNoConn, buffer);
+            EXPECT_EQ(received, payload) << "size=" << size << " order=" << order;
+            EXPECT_EQ(codec.headerLength(), static_cast<size_t>(size));
+        }
+    }
+}
+
+// 测试长度字段前的前缀原样保留，可以在回调中取得
+TEST(LengthFieldCodecTest, LengthFieldOffset) {
+    std::string prefix;
+    std::string payload;
+    LengthFieldCodec* self = nullptr;
+    LengthFieldCodec codec([&](const TcpConnectionPtr&, std::string_view frame) {
+        prefix.assign(self->prefix(frame));
+        payload.assign(frame);
+    }, 2, LengthFieldCodec::kLittleEndian, LengthFieldCodec::kDefaultMaxFrameSize, 3);
+    self = &codec;
+    Buffer buffer;
+    buffer.append(std::string("KN\x01") + std::string("\x04\0", 2) + "data");
+    codec.onMessage(kNoConn, buffer);
+    EXPECT_EQ(prefix, "KN\x01");
+    EXPECT_EQ(payload, "data");
+    EXPECT_EQ(codec.headerLength(), 5u);
+}
+
+// 测试超过上限的帧被当作协议错误，缓冲区中的数据被丢弃，不交付
+TEST(LengthFieldCodecTest, OversizeFrame) {
+    int frames = 0;
+    LengthFieldCodec codec([&](const TcpConnectionPtr&, std::string_view) {
+        frames++;
+    }, 4, LengthFieldCodec::kBigEndian, 16);
+    Buffer buffer;
+    buffer.append(frame(std::string("\0\0\0\x10", 4), std::string(16, 'a')));
+    buffer.append(frame(std::string("\0\0\0\x11", 4), std::string(17, 'b')));
+    codec.onMessage(kNoConn, buffer);
+    EXPECT_EQ(frames, 1);
+    EXPECT_EQ(buffer.readableBytes(), 0u);
+}
+
+// 测试通过 TcpServer 收发：服务端把每帧原样回显，Buffer 发送时帧头写在预留空间里
+TEST(LengthFieldCodecTest, TcpServerEcho) {
+    const uint16_t port = 19515;
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setReusePort(true);  // 工作线程自己 accept，主线程的 loop 不运行
+    LengthFieldCodec* codecPtr = nullptr;
+    LengthFieldCodec codec([&codecPtr](const TcpConnectionPtr& conn, std::string_view payload) {
+        if (payload.size() % 2 == 0) {
+            Buffer reply;
+            reply.append(payload.data(), payload.size());
+            codecPtr->send(conn, reply);
+        }
+        else {
+            codecPtr->send(conn, payload);
+        }
+    }, 4, LengthFieldCodec::kBigEndian, 1024 * 1024);
+    codecPtr = &codec;
+    server.setMessageCallback([&codec](const TcpConnectionPtr& conn, Buffer& buffer) {
+        codec.onMessage(conn, buffer);
+    });
+    server.start();
+
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    std::string request;
+    std::vector<std::string> payloads = {"a", "bb", std::string(100000, 'c'), std::string(3, 'd')};
+    for (const auto& payload : payloads) {
+        uint32_t be = htobe32(static_cast<uint32_t>(payload.size()));
+        request.append(reinterpret_cast<const char*>(&be), sizeof be);
+        request.append(payload);
+    }
+    ASSERT_EQ(::write(fd, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+    std::string response(request.size(), '\0');
+    ASSERT_TRUE(readFull(fd, response.data(), response.size()));
+    EXPECT_EQ(response, request);
+
+    // 超长帧：服务端关闭连接
+    uint32_t be = htobe32(2 * 1024 * 1024);
+    ASSERT_EQ(::write(fd, &be, sizeof be), static_cast<ssize_t>(sizeof be));
+    char c;
+    EXPECT_EQ(::read(fd, &c, 1), 0);
+    ::close(fd);
+}
@@ -2,10 +2,12 @@
 #include "knetlib/TcpConnection.h"
 #include "knetlib/EventLoop.h"
 #include "knetlib/InetAddress.h"
+#include "knetlib/IdleTimeoutWheel.h"
 #include <sys/socket.h>
 #include <unistd.h>
 #include <atomic>
 #include <thread>
+#include <vector>
 
 class TcpConnectionTest : public ::testing::Test {
 protected:
@@ -109,7 +111,7 @@ TEST_F(TcpConnectionTest, LocalAndPeer) {
 // 测试 inputBuffer 和 outputBuffer
 TEST_F(TcpConnectionTest, Buffers) {
     const Buffer& input = connection->inputBuffer();
-    const Buffer& output = connection->outputBuffer();
+    const ChainBuffer& output = connection->outputBuffer();
     
     EXPECT_EQ(input.readableBytes(), 0);
     EXPECT_EQ(output.readableBytes(), 0);
@@ -141,3 +143,396 @@ TEST_F(TcpConnectionTest, Context) {
     EXPECT_TRUE(mutableCtx.has_value());
 }
 
+
+// 测试多段发送：头部和负载通过一次 writev 发出
+TEST(TcpConnectionSendTest, MultiPartSend) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    auto conn = std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress());
+    conn->connectEstablished();
+
+    std::string header = "HDR:";
+    std::string body = "payload";
+    struct iovec parts[2] = {{header.data(), header.size()}, {body.data(), body.size()}};
+    conn->send(std::span<const struct iovec>(parts, 2));
+    EXPECT_EQ(conn->outputBuffer().readableBytes(), 0);
+
+    char buf[64];
+    ssize_t n = read(fds[1], buf, sizeof buf);
+    ASSERT_GT(n, 0);
+    EXPECT_EQ(std::string(buf, static_cast<size_t>(n)), "HDR:payload");
+
+    conn->forceClose();
+    close(fds[1]);
+}
+
+// 测试多段发送写不完时剩余部分进入 outputBuffer_，并在可写时通过 writev 发完
+TEST(TcpConnectionSendTest, MultiPartSendQueued) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    auto conn = std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress());
+    conn->setWriteCompleteCallback([&loop](const TcpConnectionPtr&) { loop.quit(); });
+    conn->connectEstablished();
+
+    std::string header(16, 'h');
+    std::string body(4 * 1024 * 1024, 'b');
+    struct iovec parts[2] = {{header.data(), header.size()}, {body.data(), body.size()}};
+    conn->send(std::span<const struct iovec>(parts, 2));
+    EXPECT_GT(conn->outputBuffer().readableBytes(), 0);
+
+    std::string received;
+    std::atomic<bool> done(false);
+    std::thread reader([&]() {
+        char buf[65536];
+        while (received.size() < header.size() + body.size()) {
+            ssize_t n = read(fds[1], buf, sizeof buf);
+            if (n > 0) received.append(buf, static_cast<size_t>(n));
+            else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        done = true;
+    });
+    loop.loop();
+    reader.join();
+
+    EXPECT_TRUE(done.load());
+    EXPECT_EQ(conn->outputBuffer().readableBytes(), 0);
+    EXPECT_EQ(received, header + body);
+
+    conn->forceClose();
+    close(fds[1]);
+}
+
+namespace {
+
+// 创建内容为 content 的临时文件，返回文件 fd
+int makeTempFile(const std::string& content) {
+    char path[] = "/tmp/knetlib_sendfile_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) return -1;
+    unlink(path);
+    if (write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // anonymous namespace
+
+// 测试 sendFile：文件区间与普通数据按调用顺序发出
+TEST(TcpConnectionSendTest, SendFileInOrder) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    auto conn = std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress());
+    conn->connectEstablished();
+
+    int filefd = makeTempFile("0123456789abcdef");
+    ASSERT_NE(filefd, -1);
+    conn->send("HEAD");
+    conn->sendFile(filefd, 2, 10);
+    close(filefd);  // sendFile 内部持有 dup 出的 fd
+    conn->send("TAIL");
+
+    std::string received;
+    char buf[64];
+    while (received.size() < 18) {
+        ssize_t n = read(fds[1], buf, sizeof buf);
+        ASSERT_GT(n, 0);
+        received.append(buf, static_cast<size_t>(n));
+    }
+    EXPECT_EQ(received, "HEAD23456789abTAIL");
+
+    conn->forceClose();
+    close(fds[1]);
+}
+
+// 测试 sendFile 排在未发完的数据之后，全部发完后才触发写完成回调
+TEST(TcpConnectionSendTest, SendFileQueued) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    auto conn = std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress());
+    std::atomic<int> writeCompleteCount(0);
+    conn->setWriteCompleteCallback([&](const TcpConnectionPtr&) {
+        writeCompleteCount++;
+        loop.quit();
+    });
+    size_t highWaterLen = 0;
+    conn->setHighWaterMarkCallback([&](const TcpConnectionPtr&, size_t len) { highWaterLen = len; },
+                                   5 * 1024 * 1024);
+    conn->connectEstablished();
+
+    std::string head(4 * 1024 * 1024, 'h');
+    std::string fileContent(2 * 1024 * 1024, 'f');
+    int filefd = makeTempFile(fileContent);
+    ASSERT_NE(filefd, -1);
+
+    conn->send(head);
+    conn->sendFile(filefd, 0, fileContent.size());
+    close(filefd);
+    conn->send("TAIL");
+    EXPECT_GT(conn->outputBuffer().readableBytes(), 0);
+
+    const std::string expected = head + fileContent + "TAIL";
+    std::string received;
+    std::thread reader([&]() {
+        char buf[65536];
+        while (received.size() < expected.size()) {
+            ssize_t n = read(fds[1], buf, sizeof buf);
+            if (n > 0) received.append(buf, static_cast<size_t>(n));
+            else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    loop.loop();
+    reader.join();
+
+    EXPECT_EQ(writeCompleteCount.load(), 1);
+    EXPECT_GE(highWaterLen, 5 * 1024 * 1024u);
+    EXPECT_TRUE(received == expected);
+
+    conn->forceClose();
+    close(fds[1]);
+}
+
+// 测试排队的文件区间在发送前被截短：不能把缺少的字节当作已发送，连接被关闭，之后的数据不再发出
+TEST(TcpConnectionSendTest, SendFileTruncated) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    auto conn = std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress());
+    std::atomic<bool> closed(false);
+    conn->setCloseCallback([&](const TcpConnectionPtr&) {
+        closed = true;
+        loop.quit();
+    });
+    conn->connectEstablished();
+
+    std::string head(4 * 1024 * 1024, 'h');
+    std::string fileContent(1024 * 1024, 'f');
+    int filefd = makeTempFile(fileContent);
+    ASSERT_NE(filefd, -1);
+
+    conn->send(head);
+    conn->sendFile(filefd, 0, fileContent.size());
+    conn->send("TAIL");
+    ASSERT_GT(conn->outputBuffer().readableBytes(), 0);
+    // 文件区间还在排队，此时把文件截短
+    ASSERT_EQ(ftruncate(filefd, 1000), 0);
+    close(filefd);
+
+    // 读到连接关闭为止
+    std::string received;
+    std::thread reader([&]() {
+        char buf[65536];
+        for (;;) {
+            ssize_t n = read(fds[1], buf, sizeof buf);
+            if (n > 0) received.append(buf, static_cast<size_t>(n));
+            else if (n == -1 && errno == EAGAIN) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            else break;
+        }
+    });
+    loop.loop();
+    EXPECT_TRUE(closed.load());
+    EXPECT_TRUE(conn->disconnected());
+    conn.reset();  // 析构时关闭 socket，读线程读到 EOF
+    reader.join();
+
+    EXPECT_TRUE(received == head + fileContent.substr(0, 1000));
+    EXPECT_EQ(received.find("TAIL"), std::string::npos);
+    close(fds[1]);
+}
+
+// 测试多个线程并发 send：数据经无锁队列批量交给 loop 线程，每个生产者的消息保持顺序
+TEST(TcpConnectionSendTest, CrossThreadSend) {
+    const int kProducers = 4;
+    const int kMessages = 2000;
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    EventLoop* loop = nullptr;
+    TcpConnectionPtr conn;
+    std::atomic<bool> ready(false);
+    std::thread loopThread([&]() {
+        EventLoop threadLoop;
+        loop = &threadLoop;
+        conn = std::make_shared<TcpConnection>(&threadLoop, fds[0], InetAddress(), InetAddress());
+        conn->connectEstablished();
+        ready = true;
+        threadLoop.loop();
+        conn->forceClose();
+        conn.reset();
+    });
+    while (!ready.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&conn, p]() {
+            for (int i = 0; i < kMessages; ++i) {
+                // 每条消息 8 字节：生产者编号 + 序号
+                std::string msg(8, '\0');
+                snprintf(msg.data(), 9, "%d%07d", p, i);
+                if (i % 2 == 0) conn->send(std::move(msg));
+                else conn->send(msg.data(), msg.size());
+            }
+        });
+    }
+
+    std::string received;
+    const size_t total = static_cast<size_t>(kProducers) * kMessages * 8;
+    char buf[65536];
+    while (received.size() < total) {
+        ssize_t n = read(fds[1], buf, sizeof buf);
+        ASSERT_GT(n, 0);
+        received.append(buf, static_cast<size_t>(n));
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    std::vector<int> next(kProducers, 0);
+    for (size_t off = 0; off < received.size(); off += 8) {
+        int p = received[off] - '0';
+        ASSERT_GE(p, 0);
+        ASSERT_LT(p, kProducers);
+        EXPECT_EQ(std::stoi(received.substr(off + 1, 7)), next[p]);
+        ++next[p];
+    }
+
+    loop->quit();
+    loopThread.join();
+    close(fds[1]);
+}
+
+// 测试跨线程的 send、sendFile、shutdown 按调用顺序生效：文件区间不被之后的数据越过，写端在数据全部发出后才关闭
+TEST(TcpConnectionSendTest, CrossThreadSendFileAndShutdown) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int filefd = makeTempFile("0123456789abcdef");
+    ASSERT_NE(filefd, -1);
+
+    EventLoop* loop = nullptr;
+    TcpConnectionPtr conn;
+    std::atomic<bool> ready(false);
+    std::thread loopThread([&]() {
+        EventLoop threadLoop;
+        loop = &threadLoop;
+        conn = std::make_shared<TcpConnection>(&threadLoop, fds[0], InetAddress(), InetAddress());
+        conn->connectEstablished();
+        ready = true;
+        threadLoop.loop();
+        conn->forceClose();
+        conn.reset();
+    });
+    while (!ready.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    conn->send("HEAD");
+    conn->sendFile(filefd, 2, 10);
+    close(filefd);
+    conn->send("TAIL");
+    conn->shutdown();
+
+    // 读到 EOF 说明写端已经关闭，此前收到的就是全部数据
+    std::string received;
+    char buf[64];
+    ssize_t n;
+    while ((n = read(fds[1], buf, sizeof buf)) > 0) {
+        received.append(buf, static_cast<size_t>(n));
+    }
+    EXPECT_EQ(n, 0);
+    EXPECT_EQ(received, "HEAD23456789abTAIL");
+
+    loop->quit();
+    loopThread.join();
+    close(fds[1]);
+}
+
+// 测试在 MessageCallback 中关闭连接：回调仍持有的输入缓冲区不被清空，回调返回之后才释放
+TEST(TcpConnectionReadTest, CloseInMessageCallback) {
+    EventLoop loop;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    auto conn = std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress());
+    size_t readableAfterClose = 0;
+    std::string frame;
+    conn->setMessageCallback([&](const TcpConnectionPtr& c, Buffer& buffer) {
+        c->forceClose();
+        readableAfterClose = buffer.readableBytes();
+        frame = buffer.retrieveAsString(5);
+        loop.queueInLoop([&loop]() { loop.quit(); });
+    });
+    conn->connectEstablished();
+    ASSERT_EQ(write(fds[1], "hello world", 11), 11);
+    loop.runAfter(std::chrono::seconds(2), [&loop]() { loop.quit(); });
+    loop.loop();
+
+    EXPECT_TRUE(conn->disconnected());
+    EXPECT_EQ(readableAfterClose, 11u);
+    EXPECT_EQ(frame, "hello");
+    EXPECT_EQ(conn->inputBuffer().capacity(), 0u);
+    close(fds[1]);
+}
+
+// 测试空闲超时：同一个桶里的连接在关闭回调中关闭另一个连接，每个连接只被摘下一次，计数回到 0
+TEST(TcpConnectionIdleTest, CloseSiblingFromCloseCallback) {
+    EventLoop loop;
+    IdleTimeoutWheel wheel(&loop, std::chrono::milliseconds(16));
+    std::vector<TcpConnectionPtr> conns;
+    std::vector<int> peers;
+    int closed = 0;
+    for (int i = 0; i < 3; ++i) {
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+        conns.push_back(std::make_shared<TcpConnection>(&loop, fds[0], InetAddress(), InetAddress()));
+        peers.push_back(fds[1]);
+    }
+    // 成对的连接：任何一个被关闭时同时关闭另一个
+    for (size_t i = 0; i < conns.size(); ++i) {
+        conns[i]->setCloseCallback([&, i](const TcpConnectionPtr&) {
+            ++closed;
+            conns[(i + 1) % conns.size()]->forceClose();
+        });
+        conns[i]->connectEstablished();
+        conns[i]->setIdleTimeoutWheel(&wheel);
+    }
+    EXPECT_EQ(wheel.size(), 3u);
+    loop.runAfter(std::chrono::milliseconds(100), [&loop]() { loop.quit(); });
+    loop.loop();
+
+    EXPECT_EQ(closed, 3);
+    EXPECT_EQ(wheel.size(), 0u);
+    for (int fd : peers) close(fd);
+}
+
+// 测试 create：连接释放后内存回到当前线程的对象池，下一个连接复用同一块；共用的回调对每个连接都生效
+TEST(TcpConnectionCreateTest, PooledAndSharedCallbacks) {
+    EventLoop loop;
+    std::atomic<int> closed(0);
+    auto callbacks = std::make_shared<TcpConnectionCallbacks>();
+    callbacks->close = [&closed](const TcpConnectionPtr&) { closed++; };
+
+    const TcpConnection* previous = nullptr;
+    for (int i = 0; i < 3; ++i) {
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        TcpConnectionPtr conn = TcpConnection::create(&loop, fds[0], InetAddress(), InetAddress());
+        if (previous != nullptr) {
+            EXPECT_EQ(conn.get(), previous);
+        }
+        previous = conn.get();
+        conn->setCallbacks(callbacks);
+        conn->connectEstablished();
+        conn->forceClose();
+        close(fds[1]);
+    }
+    EXPECT_EQ(closed.load(), 3);
+    // 每个连接释放后只剩这里的引用
+    EXPECT_EQ(callbacks.use_count(), 1);
+}
@@ -6,6 +6,8 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <sys/socket.h>
+#include <unistd.h>
 
 class TcpServerTest : public ::testing::Test {
 protected:
@@ -96,10 +98,7 @@ TEST_F(TcpServerTest, MultiThread) {
     // 等待线程初始化
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
     
-    // 清理
-    loop->quit();
-    delete loop;
-    loop = nullptr;
+    // server 先于 loop 析构，loop 由 TearDown 销毁
 }
 
 // 测试线程初始化回调
@@ -120,10 +119,7 @@ TEST_F(TcpServerTest, ThreadInitCallback) {
     
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
     
-    // 清理
-    loop->quit();
-    delete loop;
-    loop = nullptr;
+    // server 先于 loop 析构，loop 由 TearDown 销毁
 }
 
 // 测试主从 Reactor 模式：验证连接被分配到不同的线程
@@ -154,9 +150,330 @@ TEST_F(TcpServerTest, MasterSlaveReactor) {
     // 这里可以添加客户端连接测试，但为了简化，我们只测试服务器启动
     // 实际连接测试需要客户端支持
     
-    // 清理
-    loop->quit();
-    delete loop;
-    loop = nullptr;
+    // server 先于 loop 析构，loop 由 TearDown 销毁
 }
 
+
+namespace {
+
+// 连接到 127.0.0.1:port，失败时返回 -1
+int connectLoopback(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", port);
+    for (int i = 0; i < 50; ++i) {
+        if (::connect(fd, addr.getSockaddr(), addr.getSocklen()) == 0) return fd;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ::close(fd);
+    return -1;
+}
+
+} // anonymous namespace
+
+// 测试空闲超时：连接在 timeout 内没有数据就被服务端关闭，有数据时不会被关闭
+TEST_F(TcpServerTest, IdleTimeout) {
+    const uint16_t port = 19509;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setIdleTimeout(std::chrono::milliseconds(200));
+    std::atomic<int> messages(0);
+    server.setMessageCallback([&messages](const TcpConnectionPtr&, Buffer& buffer) {
+        buffer.retrieveAll();
+        messages++;
+    });
+    server.start();
+
+    std::atomic<bool> activeClosedEarly(true);
+    std::chrono::steady_clock::duration idleElapsed{};
+    std::thread client([&]() {
+        // 每 50ms 发一次数据，持续 600ms，超过了空闲超时也不应被关闭
+        int fd = connectLoopback(port);
+        ASSERT_GE(fd, 0);
+        for (int i = 0; i < 12; ++i) {
+            ASSERT_EQ(::write(fd, "x", 1), 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        char byte;
+        activeClosedEarly = ::recv(fd, &byte, 1, MSG_DONTWAIT) == 0;
+
+        // 之后不再发送，等待服务端关闭
+        auto begin = std::chrono::steady_clock::now();
+        EXPECT_EQ(::read(fd, &byte, 1), 0);
+        idleElapsed = std::chrono::steady_clock::now() - begin;
+        ::close(fd);
+        loop->quit();
+    });
+    loop->loop();
+    client.join();
+
+    EXPECT_FALSE(activeClosedEarly.load());
+    EXPECT_EQ(messages.load(), 12);
+    EXPECT_GE(idleElapsed, std::chrono::milliseconds(150));
+    EXPECT_LT(idleElapsed, std::chrono::seconds(2));
+}
+
+// 测试 SO_REUSEPORT 模式：每个工作线程自己 accept，主线程的 loop 不运行也能建立连接
+TEST_F(TcpServerTest, ReusePort) {
+    const uint16_t port = 19510;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(2);
+    server.setReusePort(true);
+    std::atomic<int> connected(0);
+    std::atomic<bool> onBaseLoop(false);
+    server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            connected++;
+            if (loop->isInLoopThread()) onBaseLoop = true;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buffer) {
+        conn->send(buffer.retrieveAllAsString());
+    });
+    server.start();
+
+    // 每个连接都应能收到回显
+    const int kClients = 8;
+    for (int i = 0; i < kClients; ++i) {
+        int fd = connectLoopback(port);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(::write(fd, "ping", 4), 4);
+        char reply[4];
+        ASSERT_EQ(::read(fd, reply, sizeof(reply)), 4);
+        EXPECT_EQ(std::string(reply, 4), "ping");
+        ::close(fd);
+    }
+
+    EXPECT_EQ(connected.load(), kClients);
+    EXPECT_FALSE(onBaseLoop.load());
+}
+
+// 测试批量 accept：突发的连接按 loop 分组投递，每个连接都能正常建立
+TEST_F(TcpServerTest, AcceptBatch) {
+    const uint16_t port = 19511;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(2);
+    server.setAcceptBatch(32);
+    std::atomic<int> connected(0);
+    server.setConnectionCallback([&connected](const TcpConnectionPtr& conn) {
+        if (conn->connected()) connected++;
+    });
+    server.start();
+
+    const int kClients = 20;
+    std::vector<int> clients;
+    for (int i = 0; i < kClients; ++i) {
+        int fd = connectLoopback(port);
+        ASSERT_GE(fd, 0);
+        clients.push_back(fd);
+    }
+    loop->runEvery(std::chrono::milliseconds(10), [&]() {
+        if (connected.load() == kClients) loop->quit();
+    });
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+
+    EXPECT_EQ(connected.load(), kClients);
+    for (int fd : clients) {
+        ::close(fd);
+    }
+}
+
+// 测试连接数上限：达到上限后暂停 accept，有连接关闭后恢复
+TEST_F(TcpServerTest, MaxConnections) {
+    const uint16_t port = 19512;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setMaxConnections(2);
+    std::atomic<int> connected(0);
+    server.setConnectionCallback([&connected](const TcpConnectionPtr& conn) {
+        if (conn->connected()) connected++;
+    });
+    server.start();
+
+    // 第三个连接完成握手后留在监听队列中
+    std::vector<int> clients;
+    for (int i = 0; i < 3; ++i) {
+        int fd = connectLoopback(port);
+        ASSERT_GE(fd, 0);
+        clients.push_back(fd);
+    }
+    loop->runAfter(std::chrono::milliseconds(200), [this]() { loop->quit(); });
+    loop->loop();
+    EXPECT_EQ(connected.load(), 2);
+    EXPECT_EQ(server.numConnections(), 2u);
+    EXPECT_EQ(server.rejectedConnections(), 0u);
+
+    // 关闭一个连接后恢复 accept，第三个连接被接受
+    ::close(clients[0]);
+    loop->runEvery(std::chrono::milliseconds(10), [&]() {
+        if (connected.load() == 3) loop->quit();
+    });
+    loop->runAfter(std::chrono::seconds(2), [this]() { loop->quit(); });
+    loop->loop();
+    EXPECT_EQ(connected.load(), 3);
+    EXPECT_EQ(server.numConnections(), 2u);
+
+    for (size_t i = 1; i < clients.size(); ++i) {
+        ::close(clients[i]);
+    }
+}
+
+// 测试边缘触发：小的读预算下大量数据分多轮读完，背压时依靠常驻的 EPOLLOUT 继续发送，回显完整
+TEST_F(TcpServerTest, EdgeTriggered) {
+    const uint16_t port = 19514;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setReusePort(true);  // 工作线程自己 accept，主线程的 loop 不运行
+    server.setEdgeTriggered(true, 4096);
+    std::atomic<int> reads(0);
+    std::atomic<size_t> maxRead(0);
+    server.setMessageCallback([&reads, &maxRead](const TcpConnectionPtr& conn, Buffer& buffer) {
+        reads++;
+        if (buffer.readableBytes() > maxRead.load()) {
+            maxRead = buffer.readableBytes();
+        }
+        conn->send(buffer.retrieveAllAsString());
+    });
+    server.start();
+
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    const size_t kTotal = 4 * 1024 * 1024;
+    std::thread writer([fd, kTotal]() {
+        std::string chunk(64 * 1024, 'e');
+        size_t sent = 0;
+        while (sent < kTotal) {
+            ssize_t n = ::write(fd, chunk.data(), std::min(chunk.size(), kTotal - sent));
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+    });
+    size_t received = 0;
+    bool intact = true;
+    char buf[65536];
+    while (received < kTotal) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] != 'e') intact = false;
+        }
+        received += static_cast<size_t>(n);
+    }
+    writer.join();
+    ::close(fd);
+
+    EXPECT_EQ(received, kTotal);
+    EXPECT_TRUE(intact);
+    // 每次可读事件最多读 4KB 预算，4MB 至少拆成 1024 次回调
+    EXPECT_LE(maxRead.load(), 4096u);
+    EXPECT_GE(reads.load(), static_cast<int>(kTotal / 4096));
+}
+
+// 测试连接缓冲区的字节统计：收到不完整的消息时计入统计，消息处理完后保留输入缓冲区的存储，
+// 之后连续 kShrinkAfterSparseReads 次读到的都是小消息时才归还存储，统计回到 0
+TEST_F(TcpServerTest, BufferBytes) {
+    const uint16_t port = 19519;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setReusePort(true);  // 工作线程自己 accept，主线程的 loop 不运行
+    std::atomic<int> messages(0);
+    // 以 '\n' 结尾的才是完整消息，不完整的留在输入缓冲区中
+    server.setMessageCallback([&messages](const TcpConnectionPtr& conn, Buffer& buffer) {
+        if (buffer.findEOL() != nullptr) {
+            conn->send(buffer.retrieveAllAsString());
+        }
+        messages++;
+    });
+    server.start();
+
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    auto waitFor = [&messages](int n) {
+        for (int i = 0; i < 200 && messages.load() < n; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    };
+
+    std::string partial(3000, 'p');
+    ASSERT_EQ(::write(fd, partial.data(), partial.size()), static_cast<ssize_t>(partial.size()));
+    waitFor(1);
+    EXPECT_GE(server.connectionBufferBytes(), partial.size());
+
+    ASSERT_EQ(::write(fd, "\n", 1), 1);
+    size_t received = 0;
+    char buf[4096];
+    while (received < partial.size() + 1) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        received += static_cast<size_t>(n);
+    }
+    EXPECT_EQ(received, partial.size() + 1);
+    // 读空后不立即归还，下一条同样大小的消息不用重新分配
+    waitFor(2);
+    EXPECT_GT(server.connectionBufferBytes(), 0u);
+
+    for (int i = 0; i < TcpConnection::kShrinkAfterSparseReads; ++i) {
+        ASSERT_EQ(::write(fd, "x\n", 2), 2);
+        ASSERT_EQ(::read(fd, buf, 2), 2);
+    }
+    // 应答一次写完，输出缓冲区也不持有存储
+    for (int i = 0; i < 200 && server.connectionBufferBytes() != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(server.connectionBufferBytes(), 0u);
+    ::close(fd);
+}
+
+// 测试共用读缓冲区：一次读完的消息不经过连接的输入缓冲区，分两次到达的消息先暂存再拼接完整
+TEST_F(TcpServerTest, SharedReadBuffer) {
+    const uint16_t port = 19520;
+    TcpServer server(loop, InetAddress(port, true));
+    server.setNumThread(1);
+    server.setReusePort(true);  // 工作线程自己 accept，主线程的 loop 不运行
+    server.setSharedReadBuffer(true);
+    std::atomic<int> shared(0);
+    std::atomic<int> messages(0);
+    // 按行回显，不完整的行留在缓冲区中
+    server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buffer) {
+        if (&buffer != &conn->inputBuffer()) {
+            shared++;
+        }
+        while (const char* eol = buffer.findEOL()) {
+            conn->send(buffer.peek(), static_cast<size_t>(eol + 1 - buffer.peek()));
+            buffer.retrieveUntil(eol + 1);
+        }
+        messages++;
+    });
+    server.start();
+
+    int fd = connectLoopback(port);
+    ASSERT_GE(fd, 0);
+    auto waitFor = [&messages](int n) {
+        for (int i = 0; i < 200 && messages.load() < n; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    };
+    auto readLine = [fd](size_t len) {
+        std::string result;
+        char buf[4096];
+        while (result.size() < len) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            result.append(buf, static_cast<size_t>(n));
+        }
+        return result;
+    };
+
+    ASSERT_EQ(::write(fd, "one\n", 4), 4);
+    EXPECT_EQ(readLine(4), "one\n");
+    // 不完整的行暂存在连接的输入缓冲区中，下一次读取直接读进输入缓冲区
+    ASSERT_EQ(::write(fd, "tw", 2), 2);
+    waitFor(2);
+    EXPECT_GT(server.connectionBufferBytes(), 0u);
+    ASSERT_EQ(::write(fd, "o\nthree\n", 8), 8);
+    EXPECT_EQ(readLine(10), "two\nthree\n");
+    ::close(fd);
+
+    EXPECT_EQ(shared.load(), 2);
+    EXPECT_EQ(messages.load(), 3);
+}
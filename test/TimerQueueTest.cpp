@@ -28,7 +28,7 @@ protected:
 TEST_F(TimerQueueTest, BasicTimer) {
     std::atomic<bool> fired(false);
     
-    Timer* timer = loop->runAfter(Milliseconds(100), [&fired]() {
+    TimerId timer = loop->runAfter(Milliseconds(100), [&fired]() {
         fired = true;
     });
     
@@ -49,7 +49,7 @@ TEST_F(TimerQueueTest, BasicTimer) {
 TEST_F(TimerQueueTest, RepeatTimer) {
     std::atomic<int> count(0);
     
-    Timer* timer = loop->runEvery(Milliseconds(50), [&count]() {
+    TimerId timer = loop->runEvery(Milliseconds(50), [&count]() {
         count++;
     });
     
@@ -70,7 +70,7 @@ TEST_F(TimerQueueTest, RepeatTimer) {
 TEST_F(TimerQueueTest, CancelTimer) {
     std::atomic<bool> fired(false);
     
-    Timer* timer = loop->runAfter(Seconds(1), [&fired]() {
+    TimerId timer = loop->runAfter(Seconds(1), [&fired]() {
         fired = true;
     });
     
@@ -87,3 +87,49 @@ TEST_F(TimerQueueTest, CancelTimer) {
     EXPECT_FALSE(fired);
 }
 
+
+// 测试定时器触发后旧句柄失效：再取消是安全的空操作，也不会取消复用同一槽位的新定时器
+TEST_F(TimerQueueTest, StaleTimerId) {
+    int firedA = 0;
+    int firedB = 0;
+    TimerId guard = loop->runAfter(Seconds(5), [this]() { loop->quit(); }); // 防止测试卡住
+    TimerId a = loop->runAfter(Milliseconds(1), [&]() {
+        ++firedA;
+        loop->quit();
+    });
+    loop->loop();
+    ASSERT_EQ(firedA, 1);
+
+    // a 的槽位已经归还，b 会复用它
+    TimerId b = loop->runAfter(Milliseconds(1), [&]() {
+        ++firedB;
+        loop->quit();
+    });
+    loop->cancelTimer(a);
+    loop->cancelTimer(a);
+    loop->loop();
+    EXPECT_EQ(firedB, 1);
+    EXPECT_FALSE(a == b);
+    loop->cancelTimer(guard);
+}
+
+// 测试在回调中取消正在执行的重复定时器
+TEST_F(TimerQueueTest, CancelInsideCallback) {
+    int count = 0;
+    TimerId timer;
+    timer = loop->runEvery(Milliseconds(1), [&]() {
+        ++count;
+        loop->cancelTimer(timer);
+        loop->runAfter(Milliseconds(20), [this]() { loop->quit(); });
+    });
+    loop->loop();
+    EXPECT_EQ(count, 1);
+}
+
+// 测试默认构造的句柄无效，取消它什么也不做
+TEST_F(TimerQueueTest, InvalidTimerId) {
+    TimerId id;
+    EXPECT_FALSE(id.valid());
+    loop->cancelTimer(id);
+    EXPECT_TRUE(loop->runAfter(Seconds(1), []() {}).valid());
+}
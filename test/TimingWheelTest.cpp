@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "knetlib/TimingWheel.h"
+#include "knetlib/Timer.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+class TimingWheelTest : public ::testing::Test {
+protected:
+    // 用远离当前时刻的时间作为起点，测试中的时间完全由 advance 的参数决定。
+    // 起点对齐到 tick 边界，否则亚毫秒的偏移落在哪个 tick 取决于当前时刻
+    TimingWheelTest()
+            : base(std::chrono::floor<Milliseconds>(time_utils::now() + Hours(1))),
+              wheel(base)
+    {}
+
+    Timer* makeTimer(Nanoseconds delay) {
+        timers.push_back(std::make_unique<Timer>([]() {}, base + delay, Nanoseconds::zero()));
+        return timers.back().get();
+    }
+
+    std::vector<Timer*> advanceTo(Nanoseconds offset) {
+        std::vector<Timer*> expired;
+        wheel.advance(base + offset, expired);
+        return expired;
+    }
+
+    Timestamp base;
+    TimingWheel wheel;
+    std::vector<std::unique_ptr<Timer>> timers;
+};
+
+// 测试不同层级的定时器都在到期时触发，且按到期时间顺序返回
+TEST_F(TimingWheelTest, ExpireAcrossLevels) {
+    std::vector<Nanoseconds> delays = {
+        Hours(30), Milliseconds(300), Milliseconds(1), Seconds(20), Hours(2), Milliseconds(255)
+    };
+    for (auto delay : delays) {
+        wheel.add(makeTimer(delay));
+    }
+    std::sort(delays.begin(), delays.end());
+
+    for (auto delay : delays) {
+        EXPECT_TRUE(advanceTo(delay - Milliseconds(1)).empty());
+        auto expired = advanceTo(delay);
+        ASSERT_EQ(expired.size(), 1u);
+        EXPECT_EQ(expired[0]->when(), base + delay);
+        EXPECT_FALSE(wheel.contains(expired[0]));
+    }
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+// 测试取消：被摘除的定时器不会到期
+TEST_F(TimingWheelTest, Remove) {
+    std::vector<Timer*> kept;
+    for (int i = 0; i < 1000; ++i) {
+        Timer* timer = makeTimer(Milliseconds(i * 37));
+        wheel.add(timer);
+        if (i % 2 == 0) kept.push_back(timer);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        wheel.remove(timers[i + 1].get());
+    }
+    EXPECT_EQ(wheel.size(), kept.size());
+
+    auto expired = advanceTo(Seconds(60));
+    EXPECT_EQ(expired, kept);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+// 测试同一个 tick 内的定时器保留 tick 以下的精度
+TEST_F(TimingWheelTest, SubTickPrecision) {
+    Timer* early = makeTimer(Milliseconds(5) + Microseconds(300));
+    Timer* late = makeTimer(Milliseconds(5) + Microseconds(700));
+    wheel.add(early);
+    wheel.add(late);
+
+    auto expired = advanceTo(Milliseconds(5) + Microseconds(500));
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], early);
+
+    Timestamp deadline;
+    ASSERT_TRUE(wheel.nextDeadline(&deadline));
+    EXPECT_EQ(deadline, late->when());
+
+    // 已经转过的 tick 里新加的定时器同样精确
+    Timer* past = makeTimer(Milliseconds(5) + Microseconds(600));
+    wheel.add(past);
+    expired = advanceTo(Milliseconds(5) + Microseconds(700));
+    ASSERT_EQ(expired.size(), 2u);
+    EXPECT_EQ(expired[0], past);
+    EXPECT_EQ(expired[1], late);
+}
+
+// 测试按 nextDeadline 推进时不会错过任何定时器，也不会提前触发
+TEST_F(TimingWheelTest, FollowNextDeadline) {
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int64_t> dist(0, Hours(20) / Microseconds(1));
+    for (int i = 0; i < 2000; ++i) {
+        wheel.add(makeTimer(Microseconds(dist(rng))));
+    }
+
+    size_t fired = 0;
+    int wakeups = 0;
+    Timestamp deadline;
+    Timestamp last = base;
+    while (wheel.nextDeadline(&deadline)) {
+        ASSERT_GE(deadline, last);
+        last = deadline;
+        std::vector<Timer*> expired;
+        wheel.advance(deadline, expired);
+        for (Timer* timer : expired) {
+            EXPECT_LE(timer->when(), deadline);
+        }
+        fired += expired.size();
+        ++wakeups;
+    }
+    EXPECT_EQ(fired, timers.size());
+    // 每个定时器最多下放 3 次、tick 内再精确唤醒 1 次，唤醒次数与定时器个数同一量级
+    EXPECT_LE(wakeups, 5 * static_cast<int>(timers.size()));
+}
+
+// 测试超出时间轮范围的定时器
+TEST_F(TimingWheelTest, BeyondRange) {
+    Timer* far = makeTimer(Hours(24 * 3));
+    wheel.add(far);
+    EXPECT_TRUE(advanceTo(Hours(24 * 3) - Seconds(1)).empty());
+    auto expired = advanceTo(Hours(24 * 3));
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0], far);
+}